@@ -0,0 +1,130 @@
+#include <sys/resource.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast_visitor.hpp"
+#include "bench.hpp"
+#include "flags.hpp"
+#include "parser.hpp"
+
+// Time to parse a program of types and functions, and the peak memory of the process afterwards. The nodes of the
+// parsed tree are then allocated again one at a time with new like the parser did before the arena, and from an arena
+
+namespace {
+
+const char* const OPERANDS[] = {"a", "b", "count", "1", "2.5", "\"s\"", "true"};
+const char* const OPERATORS[] = {" + ", " * ", " - ", " == ", " && "};
+
+void expr(Bench::Random& random, int depth, std::string& out) {
+    uint32_t kind = random.below(10);
+    if (depth > 3 || kind < 3) {
+        out += OPERANDS[random.below(sizeof(OPERANDS) / sizeof(OPERANDS[0]))];
+    } else if (kind < 6) {
+        expr(random, depth + 1, out);
+        out += OPERATORS[random.below(sizeof(OPERATORS) / sizeof(OPERATORS[0]))];
+        expr(random, depth + 1, out);
+    } else if (kind < 8) {
+        out += "f" + std::to_string(random.below(51)) + "(";
+        uint32_t numArgs = random.below(4);
+        for (uint32_t i = 0; i < numArgs; i++) {
+            if (i > 0) out += ", ";
+            expr(random, depth + 1, out);
+        }
+        out += ")";
+    } else {
+        out += "p.x.y";
+    }
+}
+
+std::string generate(size_t numFuncs) {
+    Bench::Random random(9);
+    std::string src;
+    for (size_t i = 0; i < numFuncs; i++) {
+        std::string n = std::to_string(i);
+        src += "Point" + n + " = ty {\n    x: Int\n    y: Int = " + n + "\n}\n\n";
+        src += "func" + n + " = (a: Int, b: Double, count: Int) -> Int {\n";
+        for (int j = 0; j < 6; j++) {
+            std::string v = "v" + std::to_string(j);
+            src += "    " + v + " = ";
+            expr(random, 0, src);
+            src += "\n    if ";
+            expr(random, 1, src);
+            src += " {\n        " + v + " = ";
+            expr(random, 0, src);
+            src += "\n    } else {\n        g(";
+            expr(random, 1, src);
+            src += ", ";
+            expr(random, 2, src);
+            src += ")\n    }\n";
+        }
+        src += "    for i = 0, i < 10, i = i + 1 {\n        s: Int = ";
+        expr(random, 0, src);
+        src += "\n    }\n    return Point" + n + ".{x = 1, y = ";
+        expr(random, 2, src);
+        src += "}\n}\n\n";
+    }
+    return src;
+}
+
+// Size and alignment of every node in the order the parser made them
+struct NodeSizes : ASTVisitor<NodeSizes> {
+    std::vector<std::pair<uint32_t, uint32_t>> nodes;
+    size_t bytes = 0;
+
+    template <class T>
+    bool enter(const T&) {
+        nodes.push_back({sizeof(T), alignof(T)});
+        bytes += sizeof(T);
+        return true;
+    }
+};
+
+size_t peak_rss_kb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 5, 10000, "arena_bench.scft");
+    Bench::write_file(args.output, generate(args.size));
+    Flags::numThreads = 1;
+    size_t startRss = peak_rss_kb();
+
+    NodeSizes sizes;
+    size_t arenaBytes = 0;
+    double parseMs = Bench::best_ms(args.runs, [&] {
+        Parser parser;
+        parser.lexer.from_file_path(args.output.c_str());
+        ASTProgram* program = parser.parse_program();
+        if (sizes.nodes.empty()) sizes.traverse(*program);
+        arenaBytes = parser.arena.memory_usage();
+    });
+    size_t parseRss = peak_rss_kb();
+
+    // Freed in the same order they were made, like the old tree of unique_ptrs was torn down from the root
+    double newMs = Bench::best_ms(args.runs, [&] {
+        std::vector<std::unique_ptr<char[]>> nodes;
+        nodes.reserve(sizes.nodes.size());
+        for (auto& node : sizes.nodes) nodes.emplace_back(new char[node.first]);
+    });
+    double arenaMs = Bench::best_ms(args.runs, [&] {
+        Arena arena;
+        for (auto& node : sizes.nodes) arena.allocate(node.first, node.second);
+    });
+
+    std::printf("%zu functions, %zu nodes taking %zu bytes, best of %d\n", args.size, sizes.nodes.size(), sizes.bytes,
+                args.runs);
+    std::printf("  lex and parse                  %8.2f ms\n", parseMs);
+    std::printf("  arena reserved                 %8.2f MB\n", arenaBytes / 1e6);
+    std::printf("  peak RSS before parsing        %8.2f MB\n", startRss / 1e3);
+    std::printf("  peak RSS after parsing         %8.2f MB\n", parseRss / 1e3);
+    std::printf("  make and free nodes with new   %8.2f ms\n", newMs);
+    std::printf("  make and free nodes in arena   %8.2f ms\n", arenaMs);
+    return 0;
+}
@@ -0,0 +1,144 @@
+#include <cstdio>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+#include "flags.hpp"
+#include "lexer.hpp"
+#include "sym_tab.hpp"
+
+// Cost of interning identifiers and string literals while lexing, and what it saves when declarations are looked up,
+// on a module of 100k declarations which each refer to a random earlier one
+
+namespace {
+
+std::string generate(size_t numDecls) {
+    Bench::Random random(7);
+    std::string src = "d0: Int = 1 + 0\n";
+    for (size_t i = 1; i < numDecls; i++) {
+        src += "d" + std::to_string(i) + ": Int = d" + std::to_string(random.below(static_cast<uint32_t>(i))) + " + " +
+               std::to_string(i) + "\n";
+        if (i % 10 == 0) src += "s" + std::to_string(i) + ": String = \"str" + std::to_string(i) + "\"\n";
+    }
+    return src;
+}
+
+// The hash and comparison the symbol table used on identifier spellings before atoms
+struct SpellingKey {
+    static size_t hash(std::string_view key) {
+        int hash = 0;
+        for (char ch : key) hash = hash * 31 + ch;
+        return static_cast<size_t>(hash & 0x7fffffff);
+    }
+};
+struct AtomKey {
+    static size_t hash(AtomID key) { return key; }
+};
+
+// Chained table like the old SymTable, but with enough buckets that chains stay short so that only the keys differ
+template <class Key, class Traits>
+struct ChainedTable {
+    struct Entry {
+        Entry* next;
+        Key key;
+    };
+    std::vector<Entry*> buckets = std::vector<Entry*>(1 << 17, nullptr);
+    std::deque<Entry> entries;
+
+    Entry*& bucket(Key key) { return buckets[Traits::hash(key) & (buckets.size() - 1)]; }
+    Entry* find(Key key) {
+        for (Entry* entry = bucket(key); entry != nullptr; entry = entry->next) {
+            if (entry->key == key) return entry;
+        }
+        return nullptr;
+    }
+    void insert(Key key) {
+        Entry*& head = bucket(key);
+        entries.push_back({head, key});
+        head = &entries.back();
+    }
+};
+
+struct Names {
+    std::vector<TokenID> declared;  // Identifiers followed by a ':'
+    std::vector<TokenID> used;
+    std::vector<std::string_view> spellings;  // Of every identifier and string literal
+};
+
+Names collect_names(const TokenList& tokens) {
+    Names names;
+    for (TokenID id = 0; id + 1 < tokens.next_id(); id++) {
+        TokenType type = tokens.type(id);
+        if (type == TokenType::STRING_LITERAL) names.spellings.push_back(tokens.str(id));
+        if (type != TokenType::IDENTIFIER) continue;
+        names.spellings.push_back(tokens.str(id));
+        (tokens.type(id + 1) == TokenType::COLON ? names.declared : names.used).push_back(id);
+    }
+    return names;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 5, 100000, "atom_bench.scft");
+    Bench::write_file(args.output, generate(args.size));
+    Flags::numThreads = 1;
+
+    Lexer lexer;
+    double lexMs = Bench::best_ms(args.runs, [&] {
+        lexer.from_file_path(args.output.c_str());
+        while (lexer.next_token().type != TokenType::END) {
+        }
+    });
+    const TokenList& tokens = lexer.tokens;
+    Names names = collect_names(tokens);
+
+    uint32_t sink = 0;
+    double hashMs = Bench::best_ms(args.runs, [&] {
+        for (std::string_view spelling : names.spellings) sink += AtomTable::hash_str(spelling);
+    });
+    double internMs = Bench::best_ms(args.runs, [&] {
+        AtomTable atoms;
+        for (std::string_view spelling : names.spellings) sink += atoms.intern(spelling);
+    });
+
+    size_t found[3] = {};
+    double spellingMs = Bench::best_ms(args.runs, [&] {
+        ChainedTable<std::string_view, SpellingKey> table;
+        for (TokenID id : names.declared) {
+            if (table.find(tokens.str(id)) == nullptr) table.insert(tokens.str(id));
+        }
+        found[0] = 0;
+        for (TokenID id : names.used) found[0] += table.find(tokens.str(id)) != nullptr;
+    });
+    double atomMs = Bench::best_ms(args.runs, [&] {
+        ChainedTable<AtomID, AtomKey> table;
+        for (TokenID id : names.declared) {
+            if (table.find(tokens.atom(id)) == nullptr) table.insert(tokens.atom(id));
+        }
+        found[1] = 0;
+        for (TokenID id : names.used) found[1] += table.find(tokens.atom(id)) != nullptr;
+    });
+    double symTableMs = Bench::best_ms(args.runs, [&] {
+        SymTable table;
+        for (TokenID id : names.declared) table.insert(tokens.atom(id), nullptr);
+        found[2] = 0;
+        for (TokenID id : names.used) found[2] += table.find(tokens.atom(id)) != nullptr;
+    });
+    if (found[0] != found[1] || found[1] != found[2]) {
+        std::printf("Tables found different names: %zu, %zu and %zu\n", found[0], found[1], found[2]);
+        return 1;
+    }
+
+    std::printf("%zu declarations, %zu uses, %zu atoms, best of %d (%u)\n", names.declared.size(), names.used.size(),
+                lexer.atoms.size(), args.runs, sink & 1);
+    std::printf("  lex the module                   %8.2f ms\n", lexMs);
+    std::printf("  hash every spelling              %8.2f ms\n", hashMs);
+    std::printf("  intern every spelling            %8.2f ms\n", internMs);
+    std::printf("  declare and look up by spelling  %8.2f ms\n", spellingMs);
+    std::printf("  declare and look up by atom      %8.2f ms\n", atomMs);
+    std::printf("  same with SymTable               %8.2f ms\n", symTableMs);
+    return 0;
+}
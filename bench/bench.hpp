@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+// Helpers shared by the benchmarks. Inputs are generated from a fixed seed so that runs on different revisions time the
+// same work. Every benchmark takes [-runs N] [-n SIZE] [-o FILE], where FILE is where a generated source file goes.
+namespace Bench {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsed_ms(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// Shortest wall time of runs calls of work in milliseconds. Timing on a busy machine only ever adds noise
+template <class F>
+double best_ms(int runs, F work) {
+    double best = 1e300;
+    for (int i = 0; i < runs; i++) {
+        auto start = Clock::now();
+        work();
+        double ms = elapsed_ms(start, Clock::now());
+        if (ms < best) best = ms;
+    }
+    return best;
+}
+
+// splitmix64, which is plenty for generating inputs
+struct Random {
+    uint64_t state;
+
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    uint32_t below(uint32_t bound) { return static_cast<uint32_t>(next() % bound); }
+    bool chance(uint32_t percent) { return below(100) < percent; }
+};
+
+struct Args {
+    int runs;
+    size_t size;
+    std::string output;
+
+    Args(int argc, char** argv, int defaultRuns, size_t defaultSize, const char* defaultOutput)
+        : runs(defaultRuns), size(defaultSize), output(defaultOutput) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            if (std::strcmp(argv[i], "-runs") == 0) {
+                runs = std::atoi(argv[i + 1]);
+            } else if (std::strcmp(argv[i], "-n") == 0) {
+                size = std::strtoull(argv[i + 1], nullptr, 10);
+            } else if (std::strcmp(argv[i], "-o") == 0) {
+                output = argv[i + 1];
+            }
+        }
+    }
+};
+
+inline void write_file(const std::string& path, const std::string& contents) {
+    std::ofstream(path, std::ios::binary).write(contents.data(), static_cast<std::streamsize>(contents.size()));
+}
+
+}  // namespace Bench
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+#include "bench.hpp"
+#include "flags.hpp"
+#include "operators.hpp"
+#include "parser.hpp"
+
+// Time to parse a file of random expressions which use every binary operator along with calls, member access, type
+// initializations and parentheses, between comments and the other kinds of declaration. The step of recur_expr which
+// decides what the token after an operand does is also timed alone, with the operator table and with the switch and
+// peeks it replaced
+
+namespace {
+
+const char* const BIN_OPS[] = {"+",  "-",  "*",  "/",  "%", "<<", "&&", "||", "==", "!=",
+                               "<=", ">=", "<",  ">",  "&", "|",  "$",  "$$", "^"};
+const char* const CONSTANTS[] = {"3.25", "1_000", "true", "false", "\"str\\\"ing\"", "Int"};
+
+template <size_t N>
+const char* pick(Bench::Random& random, const char* const (&choices)[N]) {
+    return choices[random.below(N)];
+}
+
+void expr(Bench::Random& random, int depth, std::string& out) {
+    uint32_t kind = random.below(100);
+    if (depth > 3 || kind < 30) {
+        uint32_t operand = random.below(9);
+        char hex[16];
+        switch (operand) {
+            case 0:
+                out += std::to_string(random.below(100000));
+                break;
+            case 1:
+                std::snprintf(hex, sizeof(hex), "0x%X", random.below(65536));
+                out += hex;
+                break;
+            case 2:
+                out += "name" + std::to_string(random.below(51));
+                break;
+            default:
+                out += CONSTANTS[operand - 3];
+        }
+    } else if (kind < 60) {
+        expr(random, depth + 1, out);
+        out += std::string(" ") + pick(random, BIN_OPS) + " ";
+        expr(random, depth + 1, out);
+    } else if (kind < 70) {
+        out += "(";
+        expr(random, depth + 1, out);
+        out += ")";
+    } else if (kind < 80) {
+        out += "call" + std::to_string(depth) + "(";
+        uint32_t numArgs = random.below(4);
+        for (uint32_t i = 0; i < numArgs; i++) {
+            if (i > 0) out += ", ";
+            expr(random, depth + 1, out);
+        }
+        out += ")";
+    } else if (kind < 85) {
+        out += "-(";
+        expr(random, depth + 1, out);
+        out += ")";
+    } else if (kind < 90) {
+        out += "obj.member.x";
+    } else if (kind < 95) {
+        out += "Point.{ x = ";
+        expr(random, depth + 1, out);
+        out += ", y = ";
+        expr(random, depth + 1, out);
+        out += " }";
+    } else {
+        out += "ptr.*";
+    }
+}
+
+// Precedence of the token after an operand the way recur_expr found it before the operator table
+int switch_precedence(TokenType type) {
+    switch (type) {
+        case TokenType::COND_OR:
+            return 1;
+        case TokenType::COND_XOR:
+            return 2;
+        case TokenType::COND_AND:
+            return 3;
+        case TokenType::BIT_OR:
+            return 4;
+        case TokenType::BIT_XOR:
+            return 5;
+        case TokenType::BIT_AND:
+            return 6;
+        case TokenType::COND_EQUALS:
+        case TokenType::COND_NOT_EQUALS:
+            return 7;
+        case TokenType::COND_GREATER_EQUAL:
+        case TokenType::COND_LESS_EQUAL:
+        case TokenType::COND_GREATER:
+        case TokenType::COND_LESS:
+            return 8;
+        case TokenType::BIT_SHIFT_LEFT:
+        case TokenType::BIT_SHIFT_RIGHT:
+            return 9;
+        case TokenType::OP_ADD:
+        case TokenType::OP_SUBTR:
+            return 10;
+        case TokenType::OP_MULT:
+        case TokenType::OP_DIV:
+        case TokenType::OP_MOD:
+            return 11;
+        case TokenType::OP_CARROT:
+            return 12;
+        case TokenType::DEREF:
+        case TokenType::LEFT_PARENS:
+        case TokenType::DOT:
+            return 13;
+        default:
+            return Operators::LOWEST_PRECEDENCE;
+    }
+}
+
+// Decides what every token of the file does after an operand: the precedence from the switch and then a peek for
+// each kind of operator which isn't a binary one, or a single lookup in the operator table when TABLE is set
+template <bool TABLE>
+__attribute__((noinline)) uint64_t dispatch_tokens(Lexer& lexer) {
+    uint64_t sum = 0;
+    while (lexer.peek_token().type != TokenType::END) {
+        int precedence;
+        Operators::Infix infix = Operators::Infix::NONE;
+        if (TABLE) {
+            const Operators::Operator& op = Operators::operator_of(lexer.peek_token().type);
+            precedence = op.precedence;
+            infix = op.infix;
+        } else {
+            precedence = switch_precedence(lexer.peek_token().type);
+            if (precedence > Operators::LOWEST_PRECEDENCE) {
+                if (lexer.peek_token().type == TokenType::LEFT_PARENS) {
+                    infix = Operators::Infix::CALL;
+                } else if (lexer.peek_token().type == TokenType::DEREF) {
+                    infix = Operators::Infix::DEREF;
+                } else if (lexer.peek_token().type == TokenType::DOT) {
+                    infix = Operators::Infix::DOT;
+                } else {
+                    infix = Operators::Infix::BIN_OP;
+                }
+            }
+        }
+        sum += precedence * 8 + static_cast<int>(infix);
+        lexer.next_token();
+    }
+    return sum;
+}
+
+std::string generate(size_t numDecls) {
+    const char* const annotations[] = {"", ": Int", ": Double"};
+    Bench::Random random(24);
+    std::string src;
+    for (size_t i = 0; i < numDecls; i++) {
+        std::string n = std::to_string(i);
+        if (random.chance(30)) src += "// comment banner " + std::string(random.below(61), '=') + "\n";
+        if (random.chance(10)) src += "/* block\n   comment * / ** \n */\n";
+        uint32_t kind = random.below(100);
+        if (kind < 50) {
+            src += "v" + n + pick(random, annotations) + " = ";
+            expr(random, 0, src);
+        } else if (kind < 60) {
+            src += "c" + n + " => ";
+            expr(random, 0, src);
+        } else if (kind < 75) {
+            src += "f" + n + " = (a: Int, b: Bool) -> Int {\n    x = ";
+            expr(random, 0, src);
+            src += "\n    if a < b {\n        y = x\n    } else {\n        return x\n    }\n    return a + b\n}";
+        } else if (kind < 85) {
+            src += "T" + n + " => ty {\n    x: Int\n    y: Double => ";
+            expr(random, 0, src);
+            src += "\n}";
+        } else if (kind < 95) {
+            src += "M" + n + " => mod {\n    a = ";
+            expr(random, 0, src);
+            src += "\n    b: Bool\n}";
+        } else {
+            src += "s" + n + " = (Int, Bool) -> Void";
+        }
+        src += "\n";
+    }
+    return src;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 6, 120000, "expr_bench.scft");
+    std::string src = generate(args.size);
+    Bench::write_file(args.output, src);
+    Flags::numThreads = 1;
+
+    size_t numTokens = 0;
+    double lexMs = Bench::best_ms(args.runs, [&] {
+        Lexer lexer;
+        lexer.from_file_path(args.output.c_str());
+        while (lexer.next_token().type != TokenType::END) {
+        }
+        numTokens = lexer.tokens.size();
+    });
+    bool parsed = true;
+    double parseMs = Bench::best_ms(args.runs, [&] {
+        Parser parser;
+        parser.lexer.from_file_path(args.output.c_str());
+        parser.parse_program();
+        parsed = !parser.dx.has_errors();
+    });
+    if (!parsed) {
+        std::printf("The generated file doesn't parse\n");
+        return 1;
+    }
+
+
+    // The dispatch reads the tokens through a lexer which shares those of one which lexed the whole file ahead
+    Flags::numThreads = 2;
+    Lexer ahead;
+    ahead.from_file_path(args.output.c_str());
+    uint64_t sums[2] = {};
+    double dispatchMs[2] = {1e300, 1e300};
+    for (int run = 0; run < args.runs; run++) {
+        for (int table = 0; table < 2; table++) {
+            Lexer lexer(ahead, 0);
+            auto start = Bench::Clock::now();
+            sums[table] = table ? dispatch_tokens<true>(lexer) : dispatch_tokens<false>(lexer);
+            dispatchMs[table] = std::min(dispatchMs[table], Bench::elapsed_ms(start, Bench::Clock::now()));
+        }
+    }
+    if (sums[0] != sums[1]) {
+        std::printf("The operator table and the switch disagree\n");
+        return 1;
+    }
+
+    std::printf("%zu declarations, %.1f MB, %zu tokens, best of %d\n", args.size, src.size() / 1e6, numTokens,
+                args.runs);
+    std::printf("  lex only                    %8.2f ms\n", lexMs);
+    std::printf("  lex and parse               %8.2f ms\n", parseMs);
+    std::printf("  dispatch, switch and peeks  %8.2f ms\n", dispatchMs[0]);
+    std::printf("  dispatch, operator table    %8.2f ms\n", dispatchMs[1]);
+    return 0;
+}
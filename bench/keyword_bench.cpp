@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bench.hpp"
+#include "lexer.hpp"
+
+// Time to classify an identifier as a keyword with keyword_type against the if/else chain of string comparisons which
+// consume_token used before
+
+namespace {
+
+const char* const KEYWORD_WORDS[] = {"mod", "ty", "if", "else", "for", "while", "break", "continue", "true",
+                                     "false", "Void", "Module", "Type", "Int", "Double", "String", "Bool", "return"};
+const char* const NAME_PARTS[] = {"value", "count", "index", "node",  "token", "scope", "result", "buffer",
+                                  "left",  "right", "size",  "entry", "type",  "decl",  "first",  "x"};
+
+__attribute__((noinline)) TokenType chain_type(std::string_view keyword) {
+    if (keyword == "mod") {
+        return TokenType::MOD;
+    } else if (keyword == "ty") {
+        return TokenType::TY;
+    } else if (keyword == "if") {
+        return TokenType::IF;
+    } else if (keyword == "else") {
+        return TokenType::ELSE;
+    } else if (keyword == "for") {
+        return TokenType::FOR;
+    } else if (keyword == "while") {
+        return TokenType::UNKNOWN;
+    } else if (keyword == "break") {
+        return TokenType::BREAK;
+    } else if (keyword == "continue") {
+        return TokenType::CONTINUE;
+    } else if (keyword == "true") {
+        return TokenType::TRUE;
+    } else if (keyword == "false") {
+        return TokenType::FALSE;
+    } else if (keyword == "Void") {
+        return TokenType::VOID_TYPE;
+    } else if (keyword == "Module") {
+        return TokenType::MOD_TYPE;
+    } else if (keyword == "Type") {
+        return TokenType::TY_TYPE;
+    } else if (keyword == "Int") {
+        return TokenType::INT_TYPE;
+    } else if (keyword == "Double") {
+        return TokenType::DOUBLE_TYPE;
+    } else if (keyword == "String") {
+        return TokenType::STRING_TYPE;
+    } else if (keyword == "Bool") {
+        return TokenType::BOOL_TYPE;
+    } else if (keyword == "return") {
+        return TokenType::RETURN;
+    }
+    return TokenType::IDENTIFIER;
+}
+
+// An out of line call like keyword_type and chain_type, which doesn't classify, so that the cost of the call can be
+// subtracted
+__attribute__((noinline)) TokenType call_only(const char* str, size_t len) {
+    return static_cast<TokenType>(str[0] + str[len - 1]);
+}
+
+// Identifiers of which about a quarter are keywords, laid out in one buffer with padding like a source file
+std::vector<std::string_view> generate(size_t count, std::string& buffer) {
+    Bench::Random random(3);
+    std::vector<std::pair<size_t, size_t>> spans;
+    for (size_t i = 0; i < count; i++) {
+        std::string word;
+        if (random.chance(25)) {
+            word = KEYWORD_WORDS[random.below(sizeof(KEYWORD_WORDS) / sizeof(KEYWORD_WORDS[0]))];
+        } else {
+            size_t numParts = 1 + random.below(3);
+            for (size_t p = 0; p < numParts; p++) {
+                std::string part = NAME_PARTS[random.below(sizeof(NAME_PARTS) / sizeof(NAME_PARTS[0]))];
+                if (p > 0) part[0] = static_cast<char>(part[0] - 'a' + 'A');
+                word += part;
+            }
+        }
+        spans.push_back({buffer.size(), word.size()});
+        buffer += word;
+        buffer += ' ';
+    }
+    buffer.append(8, '\0');
+    std::vector<std::string_view> words;
+    for (auto& span : spans) words.push_back(std::string_view(buffer.data() + span.first, span.second));
+    return words;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 7, 4000000, "");
+    std::string buffer;
+    std::vector<std::string_view> words = generate(args.size, buffer);
+
+    size_t numKeywords = 0;
+    for (std::string_view word : words) {
+        TokenType type = chain_type(word);
+        if (type != keyword_type(word.data(), word.size())) {
+            std::printf("%.*s classified differently\n", static_cast<int>(word.size()), word.data());
+            return 1;
+        }
+        numKeywords += type != TokenType::IDENTIFIER;
+    }
+
+    unsigned sink = 0;
+    auto per_word = [&](auto classify) {
+        return Bench::best_ms(args.runs, [&] {
+                   for (std::string_view word : words) sink += static_cast<unsigned>(classify(word));
+               }) * 1e6 / words.size();
+    };
+    double callNs = per_word([](std::string_view word) { return call_only(word.data(), word.size()); });
+    double chainNs = per_word(chain_type);
+    double hashNs = per_word([](std::string_view word) { return keyword_type(word.data(), word.size()); });
+
+    std::printf("%zu identifiers, %.0f%% keywords, best of %d (%u)\n", words.size(), 100.0 * numKeywords / words.size(),
+                args.runs, sink & 1);
+    std::printf("  call overhead     %6.2f ns/word\n", callNs);
+    std::printf("  if/else chain     %6.2f ns/word\n", chainNs - callNs);
+    std::printf("  keyword_type      %6.2f ns/word\n", hashNs - callNs);
+    return 0;
+}
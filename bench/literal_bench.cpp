@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "lexer.hpp"
+#include "literal.hpp"
+
+// Time to convert the numeric literals of a generated data table with the digit by digit loop which consume_token used
+// before against the exact conversion of lex_number, both with and without converting up to 8 digits at once
+
+namespace {
+
+// A row of a data table: mostly ints and decimals with a few digits, some long ids, hex masks and grouped amounts
+std::string generate_literal(Bench::Random& random) {
+    auto digits = [&](size_t count, int base) {
+        std::string str;
+        for (size_t i = 0; i < count; i++) {
+            int digit = static_cast<int>(random.below(static_cast<uint32_t>(base)));
+            if (i == 0 && count > 1 && digit == 0) digit = 1;
+            str += "0123456789abcdef"[digit];
+        }
+        return str;
+    };
+    uint32_t kind = random.below(100);
+    if (kind < 35) return digits(1 + random.below(9), 10);
+    if (kind < 50) return digits(10 + random.below(9), 10);
+    if (kind < 60) {
+        std::string grouped = digits(1 + random.below(3), 10);
+        for (uint32_t groups = 1 + random.below(4); groups > 0; groups--) grouped += "_" + digits(3, 10);
+        return grouped;
+    }
+    if (kind < 70) return "0x" + digits(4 + random.below(13), 16);
+    return digits(1 + random.below(6), 10) + "." + digits(1 + random.below(12), 10);
+}
+
+inline bool continues_literal(char ch, int base) {
+    bool hex = base == 16 && (ch | 0x20) >= 'a' && (ch | 0x20) <= 'f';
+    return (ch >= '0' && ch <= '9') || ch == '_' || ch == '.' || hex;
+}
+
+inline int literal_base(const char*& str) {
+    if (str[0] == '0' && (str[1] == 'b' || str[1] == 'o' || str[1] == 'x')) {
+        int base = str[1] == 'b' ? 2 : str[1] == 'o' ? 8 : 16;
+        str += 2;
+        return base;
+    }
+    return 10;
+}
+
+inline uint64_t double_bits(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Value of an int literal or the bits of a double literal, one digit at a time and divided by a power of the base at
+// the end like consume_token did
+__attribute__((noinline)) uint64_t digit_loop_value(const char* str) {
+    int base = literal_base(str);
+    uint64_t number = 0;
+    double divisor = 0;
+    for (; continues_literal(*str, base); str++) {
+        if (*str == '_') continue;
+        if (*str == '.') {
+            divisor = 1;
+            continue;
+        }
+        number = base * number + Literal::digit_value(*str);
+        if (divisor > 0) divisor *= base;
+    }
+    return divisor > 0 ? double_bits(static_cast<double>(number) / divisor) : number;
+}
+
+// The same with the loop of lex_number, which converts the digits between separators up to 8 at a time when SWAR is
+// set, and its correctly rounded conversion of doubles
+template <bool SWAR>
+__attribute__((noinline)) uint64_t exact_value(const char* str) {
+    int base = literal_base(str);
+    uint64_t number = 0;
+    bool wrapped = false;
+    int fractionDigits = -1;
+    size_t len = 0;
+    for (;;) {
+        uint64_t digits;
+        int numDigits = SWAR ? Literal::parse_digits(str + len, base, digits) : 0;
+        if (numDigits > 0) {
+            wrapped |= Literal::accumulate(number, Literal::digit_scale(base, numDigits), digits);
+            if (fractionDigits >= 0) fractionDigits += numDigits;
+            len += numDigits;
+            if (numDigits == 8) continue;
+        }
+        char ch = str[len];
+        if (!continues_literal(ch, base)) break;
+        if (ch == '.') {
+            fractionDigits = 0;
+        } else if (ch != '_') {
+            wrapped |= Literal::accumulate(number, base, Literal::digit_value(ch));
+            if (fractionDigits >= 0) fractionDigits++;
+        }
+        len++;
+    }
+    if (fractionDigits < 0) return number;
+    Literal::Range range;
+    return double_bits(
+        Literal::to_floating(std::string_view(str, len), base, number, !wrapped, fractionDigits, false, range));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 7, 2000000, "literal_bench.scft");
+    Bench::Random random(8);
+
+    // Literals laid out in one buffer with padding like a source file, and the same literals as a table to lex
+    std::string buffer, table;
+    std::vector<size_t> starts;
+    for (size_t i = 0; i < args.size; i++) {
+        std::string literal = generate_literal(random);
+        starts.push_back(buffer.size());
+        buffer += literal + " ";
+        table += "v" + std::to_string(i) + " = " + literal + "\n";
+    }
+    buffer.append(8, '\0');
+
+    // Ints and doubles are timed apart since only doubles differ in how they are converted at the end
+    std::vector<size_t> ints, doubles;
+    size_t numMisrounded = 0;
+    for (size_t start : starts) {
+        const char* str = buffer.data() + start;
+        uint64_t loop = digit_loop_value(str), eight = exact_value<true>(str);
+        if (exact_value<false>(str) != eight) {
+            std::printf("%s converted differently up to 8 digits at a time\n", str);
+            return 1;
+        }
+        bool isDouble = false;
+        for (const char* ch = str; *ch != ' '; ch++) isDouble |= *ch == '.';
+        if (!isDouble) {
+            if (loop != eight) {
+                std::printf("%s converted differently by the digit by digit loop\n", str);
+                return 1;
+            }
+            ints.push_back(start);
+        } else {
+            doubles.push_back(start);
+            numMisrounded += loop != eight;
+        }
+    }
+
+    // The conversions take turns in every run so that a busy machine slows them down alike
+    uint64_t (*const conversions[])(const char*) = {digit_loop_value, exact_value<false>, exact_value<true>};
+    double intNs[3] = {1e300, 1e300, 1e300}, doubleNs[3] = {1e300, 1e300, 1e300};
+    uint64_t sink = 0;
+    for (int run = 0; run < args.runs; run++) {
+        for (int c = 0; c < 3; c++) {
+            auto convert_all = [&](const std::vector<size_t>& literals) {
+                auto start = Bench::Clock::now();
+                for (size_t literal : literals) sink += conversions[c](buffer.data() + literal);
+                return Bench::elapsed_ms(start, Bench::Clock::now()) * 1e6 / literals.size();
+            };
+            intNs[c] = std::min(intNs[c], convert_all(ints));
+            doubleNs[c] = std::min(doubleNs[c], convert_all(doubles));
+        }
+    }
+
+    Bench::write_file(args.output, table);
+    double lexMs = Bench::best_ms(args.runs, [&] {
+        Lexer lexer;
+        lexer.from_file_path(args.output.c_str());
+        while (lexer.next_token().type != TokenType::END) {
+        }
+    });
+
+    std::printf("%zu ints and %zu doubles, best of %d (%u)\n", ints.size(), doubles.size(), args.runs,
+                static_cast<unsigned>(sink & 1));
+    std::printf("                                  ints          doubles\n");
+    const char* names[] = {"digit by digit loop", "exact, one digit at a time", "exact, up to 8 digits at once"};
+    for (int c = 0; c < 3; c++) {
+        std::printf("  %-30s  %6.2f ns     %6.2f ns\n", names[c], intNs[c], doubleNs[c]);
+    }
+    std::printf("  %zu doubles off by rounding with the digit by digit loop\n", numMisrounded);
+    std::printf("  lex the whole table            %6.1f ms\n", lexMs);
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ast_visitor.hpp"
+#include "bench.hpp"
+#include "flags.hpp"
+#include "parser.hpp"
+
+// Time to parse a program serially against in chunks on separate threads, which also takes -j [count] for the number
+// of threads. Before timing, every node, name link, symbol table and type of the program parsed in chunks is checked
+// against the program parsed serially
+
+namespace {
+
+std::string generate(size_t numDecls) {
+    Bench::Random random(25);
+    std::string src;
+    for (size_t i = 0; i < numDecls; i++) {
+        std::string n = std::to_string(i);
+        std::string global = "g" + std::to_string(random.below(static_cast<uint32_t>(numDecls)));
+        switch (random.below(8)) {
+            case 0:
+                src += "g" + n + " = " + n + " + " + global + "\n";
+                break;
+            case 1:
+                src += "f" + n + " = (a: Int, b: *Point" + std::to_string(i % 7) + ") -> Int {\n    " + global +
+                       " = a\n    x" + std::to_string(i % 5) + " = g" + std::to_string(i * 7 % numDecls) +
+                       " + a\n    for i = 0, i < 3, i = i + 1 { if i == 2 { break } }\n    return x" +
+                       std::to_string(i % 5) + " * 2\n}\n";
+                break;
+            case 2:
+                src += "Point" + n + " = ty {\n    x: Int = 0\n    y: Double\n    next: *Point" + n +
+                       "\n    m = (p: Point" + n + ") -> (Int, Int) -> Bool { return " + global + " }\n}\n";
+                break;
+            case 3:
+                src += "m" + n + " = mod {\n    inner = " + global + "\n    " + global +
+                       " = 3\n    h = () :: inner + " + global + "\n}\n";
+                break;
+            case 4:
+                src += "c" + n + " => " + std::to_string(i % 13) + " * 2 ^ 3 ^ 1\n";
+                break;
+            case 5:
+                src += global + " = " + n + "\n";  // Declared again or assigned at global scope
+                break;
+            case 6:
+                src += "s" + n + ": String = \"str" + n + "\"\n";
+                break;
+            default:
+                src += "t" + n + ": (Int, Double) -> *Point" + std::to_string(random.below(11)) + "\n";
+        }
+    }
+    return src;
+}
+
+// Everything the parser produces, with nodes and declarations numbered in pre-order so that two parses of the same
+// program can be compared even though their nodes live at different addresses
+class ProgramDump {
+    std::vector<const ASTNode*> order;
+    std::vector<std::pair<const void*, long>> ids;  // Sorted by address
+    std::string out;
+
+    void number(const ASTNode& root) {
+        std::vector<const ASTNode*> stack = {&root};
+        while (!stack.empty()) {
+            const ASTNode* node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            size_t firstChild = stack.size();
+            for_each_child(*node, [&](const ASTNode* child) {
+                if (child != nullptr) stack.push_back(child);
+            });
+            std::reverse(stack.begin() + firstChild, stack.end());
+        }
+        for (size_t i = 0; i < order.size(); i++) ids.push_back({order[i], static_cast<long>(i)});
+        std::sort(ids.begin(), ids.end());
+    }
+
+    long id_of(const void* node) const {
+        if (node == nullptr) return -1;
+        auto it = std::lower_bound(ids.begin(), ids.end(), std::make_pair(node, 0L));
+        return it != ids.end() && it->first == node ? it->second : -2;
+    }
+
+    void append(const char* format, long long a, long long b = 0, long long c = 0) {
+        char buffer[96];
+        std::snprintf(buffer, sizeof(buffer), format, a, b, c);
+        out += buffer;
+    }
+
+    void table(const SymTable* table) {
+        if (table == nullptr) return;
+        append(" table %lld src %lld parent %lld:", table->id, id_of(table->source),
+               table->parent ? id_of(table->parent->source) : -1);
+        for (const TableEntry* entry = const_cast<SymTable*>(table)->begin();
+             entry != const_cast<SymTable*>(table)->end(); entry++) {
+            append(" %lld->%lld", entry->identifier, id_of(entry->decl));
+        }
+    }
+
+   public:
+    ProgramDump(Parser& parser, const ASTProgram& program) {
+        out = parser.dx.emit();
+        out.erase(out.rfind("\n-- Finished in"));  // Only the time differs
+        number(program);
+        for (size_t i = 0; i < order.size(); i++) {
+            const ASTNode& node = *order[i];
+            append("\n%lld %lld %lld", static_cast<long long>(node.nodeType), node.beginI, node.endI());
+            switch (node.nodeType) {
+                case NodeType::NAME: {
+                    auto& name = static_cast<const ASTName&>(node);
+                    append(" ref %lld decl %lld", name.ref, id_of(name.decl));
+                } break;
+                case NodeType::DECL: {
+                    auto& decl = static_cast<const ASTDecl&>(node);
+                    append(" type %lld assign %lld", decl.typeID, decl.assignType);
+                } break;
+                case NodeType::FUNC: {
+                    auto& func = static_cast<const ASTFunc&>(node);
+                    append(" signature %lld", func.signature);
+                    table(func.symbolTable);
+                } break;
+                case NodeType::PROGRAM:
+                    table(static_cast<const ASTProgram&>(node).symbolTable);
+                    break;
+                case NodeType::BLOCK:
+                    table(static_cast<const ASTBlock&>(node).symbolTable);
+                    break;
+                case NodeType::FOR:
+                    table(static_cast<const ASTFor&>(node).symbolTable);
+                    break;
+                case NodeType::MOD:
+                    table(static_cast<const ASTMod&>(node).symbolTable);
+                    break;
+                case NodeType::TYPE_DEF:
+                    table(static_cast<const ASTTy&>(node).symbolTable);
+                    break;
+                default:
+                    break;
+            }
+        }
+        for (TypeID type = 0; type < parser.types.size(); type++) {
+            out += "\n" + parser.types.to_str(type, parser.lexer.atoms);
+        }
+    }
+
+    inline size_t node_count() const { return order.size(); }
+    inline const std::string& str() const { return out; }
+};
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 5, 150000, "parallel_parse_bench.scft");
+    int numThreads = 4;
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::strcmp(argv[i], "-j") == 0) numThreads = std::atoi(argv[i + 1]);
+    }
+    std::string src = generate(args.size);
+    Bench::write_file(args.output, src);
+
+    size_t numChunks = 0, numNodes = 0;
+    std::string dumps[2];
+    for (int parallel = 0; parallel < 2; parallel++) {
+        Flags::numThreads = parallel ? numThreads : 1;
+        Parser parser;
+        parser.lexer.from_file_path(args.output.c_str());
+        ASTProgram* program = parser.parse_program();
+        ProgramDump dump(parser, *program);
+        dumps[parallel] = dump.str();
+        numChunks = parser.chunk_count();
+        numNodes = dump.node_count();
+    }
+    if (dumps[0] != dumps[1]) {
+        std::printf("Parsing in %zu chunks gave another program than parsing serially\n", numChunks);
+        return 1;
+    }
+
+    auto parse_ms = [&](int threads) {
+        Flags::numThreads = threads;
+        return Bench::best_ms(args.runs, [&] {
+            Parser parser;
+            parser.lexer.from_file_path(args.output.c_str());
+            parser.parse_program();
+        });
+    };
+    double serialMs = parse_ms(1);
+    double parallelMs = parse_ms(numThreads);
+
+    std::printf("%.1f MB, %zu nodes, best of %d\n", src.size() / 1e6, numNodes, args.runs);
+    std::printf("  lex and parse serially         %8.2f ms\n", serialMs);
+    std::printf("  lex and parse in %2zu chunks     %8.2f ms\n", numChunks, parallelMs);
+    return 0;
+}
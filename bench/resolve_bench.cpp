@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <string>
+
+#include "bench.hpp"
+#include "flags.hpp"
+#include "parser.hpp"
+
+// Time to parse a program of modules and functions with and without resolving its names afterwards
+
+namespace {
+
+std::string generate(size_t numFuncs) {
+    Bench::Random random(18);
+    std::string src;
+    for (size_t i = 0; i < numFuncs; i++) {
+        std::string n = std::to_string(i);
+        // Globals are used before and after their declaration
+        std::string global = "g" + std::to_string(random.below(static_cast<uint32_t>(numFuncs)));
+        src += "g" + n + ": Int = " + global + " + " + n + "\n";
+        if (i % 10 == 0) {
+            src += "M" + n + " = mod {\n    a: Int = b + g" + n + "\n    b: Int = " + n + "\n}\n";
+        }
+        src += "func" + n + " = (a: Int, b: Int) -> Int {\n";
+        src += "    x: Int = a + " + global + "\n";
+        src += "    for i = 0, i < b, i = i + 1 {\n";
+        src += "        x = x + i\n";
+        src += "        a: Int = x * " + global + "\n";  // Shadows the parameter
+        src += "        if a > b {\n            y: Int = a + x\n            x = y\n        }\n";
+        src += "    }\n";
+        src += "    return x + g" + n + "\n}\n\n";
+    }
+    return src;
+}
+
+double parse_ms(const Bench::Args& args, bool resolve) {
+    return Bench::best_ms(args.runs, [&] {
+        Parser parser;
+        parser.resolveNames = resolve;
+        parser.lexer.from_file_path(args.output.c_str());
+        parser.parse_program();
+    });
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 5, 50000, "resolve_bench.scft");
+    Bench::write_file(args.output, generate(args.size));
+    Flags::numThreads = 1;
+
+    double parseOnlyMs = parse_ms(args, false);
+    double resolveMs = parse_ms(args, true);
+
+    std::printf("%zu functions, best of %d\n", args.size, args.runs);
+    std::printf("  parse without resolving names   %8.2f ms\n", parseOnlyMs);
+    std::printf("  parse and resolve names         %8.2f ms\n", resolveMs);
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include <cstdio>
+#include <string>
+
+#include "bench.hpp"
+#include "lexer.hpp"
+#include "scan.hpp"
+
+// Throughput of skipping whitespace, line comments and block comments on a file which is mostly comment banners and
+// indentation, one character at a time like consume_token used to against the vectorized Scan functions
+
+namespace {
+
+std::string generate(size_t size) {
+    Bench::Random random(1);
+    std::string src;
+    for (size_t i = 0; src.size() < size; i++) {
+        src += "// " + std::string(20 + random.below(50), '=') + "\n";
+        if (random.chance(50)) src += "/* generated banner\n *  section " + std::to_string(i) + "\n */\n";
+        src += std::string(4 * (1 + random.below(4)), ' ') + "v" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+    }
+    return src;
+}
+
+inline bool is_whitespace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n'; }
+
+// Number of characters which aren't skipped
+template <bool VECTORIZED>
+size_t count_token_chars(const std::string& src) {
+    const char* s = src.data();
+    size_t i = 0, len = src.size(), count = 0;
+    while (i < len) {
+        if (VECTORIZED) {
+            i = Scan::skip_whitespace(s, i, len);
+        } else {
+            while (i < len && is_whitespace(s[i])) i++;
+        }
+        if (i >= len) break;
+        if (s[i] == '/' && i + 1 < len && s[i + 1] == '/') {
+            if (VECTORIZED) {
+                i = Scan::find_newline(s, i, len);
+            } else {
+                while (i < len && s[i] != '\n') i++;
+            }
+            i++;
+        } else if (s[i] == '/' && i + 1 < len && s[i + 1] == '*') {
+            size_t j = i + 1;
+            if (VECTORIZED) {
+                j = Scan::find_block_end(s, j, len);
+            } else {
+                while (j + 1 < len && !(s[j] == '*' && s[j + 1] == '/')) j++;
+                if (j + 1 >= len) j = len;
+            }
+            i = j + 2;
+        } else {
+            count++;
+            i++;
+        }
+    }
+    return count;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 5, 32 << 20, "scan_bench.scft");
+    std::string src = generate(args.size);
+    double mb = src.size() / 1e6;
+
+    size_t scalarCount = 0, vectorCount = 0;
+    double scalarMs = Bench::best_ms(args.runs, [&] { scalarCount = count_token_chars<false>(src); });
+    double vectorMs = Bench::best_ms(args.runs, [&] { vectorCount = count_token_chars<true>(src); });
+    if (scalarCount != vectorCount) {
+        std::printf("Skipped different characters: %zu and %zu\n", scalarCount, vectorCount);
+        return 1;
+    }
+
+    Bench::write_file(args.output, src);
+    size_t numTokens = 0;
+    double lexMs = Bench::best_ms(args.runs, [&] {
+        Lexer lexer;
+        lexer.from_file_path(args.output.c_str());
+        while (lexer.next_token().type != TokenType::END) {
+        }
+        numTokens = lexer.tokens.size();
+    });
+
+    std::printf("%.1f MB of comment banners, best of %d, %s:\n", mb, args.runs, Scan::isa_name());
+    std::printf("  skip one character at a time  %8.1f ms  %6.2f GB/s\n", scalarMs, mb / scalarMs);
+    std::printf("  skip with Scan                %8.1f ms  %6.2f GB/s\n", vectorMs, mb / vectorMs);
+    std::printf("  lex the whole file            %8.1f ms  %6.2f GB/s (%zu tokens)\n", lexMs, mb / lexMs, numTokens);
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "bench.hpp"
+#include "sym_tab.hpp"
+
+// Cost per insert and per find of SymTable against the chained table with 32 buckets it replaced, for scopes of 100,
+// 10k and 1M symbols. Atoms are spread out like those of declarations mixed with the other identifiers of a file
+
+namespace {
+
+// The table before SymTable: a fixed number of buckets with a list of separately allocated entries each
+class ChainedSymTable {
+    static constexpr int NUM_BUCKETS = 32;
+
+    struct Entry {
+        Entry* next;
+        AtomID identifier;
+        ASTDecl* decl;
+    };
+    Entry* table[NUM_BUCKETS] = {};
+
+   public:
+    ChainedSymTable() = default;
+    ChainedSymTable(const ChainedSymTable&) = delete;
+    ChainedSymTable& operator=(const ChainedSymTable&) = delete;
+    ~ChainedSymTable() {
+        for (Entry* cur : table) {
+            while (cur != nullptr) {
+                Entry* next = cur->next;
+                delete cur;
+                cur = next;
+            }
+        }
+    }
+
+    void insert(AtomID identifier, ASTDecl* decl) {
+        Entry*& head = table[identifier % NUM_BUCKETS];
+        head = new Entry{head, identifier, decl};
+    }
+    Entry* find(AtomID identifier) {
+        for (Entry* cur = table[identifier % NUM_BUCKETS]; cur != nullptr; cur = cur->next) {
+            if (cur->identifier == identifier) return cur;
+        }
+        return nullptr;
+    }
+};
+
+struct Result {
+    double insertNs = 1e300;
+    double hitNs = 1e300;
+    double missNs = 1e300;
+    size_t found = 0;
+};
+
+double per_op_ns(Bench::Clock::time_point start, Bench::Clock::time_point end, size_t ops) {
+    return Bench::elapsed_ms(start, end) * 1e6 / static_cast<double>(ops);
+}
+
+// Lookups visit the symbols in a scattered order. Every atom which is declared is followed by one which isn't
+template <class Table>
+Result run(size_t numSymbols, size_t numLookups, int runs) {
+    std::vector<AtomID> atoms(numSymbols);
+    for (size_t i = 0; i < numSymbols; i++) atoms[i] = static_cast<AtomID>(i * 3 + 1);
+
+    Result result;
+    for (int i = 0; i < runs; i++) {
+        Table table;
+        size_t found = 0;
+        auto start = Bench::Clock::now();
+        for (AtomID atom : atoms) table.insert(atom, nullptr);
+        auto inserted = Bench::Clock::now();
+        for (size_t j = 0; j < numLookups; j++) found += table.find(atoms[(j * 7919) % numSymbols]) != nullptr;
+        auto hit = Bench::Clock::now();
+        for (size_t j = 0; j < numLookups; j++) found += table.find(atoms[(j * 7919) % numSymbols] + 1) != nullptr;
+        auto missed = Bench::Clock::now();
+
+        result.insertNs = std::min(result.insertNs, per_op_ns(start, inserted, numSymbols));
+        result.hitNs = std::min(result.hitNs, per_op_ns(inserted, hit, numLookups));
+        result.missNs = std::min(result.missNs, per_op_ns(hit, missed, numLookups));
+        result.found = found;
+    }
+    return result;
+}
+
+void print(const char* name, size_t numSymbols, const Result& result) {
+    std::printf("  %-8s %8zu symbols  insert %8.1f ns  find %8.1f ns  miss %8.1f ns\n", name, numSymbols,
+                result.insertNs, result.hitNs, result.missNs);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 5, 1000000, "");
+    std::printf("Best of %d\n", args.runs);
+    for (size_t numSymbols : {size_t{100}, size_t{10000}, args.size}) {
+        // Every find walks a 32nd of a chained table, so it only gets a few thousand lookups once the scope is large
+        size_t chainedLookups = std::min(numSymbols, size_t{2000});
+        // Small scopes are run many times over so that the time isn't only the clock's resolution
+        int runs = numSymbols < 1000 ? args.runs * 1000 : args.runs;
+        Result chained = run<ChainedSymTable>(numSymbols, chainedLookups, numSymbols > 10000 ? 1 : runs);
+        Result open = run<SymTable>(numSymbols, numSymbols, runs);
+        if (chained.found != chainedLookups || open.found != numSymbols) {
+            std::printf("A table lost symbols\n");
+            return 1;
+        }
+        print("chained", numSymbols, chained);
+        print("SymTable", numSymbols, open);
+    }
+    return 0;
+}
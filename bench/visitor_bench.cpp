@@ -0,0 +1,152 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ast_visitor.hpp"
+#include "bench.hpp"
+#include "flags.hpp"
+#include "parser.hpp"
+
+// Time for three passes over the AST of a program of nested blocks to traverse the tree one after the other against
+// all at once with FusedVisitor. Each pass skips a different kind of subtree so the fused traversal has to track them
+
+namespace {
+
+void statements(Bench::Random& random, int depth, const std::string& indent, std::string& out) {
+    uint32_t numStatements = 3 + random.below(4);
+    for (uint32_t i = 0; i < numStatements; i++) {
+        std::string v = "v" + std::to_string(depth) + "_" + std::to_string(i);
+        uint32_t kind = random.below(10);
+        if (depth < 3 && kind < 3) {
+            out += indent + "if " + v + " < " + std::to_string(random.below(100)) + " {\n";
+            statements(random, depth + 1, indent + "    ", out);
+            out += indent + "}\n";
+        } else if (depth < 3 && kind < 4) {
+            out += indent + "for i = 0, i < 10, i = i + 1 {\n";
+            statements(random, depth + 1, indent + "    ", out);
+            out += indent + "}\n";
+        } else if (kind < 7) {
+            out += indent + v + ": Int = a * " + std::to_string(random.below(1 << 20)) + " + b\n";
+        } else {
+            out += indent + "g(a, " + v + ", " + std::to_string(random.below(1000)) + ")\n";
+        }
+    }
+    if (depth > 0 && random.chance(30)) out += indent + "return a\n";
+}
+
+std::string generate(size_t numFuncs) {
+    Bench::Random random(13);
+    std::string src;
+    for (size_t i = 0; i < numFuncs; i++) {
+        std::string n = std::to_string(i);
+        src += "Point" + n + " = ty {\n    x: Int = " + std::to_string(random.below(1 << 20)) + "\n    y: Int\n}\n\n";
+        src += "func" + n + " = (a: Int, b: Int) -> Int {\n";
+        statements(random, 0, "    ", src);
+        src += "    return a\n}\n\n";
+    }
+    return src;
+}
+
+// Return, break and continue statements
+struct Exits : ASTVisitor<Exits> {
+    using ASTVisitor::enter;
+    size_t found = 0;
+
+    bool enter(const ASTBlock& block) {
+        for (size_t i = 0; i < block.statements.size(); i++) {
+            NodeType type = block.statements[i]->nodeType;
+            if (type == NodeType::RET || type == NodeType::BREAK || type == NodeType::CONT) found++;
+        }
+        return true;
+    }
+    // Expressions can't hold statements
+    bool enter(const ASTBinOp&) { return false; }
+    bool enter(const ASTCall&) { return false; }
+};
+
+// Declared and used names and how deep blocks nest
+struct Names : ASTVisitor<Names> {
+    using ASTVisitor::enter;
+    using ASTVisitor::leave;
+    std::vector<TokenID> declared;
+    size_t uses = 0;
+    size_t depth = 0;
+    size_t maxDepth = 0;
+
+    bool enter(const ASTDecl& decl) {
+        if (decl.lvalue->nodeType == NodeType::NAME) declared.push_back(static_cast<const ASTName*>(decl.lvalue)->ref);
+        return true;
+    }
+    bool enter(const ASTName&) {
+        uses++;
+        return true;
+    }
+    bool enter(const ASTBlock&) {
+        if (++depth > maxDepth) maxDepth = depth;
+        return true;
+    }
+    void leave(const ASTBlock&) { depth--; }
+};
+
+// Int literals outside of statements which don't fit in 16 bits
+struct Literals : ASTVisitor<Literals> {
+    using ASTVisitor::enter;
+    const TokenList& tokens;
+    size_t wide = 0;
+    size_t seen = 0;
+
+    explicit Literals(const TokenList& tokens) : tokens(tokens) {}
+
+    bool enter(const ASTLit& lit) {
+        seen++;
+        if (tokens.type(lit.value) == TokenType::INT_LITERAL && tokens.long_val(lit.value) > 0xffff) wide++;
+        return true;
+    }
+    bool enter(const ASTTy&) { return false; }  // Field defaults are checked with their type
+};
+
+size_t summary(const Exits& exits, const Names& names, const Literals& literals) {
+    return exits.found * 1000003 + names.declared.size() * 1009 + names.uses * 7 + names.maxDepth +
+           literals.wide * 31 + literals.seen * 3;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Bench::Args args(argc, argv, 7, 20000, "visitor_bench.scft");
+    Bench::write_file(args.output, generate(args.size));
+    Flags::numThreads = 1;
+
+    Parser parser;
+    parser.lexer.from_file_path(args.output.c_str());
+    ASTProgram* program = parser.parse_program();
+    const TokenList& tokens = parser.lexer.tokens;
+
+    size_t separate = 0, fused = 0;
+    double separateMs = Bench::best_ms(args.runs, [&] {
+        Exits exits;
+        Names names;
+        Literals literals(tokens);
+        exits.traverse(*program);
+        names.traverse(*program);
+        literals.traverse(*program);
+        separate = summary(exits, names, literals);
+    });
+    double fusedMs = Bench::best_ms(args.runs, [&] {
+        Exits exits;
+        Names names;
+        Literals literals(tokens);
+        FusedVisitor<Exits, Names, Literals> passes(exits, names, literals);
+        passes.traverse(*program);
+        fused = summary(exits, names, literals);
+    });
+    if (separate != fused) {
+        std::printf("Fused passes found something else\n");
+        return 1;
+    }
+
+    std::printf("%zu functions, %zu tokens, best of %d\n", args.size, tokens.size(), args.runs);
+    std::printf("  three traversals     %8.2f ms\n", separateMs);
+    std::printf("  one fused traversal  %8.2f ms\n", fusedMs);
+    return 0;
+}
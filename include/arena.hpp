@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bump pointer allocator. Everything allocated from an arena is freed at once when the arena is destroyed without
+// running any destructors, so only trivially destructible objects can be made in it
+class Arena {
+    struct Block {
+        Block* prev;
+        size_t size;  // Including the header
+    };
+    Block* head = nullptr;
+    Block* spare = nullptr;  // Most recent block freed by rewind, kept so rewinding in a loop doesn't reallocate it
+    char* cur = nullptr;
+    char* end = nullptr;
+
+    size_t nextBlockSize;
+    size_t reserved = 0;  // Bytes of every block including what hasn't been handed out yet
+
+    void* allocate_slow(size_t size, size_t align);
+
+   public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 16;
+
+    explicit Arena(size_t firstBlockSize = DEFAULT_BLOCK_SIZE) : nextBlockSize(firstBlockSize) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena();
+
+    inline void* allocate(size_t size, size_t align) {
+        size_t padding = -reinterpret_cast<uintptr_t>(cur) & (align - 1);
+        if (size + padding > static_cast<size_t>(end - cur)) return allocate_slow(size, align);
+        char* mem = cur + padding;
+        cur = mem + size;
+        return mem;
+    }
+
+    template <class T, class... Args>
+    inline T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible<T>::value, "Destructors of arena objects are never run");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Uninitialized storage for count objects of type T
+    template <class T>
+    inline T* make_array(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "Destructors of arena objects are never run");
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Everything allocated after a mark is freed by rewinding to it
+    struct Mark {
+        Block* head;
+        char* cur;
+    };
+    inline Mark mark() const { return {head, cur}; }
+    void rewind(const Mark& mark);
+
+    // Take over every block of other, which is left empty. Objects made in other stay where they are and are freed
+    // along with this arena. Marks taken before may no longer be rewound to
+    void absorb(Arena& other);
+
+    inline size_t memory_usage() const { return reserved; }
+};
+
+// Growable array of trivially copyable elements. The first N elements are stored in the list itself, after which the
+// elements move to storage in an arena. Growing leaves the old storage in the arena until the arena is destroyed, so
+// the list never has to be freed either
+template <class T, uint32_t N = 0>
+class ArenaList {
+    static_assert(std::is_trivially_copyable<T>::value, "Elements are moved with plain copies when the list grows");
+    static constexpr uint32_t MIN_ARENA_CAPACITY = 4;
+
+    // The pointer to the arena storage replaces the inline elements once they have been copied into it
+    union {
+        T inlineElems[N > 0 ? N : 1];
+        T* arenaElems;
+    };
+    uint32_t count = 0;
+    uint32_t capacity = N;
+
+    inline bool is_inline() const { return capacity <= N; }
+    inline T* data() { return is_inline() ? inlineElems : arenaElems; }
+    inline const T* data() const { return is_inline() ? inlineElems : arenaElems; }
+
+    void grow(Arena& arena) {
+        uint32_t newCapacity = capacity < MIN_ARENA_CAPACITY ? MIN_ARENA_CAPACITY : capacity * 2;
+        T* newElems = arena.make_array<T>(newCapacity);
+        T* elems = data();
+        for (uint32_t i = 0; i < count; i++) newElems[i] = elems[i];
+        arenaElems = newElems;
+        capacity = newCapacity;
+    }
+
+   public:
+    ArenaList() : arenaElems(nullptr) {}
+
+    inline void push_back(Arena& arena, T elem) {
+        if (count == capacity) grow(arena);
+        data()[count++] = elem;
+    }
+
+    inline size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+
+    inline T& operator[](size_t i) { return data()[i]; }
+    inline const T& operator[](size_t i) const { return data()[i]; }
+    inline T& front() { return data()[0]; }
+    inline T& back() { return data()[count - 1]; }
+
+    inline T* begin() { return data(); }
+    inline T* end() { return data() + count; }
+    inline const T* begin() const { return data(); }
+    inline const T* end() const { return data() + count; }
+};
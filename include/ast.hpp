@@ -1,13 +1,17 @@
 #pragma once
 
-#include <memory>
+#include <cstdint>
+#include <iosfwd>
 #include <string>
-#include <vector>
 
+#include "arena.hpp"
 #include "sym_tab.hpp"
+#include "type_table.hpp"
 
 enum class TokenType : unsigned char;
 struct Token;
+class TokenList;
+using TokenID = uint32_t;
 
 enum class NodeType : unsigned char {
     UNKNOWN,
@@ -71,40 +75,56 @@ struct ASTBinOp;
 
 inline bool is_expression_type(NodeType nodeType) { return nodeType >= NodeType::TYPE_LIT; }
 
+// Child lists which almost always hold only a few nodes keep them inside the parent node
 template <class T>
-inline std::unique_ptr<T> make_node(const Token& tkn) {
-    auto node = std::make_unique<T>();
-    node->beginI = tkn.beginI;
-    node->endI = tkn.endI;
+using NodeList = ArenaList<T*, 4>;
+
+// Takes the node out of nodePtr like moving out of it would
+template <class T1, class T2>
+inline T1* cast_node_ptr(T2*& nodePtr) {
+    T1* node = static_cast<T1*>(nodePtr);
+    nodePtr = nullptr;
     return node;
 }
 
+// The location of a node is packed into 8 bytes as its begin and its length. Lengths past MAX_LENGTH are clamped,
+// which only shortens the underline of an error on a node spanning more than 16MB and so more than one line
+struct ASTNode {
+    static constexpr uint32_t MAX_LENGTH = (1u << 24) - 1;
+
+    NodeType nodeType : 8;
+    uint32_t length : 24;
+    int beginI;
+    explicit ASTNode(NodeType nodeType) : nodeType(nodeType), length(0) {}
+
+    inline int endI() const { return beginI + static_cast<int>(length); }
+    inline void set_end(int endI) {
+        uint32_t len = static_cast<uint32_t>(endI - beginI);
+        length = len < MAX_LENGTH ? len : MAX_LENGTH;
+    }
+};
+static_assert(sizeof(ASTNode) == 8, "Every node starts with an ASTNode so it should stay small");
+
+// Nodes are allocated in an arena which owns the whole AST, so they are never freed on their own
 template <class T>
-inline std::unique_ptr<T> make_node(const ASTNode& nodeLoc) {
-    auto node = std::make_unique<T>();
-    node->beginI = nodeLoc.beginI;
-    node->endI = nodeLoc.endI;
+inline T* make_node(Arena& arena, int beginI, int endI) {
+    T* node = arena.make<T>();
+    node->beginI = beginI;
+    node->set_end(endI);
     return node;
 }
 
-template <class T1, class T2>
-inline std::unique_ptr<T1> cast_node_ptr(std::unique_ptr<T2>& nodePtr) {
-    return std::unique_ptr<T1>(static_cast<T1*>(nodePtr.release()));
+template <class T>
+inline T* make_node(Arena& arena, const ASTNode& nodeLoc) {
+    return make_node<T>(arena, nodeLoc.beginI, nodeLoc.endI());
 }
 
-struct ASTNode {
-    NodeType nodeType;
-    int beginI;
-    int endI;
-    explicit ASTNode(NodeType nodeType) : nodeType(nodeType) {}
-};
-
 template <class T>
-inline std::unique_ptr<T> unknown_node(int beginI, int endI) {
-    auto unknown = std::make_unique<T>();
+inline T* unknown_node(Arena& arena, int beginI, int endI) {
+    T* unknown = arena.make<T>();
     unknown->nodeType = NodeType::UNKNOWN;
     unknown->beginI = beginI;
-    unknown->endI = endI;
+    unknown->set_end(endI);
     return unknown;
 }
 
@@ -114,29 +134,31 @@ struct ASTExpression : ASTNode {
 };
 
 struct ASTProgram : ASTNode {
-    std::vector<std::unique_ptr<ASTDecl>> declarations;
+    SymTable* symbolTable = nullptr;
+    ArenaList<ASTDecl*> declarations;  // Usually far too many to keep inline
     ASTProgram() : ASTNode(NodeType::PROGRAM) {}
 };
 
 struct ASTBlock : ASTNode {
-    std::unique_ptr<SymTable> symbolTable;
-    std::vector<std::unique_ptr<ASTNode>> statements;  // A statement can be anything excluding ASTProgram
+    SymTable* symbolTable = nullptr;
+    NodeList<ASTNode> statements;  // A statement can be anything excluding ASTProgram
     ASTBlock() : ASTNode(NodeType::BLOCK) {}
 };
 
 struct ASTIf : ASTNode {
-    std::unique_ptr<ASTExpression> condition;
-    std::unique_ptr<ASTNode> conseq;  // Consequence
-    std::unique_ptr<ASTNode> alt;     // Alternative can be either an if statement or else block
+    ASTExpression* condition = nullptr;
+    ASTNode* conseq = nullptr;  // Consequence
+    ASTNode* alt = nullptr;     // Alternative can be either an if statement or else block
     ASTIf() : ASTNode(NodeType::IF) {}
 };
 
 struct ASTFor : ASTNode {
-    std::unique_ptr<ASTNode> initial;
-    std::unique_ptr<ASTExpression> condition;
-    std::unique_ptr<ASTNode> post;
+    SymTable* symbolTable = nullptr;  // Names declared by the initial statement
+    ASTNode* initial = nullptr;
+    ASTExpression* condition = nullptr;
+    ASTNode* post = nullptr;
 
-    std::unique_ptr<ASTNode> blockStmt;
+    ASTNode* blockStmt = nullptr;
     ASTFor() : ASTNode(NodeType::FOR) {}
 };
 
@@ -149,16 +171,22 @@ struct ASTCont : ASTNode {
 };
 
 struct ASTRet : ASTNode {
-    std::unique_ptr<ASTExpression> retValue;
+    ASTExpression* retValue = nullptr;
     ASTRet() : ASTNode(NodeType::RET) {}
 };
 
-struct ASTDecl : ASTNode {
-    std::unique_ptr<ASTExpression> lvalue;
-    std::unique_ptr<ASTExpression> type;
+// How far constant folding got with a => declaration. The rvalue of a CONSTANT is a literal with its value
+enum class FoldState : unsigned char { UNFOLDED, FOLDING, NOT_CONSTANT, CONSTANT };
 
-    Token* assignType;
-    std::unique_ptr<ASTExpression> rvalue;
+struct ASTDecl : ASTNode {
+    ASTExpression* lvalue = nullptr;
+    ASTExpression* type = nullptr;
+
+    TokenID assignType;  // NULL_TOKEN if the declaration has no assignment
+    TypeID typeID = NULL_TYPE;  // Canonical type of the annotation if there is one
+    ASTExpression* rvalue = nullptr;
+    uint32_t checkID = UINT32_MAX;  // Index of the declaration in the type checker once it has been seen
+    FoldState foldState = FoldState::UNFOLDED;
     ASTDecl() : ASTNode(NodeType::DECL) {}
 };
 
@@ -168,75 +196,82 @@ struct ASTTypeLit : ASTExpression {
 };
 
 struct ASTFuncType : ASTExpression {
-    std::vector<std::unique_ptr<ASTExpression>> inTypes;
-    std::unique_ptr<ASTExpression> outType;
+    NodeList<ASTExpression> inTypes;
+    ASTExpression* outType = nullptr;
     ASTFuncType() : ASTExpression(NodeType::FUNC_TYPE) {}
 };
 
 struct ASTMod : ASTExpression {
-    std::vector<std::unique_ptr<ASTDecl>> declarations;
+    SymTable* symbolTable = nullptr;
+    NodeList<ASTDecl> declarations;
     ASTMod() : ASTExpression(NodeType::MOD) {}
 };
 
 struct ASTTy : ASTExpression {
-    std::vector<std::unique_ptr<ASTDecl>> declarations;
+    SymTable* symbolTable = nullptr;
+    NodeList<ASTDecl> declarations;
     ASTTy() : ASTExpression(NodeType::TYPE_DEF) {}
 };
 
 struct ASTFunc : ASTExpression {
-    std::vector<std::unique_ptr<ASTDecl>> parameters;
-    std::unique_ptr<ASTExpression> returnType;
-    std::unique_ptr<ASTNode> blockOrExpr;
+    TypeID signature = NULL_TYPE;  // NULL_TYPE unless every parameter has a type annotation
+    SymTable* symbolTable = nullptr;
+    NodeList<ASTDecl> parameters;
+    ASTExpression* returnType = nullptr;
+    ASTNode* blockOrExpr = nullptr;
     ASTFunc() : ASTExpression(NodeType::FUNC) {}
 };
 
 struct ASTName : ASTExpression {
-    Token* ref;
+    TokenID ref;
+    ASTDecl* decl = nullptr;  // Declaration the name refers to or nullptr if it wasn't resolved
     ASTName() : ASTExpression(NodeType::NAME) {}
 };
 
 struct ASTDotOp : ASTExpression {
-    std::unique_ptr<ASTExpression> base;
-    std::unique_ptr<ASTName> member;
+    ASTExpression* base = nullptr;
+    ASTName* member = nullptr;
     ASTDotOp() : ASTExpression(NodeType::DOT_OP) {}
 };
 
 struct ASTCall : ASTExpression {
-    std::unique_ptr<ASTExpression> callRef;
-    std::vector<std::unique_ptr<ASTExpression>> arguments;
+    ASTExpression* callRef = nullptr;
+    NodeList<ASTExpression> arguments;
     ASTCall() : ASTExpression(NodeType::CALL) {}
 };
 
 struct ASTTypeInit : ASTExpression {
-    std::unique_ptr<ASTExpression> typeRef;
-    std::vector<std::unique_ptr<ASTDecl>> assignments;
+    ASTExpression* typeRef = nullptr;
+    NodeList<ASTDecl> assignments;
     ASTTypeInit() : ASTExpression(NodeType::TYPE_INIT) {}
 };
 
 struct ASTLit : ASTExpression {
-    Token* value;
+    TokenID value;
     ASTLit() : ASTExpression(NodeType::LIT) {}
 };
 
 struct ASTUnOp : ASTExpression {
-    Token* op;
-    std::unique_ptr<ASTExpression> inner;
+    TokenID op;
+    ASTExpression* inner = nullptr;
     ASTUnOp() : ASTExpression(NodeType::UN_OP) {}
 };
 
 struct ASTDeref : ASTExpression {
-    std::unique_ptr<ASTExpression> inner;
+    ASTExpression* inner = nullptr;
     ASTDeref() : ASTExpression(NodeType::DEREF) {}
 };
 
 struct ASTBinOp : ASTExpression {
-    std::unique_ptr<ASTExpression> left;
-    Token* op;
-    std::unique_ptr<ASTExpression> right;
+    ASTExpression* left = nullptr;
+    TokenID op;
+    ASTExpression* right = nullptr;
     ASTBinOp() : ASTExpression(NodeType::BIN_OP) {}
 };
 
-void dump_ast(const ASTNode& node, bool verbose);
+void dump_ast(const ASTNode& node, const TokenList& tokens, bool verbose);
 
-std::string print_ast(const ASTNode& node);
-std::string print_expr(const ASTExpression& expr);
\ No newline at end of file
+void print_ast(const ASTNode& node, const TokenList& tokens, std::ostream& stream);
+std::string print_ast(const ASTNode& node, const TokenList& tokens);
+std::string print_expr(const ASTExpression& expr, const TokenList& tokens);
+std::string print_literal(TokenID value, const TokenList& tokens);
\ No newline at end of file
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+
+// Calls f with the node cast to its concrete type. Unknown nodes are passed as a plain ASTNode since they can have been
+// made as any type of node
+template <class F>
+inline decltype(auto) dispatch_node(const ASTNode& node, F&& f) {
+    switch (node.nodeType) {
+        case NodeType::PROGRAM:
+            return f(static_cast<const ASTProgram&>(node));
+        case NodeType::BLOCK:
+            return f(static_cast<const ASTBlock&>(node));
+        case NodeType::IF:
+            return f(static_cast<const ASTIf&>(node));
+        case NodeType::FOR:
+            return f(static_cast<const ASTFor&>(node));
+        case NodeType::BREAK:
+            return f(static_cast<const ASTBreak&>(node));
+        case NodeType::CONT:
+            return f(static_cast<const ASTCont&>(node));
+        case NodeType::RET:
+            return f(static_cast<const ASTRet&>(node));
+        case NodeType::DECL:
+            return f(static_cast<const ASTDecl&>(node));
+        case NodeType::TYPE_LIT:
+            return f(static_cast<const ASTTypeLit&>(node));
+        case NodeType::FUNC_TYPE:
+            return f(static_cast<const ASTFuncType&>(node));
+        case NodeType::MOD:
+            return f(static_cast<const ASTMod&>(node));
+        case NodeType::TYPE_DEF:
+            return f(static_cast<const ASTTy&>(node));
+        case NodeType::FUNC:
+            return f(static_cast<const ASTFunc&>(node));
+        case NodeType::NAME:
+            return f(static_cast<const ASTName&>(node));
+        case NodeType::DOT_OP:
+            return f(static_cast<const ASTDotOp&>(node));
+        case NodeType::CALL:
+            return f(static_cast<const ASTCall&>(node));
+        case NodeType::TYPE_INIT:
+            return f(static_cast<const ASTTypeInit&>(node));
+        case NodeType::LIT:
+            return f(static_cast<const ASTLit&>(node));
+        case NodeType::UN_OP:
+            return f(static_cast<const ASTUnOp&>(node));
+        case NodeType::DEREF:
+            return f(static_cast<const ASTDeref&>(node));
+        case NodeType::BIN_OP:
+            return f(static_cast<const ASTBinOp&>(node));
+        default:
+            return f(node);
+    }
+}
+
+// Calls f with every child of the node in source order. Missing children which a type of node can have, like the
+// alternative of an if statement without an else, are passed as nullptr
+template <class F>
+inline void for_each_child(const ASTNode& node, F&& f) {
+    auto each = [&](const auto& list) {
+        for (const ASTNode* child : list) f(child);
+    };
+    switch (node.nodeType) {
+        case NodeType::PROGRAM:
+            each(static_cast<const ASTProgram&>(node).declarations);
+            break;
+        case NodeType::BLOCK:
+            each(static_cast<const ASTBlock&>(node).statements);
+            break;
+        case NodeType::IF: {
+            auto& ifStmt = static_cast<const ASTIf&>(node);
+            f(ifStmt.condition);
+            f(ifStmt.conseq);
+            f(ifStmt.alt);
+        } break;
+        case NodeType::FOR: {
+            auto& forLoop = static_cast<const ASTFor&>(node);
+            f(forLoop.initial);
+            f(forLoop.condition);
+            f(forLoop.post);
+            f(forLoop.blockStmt);
+        } break;
+        case NodeType::RET:
+            f(static_cast<const ASTRet&>(node).retValue);
+            break;
+        case NodeType::DECL: {
+            auto& decl = static_cast<const ASTDecl&>(node);
+            f(decl.lvalue);
+            f(decl.type);
+            f(decl.rvalue);
+        } break;
+        case NodeType::FUNC_TYPE: {
+            auto& funcType = static_cast<const ASTFuncType&>(node);
+            each(funcType.inTypes);
+            f(funcType.outType);
+        } break;
+        case NodeType::MOD:
+            each(static_cast<const ASTMod&>(node).declarations);
+            break;
+        case NodeType::TYPE_DEF:
+            each(static_cast<const ASTTy&>(node).declarations);
+            break;
+        case NodeType::FUNC: {
+            auto& func = static_cast<const ASTFunc&>(node);
+            each(func.parameters);
+            f(func.returnType);
+            f(func.blockOrExpr);
+        } break;
+        case NodeType::DOT_OP: {
+            auto& dotOp = static_cast<const ASTDotOp&>(node);
+            f(dotOp.base);
+            f(dotOp.member);
+        } break;
+        case NodeType::CALL: {
+            auto& call = static_cast<const ASTCall&>(node);
+            f(call.callRef);
+            each(call.arguments);
+        } break;
+        case NodeType::TYPE_INIT: {
+            auto& typeInit = static_cast<const ASTTypeInit&>(node);
+            f(typeInit.typeRef);
+            each(typeInit.assignments);
+        } break;
+        case NodeType::UN_OP:
+            f(static_cast<const ASTUnOp&>(node).inner);
+            break;
+        case NodeType::DEREF:
+            f(static_cast<const ASTDeref&>(node).inner);
+            break;
+        case NodeType::BIN_OP: {
+            auto& binOp = static_cast<const ASTBinOp&>(node);
+            f(binOp.left);
+            f(binOp.right);
+        } break;
+        default:
+            break;
+    }
+}
+
+// Base of passes over the AST. The pass derives from ASTVisitor<Pass> and overloads enter and leave for the types of
+// node it cares about, with `using ASTVisitor::enter;` and `using ASTVisitor::leave;` keeping the defaults for the
+// rest. Every call is resolved at compile time so there are no virtual calls, and the tree is walked with an explicit
+// stack so deep trees can't overflow the call stack.
+//
+// enter is called in pre-order and returns whether to visit the children of the node. leave is called in post-order,
+// even when the children were skipped
+template <class Derived>
+class ASTVisitor {
+    struct Frame {
+        const ASTNode* node;
+        bool entered;
+    };
+    std::vector<Frame> stack;
+
+   public:
+    template <class T>
+    inline bool enter(const T&) {
+        return true;
+    }
+
+    template <class T>
+    inline void leave(const T&) {}
+
+    void traverse(const ASTNode& root) {
+        Derived& pass = static_cast<Derived&>(*this);
+        stack.push_back({&root, false});
+        while (!stack.empty()) {
+            Frame frame = stack.back();
+            stack.pop_back();
+
+            if (!frame.entered && dispatch_node(*frame.node, [&](const auto& node) { return pass.enter(node); })) {
+                // Children are pushed in source order and then reversed so that they come off the stack in order
+                stack.push_back({frame.node, true});
+                size_t firstChild = stack.size();
+                for_each_child(*frame.node, [&](const ASTNode* child) {
+                    if (child != nullptr) stack.push_back({child, false});
+                });
+                std::reverse(stack.begin() + firstChild, stack.end());
+            } else {
+                dispatch_node(*frame.node, [&](const auto& node) { pass.leave(node); });
+            }
+        }
+    }
+};
+
+// Runs several passes in a single traversal of the tree. Each pass sees exactly the calls it would see traversing the
+// tree on its own, so the children a pass skips are hidden from it even while the other passes visit them
+template <class... Passes>
+class FusedVisitor : public ASTVisitor<FusedVisitor<Passes...>> {
+    std::tuple<Passes&...> passes;
+    std::array<const ASTNode*, sizeof...(Passes)> skipping{};  // Node whose children each pass is skipping, if any
+
+    template <class F, size_t... I>
+    inline void for_each_pass(F&& f, std::index_sequence<I...>) {
+        (f(std::get<I>(passes), skipping[I]), ...);
+    }
+    template <class F>
+    inline void for_each_pass(F&& f) {
+        for_each_pass(f, std::index_sequence_for<Passes...>());
+    }
+
+   public:
+    explicit FusedVisitor(Passes&... passes) : passes(passes...) {}
+
+    template <class T>
+    inline bool enter(const T& node) {
+        bool descend = false;
+        for_each_pass([&](auto& pass, const ASTNode*& skipped) {
+            if (skipped != nullptr) return;
+            if (pass.enter(node)) {
+                descend = true;
+            } else {
+                skipped = &node;
+            }
+        });
+        return descend;
+    }
+
+    template <class T>
+    inline void leave(const T& node) {
+        for_each_pass([&](auto& pass, const ASTNode*& skipped) {
+            if (skipped == &node) skipped = nullptr;
+            if (skipped == nullptr) pass.leave(node);
+        });
+    }
+};
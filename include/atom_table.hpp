@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// Index of a distinct identifier or string literal in an AtomTable. Equal atoms always have equal spellings
+using AtomID = uint32_t;
+constexpr AtomID NULL_ATOM = UINT32_MAX;
+
+// Interns the spellings of identifiers and string literals so that they can be compared by id. Spellings are views
+// into the source buffer which must outlive the table. The hash of every atom is computed once when it is interned
+class AtomTable {
+    // Short spellings are compared using only the slot. Only spellings longer than 8 characters are compared in full
+    struct Slot {
+        uint64_t prefix;  // First 8 characters of the spelling padded with zeros
+        uint32_t hash;
+        uint32_t length;
+        AtomID atom;  // NULL_ATOM if the slot is empty
+    };
+    std::vector<Slot> slots;  // Open addressing with linear probing. The size is always a power of 2
+    std::vector<std::string_view> spellings;
+    std::vector<uint32_t> hashes;
+
+    void grow();
+
+   public:
+    static uint32_t hash_str(std::string_view str);
+
+    void clear();
+
+    AtomID intern(std::string_view str) { return intern(str, hash_str(str)); }
+    AtomID intern(std::string_view str, uint32_t hash);
+
+    inline std::string_view str(AtomID atom) const { return spellings[atom]; }
+    inline uint32_t hash(AtomID atom) const { return hashes[atom]; }
+    inline size_t size() const { return spellings.size(); }
+};
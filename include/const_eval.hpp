@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+#include "diagnostics.hpp"
+#include "lexer.hpp"
+
+class ConstFolder;
+
+// Value of an expression which is known while compiling
+struct ConstValue {
+    TokenType type = TokenType::UNKNOWN;  // INT_LITERAL, DOUBLE_LITERAL, TRUE or FALSE. UNKNOWN if it isn't constant
+    char suffix = 0;                      // 'l' for a long int and 'f' for a float like the suffix of a literal
+    long long intVal = 0;
+    double doubleVal = 0;
+
+    inline bool is_constant() const { return type != TokenType::UNKNOWN; }
+};
+
+// Runs calls of => functions whose arguments are constant while folding. A function only runs if everything it reads
+// is a parameter, one of its own variables or a constant, it only assigns its own variables and every value it works
+// with is an int, double or bool. Anything else, like an operator which overflows, means the call isn't constant and
+// is left for the program to run, without a diagnostic.
+// Results are remembered by function and argument values, so each distinct call runs once per compilation however
+// often it is written or recursed into. A call which takes more steps than -fuel allows or nests calls too deeply is
+// given up on and reported once at the place it was first written
+class ConstEvaluator {
+    static constexpr uint32_t NO_CALL = UINT32_MAX;
+
+    enum class Flow : unsigned char { NEXT, BREAK, CONTINUE, RETURN, FAIL };
+    enum class Abort : unsigned char { NONE, OUT_OF_FUEL, TOO_DEEP };
+
+    struct Local {
+        const ASTDecl* decl;
+        ConstValue value;
+    };
+    struct Call {
+        const ASTFunc* func;
+        uint32_t firstArg;  // Index in the argument values of the table
+        uint32_t numArgs;
+        ConstValue result;
+    };
+    struct Slot {
+        uint32_t hash;
+        uint32_t call;  // NO_CALL if the slot is empty
+    };
+
+    ConstFolder& folder;
+    const TokenList& tokens;
+    Diagnostics& dx;
+
+    // Remembered calls. Open addressing with linear probing, the size is always a power of 2
+    std::vector<Slot> slots;
+    std::vector<Call> calls;
+    std::vector<ConstValue> callArgs;
+
+    std::vector<ConstValue> args;  // Arguments of the calls being set up, innermost last
+    std::vector<Local> locals;     // Variables of the calls being run, innermost last
+    size_t frameBase = 0;          // First variable of the innermost call
+    ConstValue returned;           // Value of the last return statement
+
+    bool running = false;
+    uint32_t depth = 0;
+    long long fuel = 0;
+    Abort abort = Abort::NONE;
+
+    size_t numHits = 0;
+
+    void grow();
+    uint32_t find(uint32_t hash, const ASTFunc& func, size_t firstArg, uint32_t numArgs) const;
+    void remember(uint32_t hash, const ASTFunc& func, size_t firstArg, uint32_t numArgs, const ConstValue& result);
+
+    ConstValue run(const ASTFunc& func, size_t firstArg);  // Arguments from firstArg on in args
+    Flow exec(const ASTNode& stmt);
+    Flow exec_decl(const ASTDecl& decl);
+    ConstValue eval(const ASTExpression& expr);
+    ConstValue eval_call(const ASTCall& call);
+    ConstValue* local(const ASTDecl& decl);
+
+    inline bool use_fuel() {
+        if (abort != Abort::NONE) return false;
+        if (fuel == 0) {
+            abort = Abort::OUT_OF_FUEL;
+            return false;
+        }
+        fuel--;
+        return true;
+    }
+
+   public:
+    ConstEvaluator(ConstFolder& folder, const TokenList& tokens, Diagnostics& dx)
+        : folder(folder), tokens(tokens), dx(dx) {}
+
+    // Function a call runs if it can be run while compiling or nullptr
+    const ASTFunc* function_of(const ASTExpression& callRef) const;
+
+    // Value of calling func with the constant arguments or nothing if the call isn't constant
+    ConstValue call(const ASTCall& call, const ASTFunc& func, const ConstValue* argValues);
+
+    inline size_t call_count() const { return calls.size(); }
+    inline size_t memo_hit_count() const { return numHits; }
+};
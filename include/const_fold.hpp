@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+#include "const_eval.hpp"
+#include "diagnostics.hpp"
+#include "lexer.hpp"
+
+// Replaces operators whose operands are all literals or => constants with the literal they evaluate to. Operators
+// follow the rules of literals: an int has to fit in 32 bits unless an l suffix made one of its operands a long and a
+// float is rounded to a float. An operator which overflows, divides by zero or shifts too far is reported and left
+// as it is, along with the expression it is part of. Calls of => functions with constant arguments are run by a
+// ConstEvaluator and replaced with their result.
+// A folded expression is overwritten in place by a literal whose token is added to the end of the token list, so
+// nothing which points to the expression has to change. Constants can be used before they appear, so a constant is
+// folded the first time it is needed. The walk keeps its work on an explicit stack so long chains of operators can't
+// overflow the call stack.
+// Names must have been resolved, which parse_program does
+class ConstFolder {
+    struct Frame {
+        ASTNode* node;
+        uint32_t step;
+        bool operand;  // The value is used by the frame below rather than replacing the node
+    };
+
+    TokenList& tokens;
+    Diagnostics& dx;
+    ConstEvaluator evaluator;
+
+    std::vector<Frame> frames;
+    std::vector<ConstValue> values;  // Values of the operands whose operator hasn't been folded yet
+
+    size_t numFolded = 0;
+    size_t numConstants = 0;
+    bool quiet = false;  // Operators which can't be folded give up without a warning
+
+    inline void push(ASTNode* node, bool operand) {
+        if (node) frames.push_back({node, 0, operand});
+    }
+    bool push_operand(ASTExpression* expr);  // False if the value is known straight away and no frame was pushed
+    void push_children(ASTNode& node);
+    void finish(const ConstValue& value);
+    void fold_in_place(ASTExpression& expr, const ConstValue& value);  // Only operators and calls are replaced
+
+    void step();
+    void step_decl(ASTDecl& decl);
+    void step_name(const ASTName& name);
+    void step_call(ASTCall& call);
+    ConstValue fold_int(const ASTBinOp& binOp, TokenType op, long long left, long long right, char suffix);
+    ConstValue fold_double(const ASTBinOp& binOp, TokenType op, double left, double right, char suffix);
+    ConstValue check_int(const ASTExpression& expr, long long value, bool overflowed, char suffix);
+    ConstValue check_double(const ASTExpression& expr, double value, char suffix);
+
+    ConstValue constant_value(const ASTDecl& decl) const;  // Nothing unless the declaration was folded to a constant
+    void replace_with_literal(ASTExpression& expr, const ConstValue& value);
+
+   public:
+    ConstFolder(TokenList& tokens, Diagnostics& dx) : tokens(tokens), dx(dx), evaluator(*this, tokens, dx) {}
+
+    void fold(ASTProgram& program);
+
+    // Also used by the evaluator to run functions
+    ConstValue literal_value(const ASTLit& lit) const;
+    ConstValue fold_un_op(const ASTUnOp& unOp, const ConstValue& inner);
+    ConstValue fold_bin_op(const ASTBinOp& binOp, const ConstValue& left, const ConstValue& right);
+    ConstValue constant(ASTDecl& decl);  // Folds a => declaration which hasn't been folded yet first
+    // Returns whether the folder was quiet before
+    inline bool set_quiet(bool isQuiet) {
+        bool wasQuiet = quiet;
+        quiet = isQuiet;
+        return wasQuiet;
+    }
+
+    inline size_t folded_count() const { return numFolded; }
+    inline size_t constant_count() const { return numConstants; }
+    inline size_t call_count() const { return evaluator.call_count(); }
+    inline size_t memo_hit_count() const { return evaluator.memo_hit_count(); }
+};
@@ -3,8 +3,11 @@
 #include <chrono>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "source_manager.hpp"
+
 #ifndef NDEBUG
 #define ASSERT(assertion, errMsg)                                                                              \
     do {                                                                                                       \
@@ -28,7 +31,6 @@ struct Line {
     int leading;
     int beginI;
     int endI;
-    Line* next;
 };
 
 struct ErrorMsg {
@@ -44,10 +46,11 @@ struct ErrorMsg {
     std::string noteMsg;
 
     // Error building temporary variables
+    FileID file;
     int line;
     int ch;  // column number - 1
     int leading;
-    Line* lines[TOTAL_DISPLAY_LINES];
+    Line lines[TOTAL_DISPLAY_LINES];  // Line of the error followed by the lines before it
     int maxNumLen;
 
     inline ErrorMsg(std::string&& msg, int beginI, int endI) : msg(std::move(msg)), beginI(beginI), endI(endI) {}
@@ -72,22 +75,28 @@ struct Token;
 class Diagnostics {
     std::chrono::high_resolution_clock::time_point start;
     std::vector<std::unique_ptr<ErrorMsg>> errors;
-    int maxIndex = 0;
 
     std::vector<std::unique_ptr<ErrorMsg>> discardErrors;
     bool isRecovering = false;  // Discard any errors thrown
 
    public:
-    const std::string& src;
+    const SourceManager& sources;  // Error locations are locations in these files
 
-    inline Diagnostics(const std::string& src) : src(src) { start = std::chrono::high_resolution_clock::now(); }
+    inline Diagnostics(const SourceManager& sources) : sources(sources) {
+        start = std::chrono::high_resolution_clock::now();
+    }
 
     bool has_errors() { return !errors.empty(); }
+    inline size_t error_count() const { return errors.size(); }
+    inline std::vector<std::unique_ptr<ErrorMsg>> take_errors() { return std::move(errors); }
 
     ErrorMsg* last_err();
     inline void pop_last_err() { errors.pop_back(); }
     inline void set_recover_mode(bool recover) { isRecovering = recover; };
 
+    ErrorMsg* add_err(std::unique_ptr<ErrorMsg> errorMsg);
+    // Sort the errors from first onwards into source order. Errors tagged EMPTY stay after the error they belong to
+    void sort_errors(size_t first);
     ErrorMsg* err_loc(std::string&& msg, int beginI, int endI);
     ErrorMsg* err_loc(std::string&& msg, int beginI);
 
@@ -10,8 +10,15 @@ struct DumpInfo {
 };
 extern DumpInfo dumpInfo;
 extern bool sourceFmt;
+extern bool dumpFlat;  //-dump-flat
+extern bool typeCheck;  //-check
+extern bool constFold;  //-fold
+extern long long evalFuel;  //-fuel [steps]
 
 extern bool dwSemiColons;  //-dw-semi-colons
+extern bool streamTokens;  //-stream
+extern bool printStats;    //-stats
+extern int numThreads;     //-j [count], 0 uses every hardware thread but only an explicit count parses in parallel
 
 extern bool parse_flags(int argc, char** argv);
 
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+
+// Index of a node in a FlatAST
+using NodeID = uint32_t;
+constexpr NodeID NULL_NODE = UINT32_MAX;
+
+// Compact form of the AST. Nodes are stored in one array in DFS pre-order so passes which don't care about the tree
+// shape can walk every node with a linear scan, and the nodes of a subtree are always the range [id, subtreeEnd).
+// The children of a node are a range in one shared array. Nodes first have a fixed number of children, with
+// NULL_NODE where the child is missing, and then the node's list of children (declarations, statements, ...) except
+// for functions and function types whose list of parameters or input types comes first like it does in the source.
+// A flat tree is always converted from a pointer tree, see Parser::parse_flat_program.
+struct FlatNode {
+    NodeType nodeType;
+    TokenType op;  // Operator of UN_OP and BIN_OP, type of TYPE_LIT and assignment of DECL or END if there is none
+    uint32_t numChildren;
+    union {
+        uint32_t firstChild;
+        TokenID token;  // Identifier of NAME and value of LIT, which never have children
+    };
+    NodeID subtreeEnd;
+    int beginI;
+    int endI;
+};
+static_assert(sizeof(FlatNode) == 24, "Flat nodes should stay small since every node of the AST is one");
+
+// Position of each fixed child
+namespace FlatSlot {
+enum : uint32_t {
+    IF_CONDITION = 0,
+    IF_CONSEQ,
+    IF_ALT,
+
+    FOR_INITIAL = 0,
+    FOR_CONDITION,
+    FOR_POST,
+    FOR_BLOCK,
+
+    RET_VALUE = 0,
+
+    DECL_LVALUE = 0,
+    DECL_TYPE,
+    DECL_RVALUE,
+
+    FUNC_TYPE_OUT = 0,
+
+    FUNC_RETURN_TYPE = 0,
+    FUNC_BODY,
+
+    DOT_OP_BASE = 0,
+    DOT_OP_MEMBER,
+
+    CALL_REF = 0,
+    TYPE_INIT_REF = 0,
+    UN_OP_INNER = 0,
+    DEREF_INNER = 0,
+
+    BIN_OP_LEFT = 0,
+    BIN_OP_RIGHT,
+};
+}  // namespace FlatSlot
+
+class FlatAST {
+    std::vector<FlatNode> nodes;
+    std::vector<NodeID> children;
+
+    struct Pending {
+        const ASTNode* node;
+        uint32_t slot;  // Where in children to store the id of the node
+    };
+    std::vector<Pending> pending;  // Explicit stack for add_tree so deep trees can't overflow the call stack
+
+    NodeID add_node(const ASTNode& node, const TokenList& tokens);
+
+   public:
+    // A range of children
+    struct Children {
+        const NodeID* first;
+        const NodeID* last;
+        inline const NodeID* begin() const { return first; }
+        inline const NodeID* end() const { return last; }
+        inline size_t size() const { return last - first; }
+        inline bool empty() const { return first == last; }
+        inline NodeID operator[](size_t i) const { return first[i]; }
+    };
+
+    static uint32_t fixed_children(NodeType nodeType);
+
+    // Appends the node and all of its descendants in pre-order and returns the id of the node
+    NodeID add_tree(const ASTNode& root, const TokenList& tokens);
+
+    // A node whose list of children is added separately by end_list_node. Only the nodes of its children's subtrees
+    // may be added in between
+    NodeID begin_list_node(NodeType nodeType, int beginI);
+    void end_list_node(NodeID id, const std::vector<NodeID>& list, int endI);
+
+    inline size_t size() const { return nodes.size(); }
+    inline const FlatNode& operator[](NodeID id) const { return nodes[id]; }
+
+    // The fixed child in the given slot or NULL_NODE if it is missing
+    inline NodeID child(NodeID id, uint32_t slot) const {
+        const FlatNode& node = nodes[id];
+        uint32_t fixed = fixed_children(node.nodeType);
+        bool listFirst = node.nodeType == NodeType::FUNC || node.nodeType == NodeType::FUNC_TYPE;
+        return children[node.firstChild + (listFirst ? node.numChildren - fixed : 0) + slot];
+    }
+
+    inline Children list(NodeID id) const {
+        const FlatNode& node = nodes[id];
+        if (node.numChildren == 0) return {nullptr, nullptr};
+        uint32_t fixed = fixed_children(node.nodeType);
+        bool listFirst = node.nodeType == NodeType::FUNC || node.nodeType == NodeType::FUNC_TYPE;
+        const NodeID* first = children.data() + node.firstChild + (listFirst ? 0 : fixed);
+        return {first, first + node.numChildren - fixed};
+    }
+
+    // Every child in source order including missing fixed children
+    inline Children all_children(NodeID id) const {
+        const FlatNode& node = nodes[id];
+        if (node.numChildren == 0) return {nullptr, nullptr};
+        const NodeID* first = children.data() + node.firstChild;
+        return {first, first + node.numChildren};
+    }
+
+    inline size_t memory_usage() const {
+        return nodes.capacity() * sizeof(FlatNode) + children.capacity() * sizeof(NodeID);
+    }
+};
+
+void dump_flat_ast(const FlatAST& ast, const TokenList& tokens);
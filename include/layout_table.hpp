@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "atom_table.hpp"
+#include "type_table.hpp"
+
+struct ASTDecl;
+class TokenList;
+class TypeChecker;
+
+// Size of a type whose values can't be stored because it contains itself or a type which isn't known
+constexpr uint32_t UNSIZED = UINT32_MAX;
+// Offset of a member of a ty {} which is a constant rather than a field
+constexpr uint32_t NOT_STORED = UINT32_MAX;
+
+// How values of a type are stored, in bytes. Type and Module values only exist while compiling so they take no space
+struct Layout {
+    uint32_t size;
+    uint32_t align;
+    uint32_t firstMember;  // Index of the first member of a DEFINED type in the member layouts
+    uint32_t numMembers;
+};
+
+struct MemberLayout {
+    const ASTDecl* decl;
+    TypeID type;
+    uint32_t offset;  // NOT_STORED for constants
+};
+
+// A ty {} which contains itself and the field which closed the loop
+struct LayoutCycle {
+    TypeID type;
+    const ASTDecl* field;
+};
+
+// Layouts of the types of a checked program, worked out the first time a type is asked for and then kept by type id.
+// The fields of a ty {} are stored in the order they are declared, each at the next offset which suits its
+// alignment, and the members of a type are kept in the same order as in its symbol table so that a member is found
+// from its name with a single lookup. A ty {} which contains itself other than through a pointer has no size and
+// neither does any type made of it
+class LayoutTable {
+    static constexpr uint32_t UNKNOWN = UINT32_MAX - 1;  // Size of a type whose layout hasn't been asked for yet
+    static constexpr uint32_t IN_PROGRESS = UINT32_MAX - 2;
+
+    const TypeTable& types;
+    const TokenList& tokens;
+    const TypeChecker& checker;
+    std::vector<Layout> layouts;  // Indexed by type
+    std::vector<MemberLayout> members;
+    std::vector<LayoutCycle> cycles;
+
+    const Layout& layout_defined(TypeID type);
+
+   public:
+    LayoutTable(const TypeTable& types, const TokenList& tokens, const TypeChecker& checker)
+        : types(types), tokens(tokens), checker(checker) {}
+
+    const Layout& layout_of(TypeID type);
+
+    // Layout of a member of a DEFINED type or nullptr if the type has no member with the name
+    const MemberLayout* member(TypeID type, AtomID name);
+
+    // Types found to contain themselves since the last call
+    std::vector<LayoutCycle> take_cycles();
+
+    inline size_t memory_usage() const {
+        return layouts.capacity() * sizeof(Layout) + members.capacity() * sizeof(MemberLayout);
+    }
+};
@@ -1,11 +1,17 @@
 #pragma once
 
+#include <climits>
+#include <cstdint>
 #include <memory>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "atom_table.hpp"
 #include "diagnostics.hpp"
+#include "source.hpp"
+#include "source_manager.hpp"
 
 enum class TokenType : unsigned char {
     UNKNOWN,
@@ -98,57 +104,258 @@ enum class TokenType : unsigned char {
 
 std::string token_type_to_str(TokenType type);
 
+// Keyword token type of a word or IDENTIFIER if the word isn't reserved. Up to 8 characters are read regardless of len,
+// which is safe on a source buffer because it is padded
+TokenType keyword_type(const char* str, size_t len);
+
+// Index of a token in a TokenList. AST nodes refer to tokens by id instead of by pointer
+using TokenID = uint32_t;
+constexpr TokenID NULL_TOKEN = UINT32_MAX;
+
+// Copy of the position and type of a token. Literal values are looked up in the TokenList using the id
 struct Token {
+    TokenID id;
     TokenType type;
 
     int beginI;
     int endI;
+};
+
+// Allocator which leaves elements uninitialized when a vector is resized so that a big token list can be allocated up
+// front and then filled in (and paged in) by several threads
+template <class T>
+struct UninitAllocator : std::allocator<T> {
+    template <class U>
+    struct rebind {
+        using other = UninitAllocator<U>;
+    };
+
+    UninitAllocator() = default;
+    template <class U>
+    UninitAllocator(const UninitAllocator<U>&) {}
 
-    union {
+    template <class U>
+    void construct(U* ptr) {
+        ::new (static_cast<void*>(ptr)) U;
+    }
+    template <class U, class... Args>
+    void construct(U* ptr, Args&&... args) {
+        ::new (static_cast<void*>(ptr)) U(std::forward<Args>(args)...);
+    }
+};
+
+// Tokens lexed from a source file stored as parallel arrays indexed by TokenID so that each token only takes up
+// 13 bytes. The payload of an identifier or string literal is its atom. Int literals which fit in 30 bits are stored
+// directly in the token's payload. Other numeric literal values live in a separate pool which the payload indexes into
+// (with POOLED_BIT set for ints). SUFFIX_BIT records an l suffix on an int literal or an f suffix on a double literal.
+// Tokens before firstID may be discarded to use the list as a sliding window over the token stream.
+// Tokens are pushed with offsets into the source string and read back as locations, which are the offsets plus base
+class TokenList {
+    union LiteralVal {
         long long longVal;
         double doubleVal;
-        std::string* sourceStr;
     };
+    static constexpr uint32_t POOLED_BIT = 0x80000000;
+    static constexpr uint32_t SUFFIX_BIT = 0x40000000;
+    static constexpr uint32_t VALUE_MASK = ~(POOLED_BIT | SUFFIX_BIT);  // Inline value or index into the pool
+
+    TokenID firstID = 0;
+    template <class T>
+    using Array = std::vector<T, UninitAllocator<T>>;
+
+    Array<TokenType> types;
+    Array<uint32_t> begins;
+    Array<uint32_t> lengths;
+    Array<uint32_t> payloads;
+    Array<LiteralVal> literals;
+
+    std::string_view sourceStr;
+    int base = 0;  // Location of the start of sourceStr
+
+    inline bool is_pooled(size_t i) const {
+        return types[i] == TokenType::DOUBLE_LITERAL ||
+               (types[i] == TokenType::INT_LITERAL && (payloads[i] & POOLED_BIT));
+    }
+    inline void pool_literal(size_t i, uint32_t flags, LiteralVal val) {
+        payloads[i] = flags | static_cast<uint32_t>(literals.size());
+        literals.push_back(val);
+    }
+
+   public:
+    void reset(std::string_view src, int base, size_t expectedTokens);
+
+    inline TokenID push(TokenType type, int beginI, int endI) {
+        types.push_back(type);
+        begins.push_back(static_cast<uint32_t>(beginI));
+        lengths.push_back(static_cast<uint32_t>(endI - beginI));
+        payloads.push_back(0);
+        return firstID + static_cast<TokenID>(types.size() - 1);
+    }
+    // Token which wasn't lexed, like the literal an expression is folded into, spanning the locations of the expression
+    inline TokenID push_loc(TokenType type, int beginLoc, int endLoc) {
+        return push(type, beginLoc - base, endLoc - base);
+    }
+    // suffix is 'l' for a long or 0
+    inline void set_long(TokenID id, long long val, char suffix) {
+        uint32_t flags = suffix == 'l' ? SUFFIX_BIT : 0;
+        if (val >= 0 && val <= VALUE_MASK) {
+            payloads[id - firstID] = flags | static_cast<uint32_t>(val);
+        } else {
+            LiteralVal literal;
+            literal.longVal = val;
+            pool_literal(id - firstID, flags | POOLED_BIT, literal);
+        }
+    }
+    // suffix is 'f' for a float or 0
+    inline void set_double(TokenID id, double val, char suffix) {
+        LiteralVal literal;
+        literal.doubleVal = val;
+        pool_literal(id - firstID, suffix == 'f' ? SUFFIX_BIT : 0, literal);
+    }
+    inline void set_atom(TokenID id, AtomID atom) { payloads[id - firstID] = atom; }
 
-    inline std::string get_string_val() { return sourceStr->substr(beginI, endI - beginI); }
+    // Copy a token from another list onto the end of this one and return its new id
+    TokenID append(const TokenList& other, TokenID id);
+
+    // Make room for numTokens tokens and numLiterals pooled literals to be filled in by copy_chunk
+    void resize(size_t numTokens, size_t numLiterals);
+
+    // Copy the tokens of a list from index first onwards into this one starting at firstID, along with every pooled
+    // literal of the list starting at firstLiteral. The atoms of the list are translated with atomMap. Separate chunks
+    // can be copied from different threads at once
+    void copy_chunk(const TokenList& chunk, size_t first, TokenID firstID, size_t firstLiteral,
+                    const std::vector<AtomID>& atomMap);
+
+    // Free every token before id. Ids of the remaining tokens stay the same. The remaining tokens are moved to the
+    // front of the arrays, so this is only cheap when few tokens are kept
+    void discard_before(TokenID id);
+
+    inline size_t size() const { return types.size(); }
+    inline size_t literal_count() const { return literals.size(); }
+    inline TokenID next_id() const { return firstID + static_cast<TokenID>(types.size()); }
+
+    inline TokenType type(TokenID id) const { return types[id - firstID]; }
+    inline int begin(TokenID id) const { return base + static_cast<int>(begins[id - firstID]); }
+    inline int end(TokenID id) const { return base + static_cast<int>(begins[id - firstID] + lengths[id - firstID]); }
+    inline Token get(TokenID id) const { return {id, type(id), begin(id), end(id)}; }
+
+    inline long long long_val(TokenID id) const {
+        uint32_t payload = payloads[id - firstID];
+        return (payload & POOLED_BIT) ? literals[payload & VALUE_MASK].longVal : payload & VALUE_MASK;
+    }
+    inline double double_val(TokenID id) const { return literals[payloads[id - firstID] & VALUE_MASK].doubleVal; }
+    // 'l' for a long int literal, 'f' for a float literal and 0 for any other int or double literal
+    inline char suffix(TokenID id) const {
+        if (!(payloads[id - firstID] & SUFFIX_BIT)) return 0;
+        return type(id) == TokenType::INT_LITERAL ? 'l' : 'f';
+    }
+    inline std::string_view str(TokenID id) const {
+        return sourceStr.substr(begins[id - firstID], lengths[id - firstID]);
+    }
+    inline AtomID atom(TokenID id) const { return payloads[id - firstID]; }
+
+    // Bytes of token storage currently in use (not counting unused vector capacity)
+    size_t memory_usage() const;
 };
 
 class Lexer {
+    TokenList fileTokens;  // Unless the tokens are shared with another lexer
+
     int curIndex = 0;
     int curCLen = 1;
 
-    int cacheIndex = 0;
-    std::vector<std::unique_ptr<Token>> tokenCache;
+    TokenID cacheIndex = 0;
+
+    // When streaming, tokens are lexed into a small window which is emptied once it holds STREAM_WINDOW tokens. Only
+    // the last token is kept then, so emptying it moves a single token and costs O(1) per STREAM_WINDOW tokens lexed.
+    // Only the tokens referenced by the AST are copied out of the window into the token list
+    bool streaming = false;
+    TokenList window;
+    size_t peakScratchMemory = 0;  // Peak size of the tokens kept outside of the token list
+
+    // When lexing in parallel, each chunk of the file is lexed by a separate lexer which stops at the first gap
+    // between tokens that reaches chunkEnd. chunkSynced records whether the gap contained chunkEnd, in which case the
+    // lexer of the following chunk started in the same state as the serial lexer would have been in
+    struct ChunkLex;
+    struct Chunk;
+    int chunkEnd = INT_MAX;
+    bool chunkSynced = false;
+
+    // Lexer diagnostics of a parallel lex are held back until the parser peeks at the token which the serial lexer
+    // would have been lexing when it reported them so that errors are interleaved with parser errors the same way
+    struct DeferredError {
+        TokenID token;
+        std::unique_ptr<ErrorMsg> msg;
+    };
+    std::vector<DeferredError> deferredErrors;
+    size_t nextDeferred = 0;
+    TokenID deferredTokenID = NULL_TOKEN;  // Token of the next deferred error
+
+    TokenID lex_number();
+
+    // Location of an offset into the file for diagnostics
+    inline int loc(int index) const { return fileBase + index; }
+
+    void lex_chunk(int beginI, int endI, ChunkLex& out, const TokenList* guess) const;
+    void lex_parallel(int numThreads);
+    void flush_deferred_errors();
+
+    bool lexedAhead = false;  // Every token of the file was lexed by from_file_path
 
    public:
     static constexpr size_t TAB_WIDTH = 4;
+    static constexpr size_t STREAM_WINDOW = 64;
+    static constexpr size_t PARALLEL_MIN_SIZE = 1 << 20;  // Smaller files are always lexed serially
 
+    SourceManager sources;
     Diagnostics dx;
-    inline Lexer() : dx(sourceStr) {}
+    inline Lexer() : dx(sources) {}
+    // Reads the tokens of a lexer which lexed the whole file ahead from the token first onwards instead of lexing.
+    // The tokens are shared, so the other lexer has to outlive this one
+    Lexer(Lexer& ahead, TokenID first);
 
-    std::string sourceStr;
+    SourceBuffer source;  // Shares the buffer of the file in sources
+    std::string_view sourceStr;
+    FileID file = NULL_FILE;
+    int fileBase = 0;  // Location of the start of the file
     bool from_file_path(const char* filePath);
 
-    std::unique_ptr<Token> make_token(TokenType type);
-    std::unique_ptr<Token> consume_token();
+    TokenList& tokens = fileTokens;  // Every token in the file or only the retained tokens when streaming
+    AtomTable atoms;   // Spellings of the identifiers and string literals in the file
+    TokenID make_token(TokenType type);
+    TokenID make_atom_token(TokenType type);  // Token whose spelling is interned into atoms
+    TokenID consume_token();
 
-    inline Token* peek_token() {
-        if (cacheIndex >= tokenCache.size()) tokenCache.push_back(consume_token());
-        return tokenCache[cacheIndex].get();
+    inline Token peek_token() {
+        TokenList& lexed = lexed_tokens();
+        if (cacheIndex >= lexed.next_id()) consume_token();
+        if (cacheIndex >= deferredTokenID) flush_deferred_errors();
+        return lexed.get(cacheIndex);
     }
 
-    inline Token* next_token() {
-        Token* token = peek_token();
-        if (token->type != TokenType::END) cacheIndex++;
+    inline Token next_token() {
+        Token token = peek_token();
+        if (token.type != TokenType::END) cacheIndex++;
         return token;
     }
 
-    inline Token* last_token() {
+    inline Token last_token() {
         ASSERT(cacheIndex > 0, "Can't get last token of the first token in the file.");
-        return tokenCache.at(cacheIndex - 1).get();
+        return lexed_tokens().get(cacheIndex - 1);
     }
 
-    inline bool is_cursor_char(char assertChar) { return sourceStr[curIndex + curCLen] == assertChar; }
+    // Id which an AST node should store to refer to the token. Streaming copies the token out of the window
+    inline TokenID retain(const Token& token) { return streaming ? tokens.append(window, token.id) : token.id; }
+
+    // List which the last, peeked and next tokens are in
+    inline TokenList& lexed_tokens() { return streaming ? window : tokens; }
+
+    size_t peak_token_memory() const;
+
+    // Whether every token of the file has been lexed without any diagnostics, so that parsing may start at any token
+    inline bool lexed_ahead() const { return lexedAhead && deferredErrors.empty(); }
+
+    inline bool is_cursor_char(char assertChar) { return source[curIndex + curCLen] == assertChar; }
 
     static inline bool is_whitespace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n'; }
     static inline bool is_letter(char ch) {
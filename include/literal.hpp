@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Conversion of the digits of numeric literals into values. The digits between separators are converted up to 8 at
+// once as a single 64-bit word (SWAR) instead of one digit at a time.
+namespace Literal {
+
+// Value of the digit in base 16 or lower: '7' -> 7, 'b' -> 11
+inline int digit_value(char ch) { return ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10; }
+
+constexpr uint64_t ONES = 0x0101010101010101;
+constexpr uint64_t HIGH_BITS = 0x8080808080808080;
+
+// Loads 8 characters so that the first character is in the lowest byte
+inline uint64_t load_word(const char* str) {
+    uint64_t word;
+    memcpy(&word, str, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+// Sets the high bit of each byte of word which is in [lo, hi]. Every byte of word must be below 0x80 so that the
+// additions never carry into the next byte
+inline uint64_t bytes_in_range(uint64_t word, unsigned char lo, unsigned char hi) {
+    return (word + ONES * (0x80 - lo)) & ~(word + ONES * (0x7f - hi)) & HIGH_BITS;
+}
+
+// Converts the digits of the base (2, 8, 10 or 16) at the start of the 8 characters at str, stopping at the first
+// character which isn't one. Returns how many there were and sets value to what they spell. Always reads 8 characters
+// so str must be followed by padding when it is near the end of the buffer
+inline int parse_digits(const char* str, int base, uint64_t& value) {
+    uint64_t word = load_word(str);
+    uint64_t isDigit, digits;
+    if (base == 16) {
+        uint64_t isLetter = bytes_in_range(word | (ONES * 0x20), 'a', 'f');
+        isDigit = bytes_in_range(word, '0', '9') | isLetter;
+        // The low nibble of a letter is 9 less than its value and only letters have bit 6 set
+        digits = (word & (ONES * 0x0f)) + 9 * ((word >> 6) & ONES);
+    } else {
+        isDigit = bytes_in_range(word, '0', static_cast<unsigned char>('0' + base - 1));
+        digits = word - ONES * '0';
+    }
+    // A byte of 0x80 or above is never a digit. Whatever it carries only reaches the bytes after it, which are past the
+    // first character that isn't a digit anyway
+    isDigit &= ~word;
+    int count = isDigit == HIGH_BITS ? 8 : __builtin_ctzll(~isDigit & HIGH_BITS) / 8;
+    if (count == 0) return 0;
+
+    // Each byte holds one digit with the most significant digit in the lowest byte. The bytes after the digits are
+    // shifted out, which leaves zeros in front of the number, and neighbouring groups of digits are merged until the
+    // whole word holds one number
+    digits <<= 64 - 8 * count;
+    uint64_t base2 = static_cast<uint64_t>(base) * base;
+    digits = (digits & 0x00ff00ff00ff00ff) * base + ((digits >> 8) & 0x00ff00ff00ff00ff);
+    digits = (digits & 0x0000ffff0000ffff) * base2 + ((digits >> 16) & 0x0000ffff0000ffff);
+    digits = (digits & 0x00000000ffffffff) * (base2 * base2) + (digits >> 32);
+    value = digits;
+    return count;
+}
+
+// base^count for count up to 8, which is what the number so far is scaled by when count more digits are appended
+inline uint64_t digit_scale(int base, int count) {
+    constexpr uint64_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+    if (base == 10) return POW10[count];
+    int bits = base == 2 ? 1 : base == 8 ? 3 : 4;
+    return uint64_t{1} << (bits * count);
+}
+
+// number = number * scale + digits modulo 2^64. Returns true if the result didn't fit in 64 bits
+inline bool accumulate(uint64_t& number, uint64_t scale, uint64_t digits) {
+#ifdef __GNUC__
+    bool wrapped = __builtin_mul_overflow(number, scale, &number);
+    return __builtin_add_overflow(number, digits, &number) || wrapped;
+#else
+    bool wrapped = number > (UINT64_MAX - digits) / scale;
+    number = number * scale + digits;
+    return wrapped;
+#endif
+}
+
+enum class Range { OK, TOO_LARGE, TOO_SMALL };
+
+// Correctly rounded double (or float when isFloat is set) value of a literal's digits in the given base. digits is the
+// spelling without the base prefix or suffix and may contain '_' separators and a decimal point. mantissa is the value
+// of all of the digits ignoring the decimal point, only valid if exact is set, and fractionDigits is how many of them
+// are after the decimal point. range is set when the value is too large or too small to be represented
+double to_floating(std::string_view digits, int base, uint64_t mantissa, bool exact, int fractionDigits, bool isFloat,
+                   Range& range);
+
+}  // namespace Literal
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "ast.hpp"
+#include "lexer.hpp"
+#include "scope_stack.hpp"
+
+// A name which was used in a block, a for loop or a parameter list before a declaration of it further down in the
+// same scope. It stays unresolved, but the snapshot taken when its scope was left still sees the declaration
+struct LateName {
+    const ASTName* name;
+    AtomID atom;
+    ScopeSnapshot at;
+};
+
+// Links every name of a parsed program to its declaration and gives each scope which declares something a table.
+// The program, modules and types can use a declaration before it appears, so everything they declare is declared
+// before anything inside of them is walked. Blocks, for loops and parameter lists only see what they declared so far,
+// and in a block or for loop x = 3 only declares x if no x is visible yet. A typed declaration always declares, and a
+// name is declared before its rvalue is walked so that a function can refer to itself. Fields of a type initialization
+// and members after . depend on the type of the base, so they are left for the type checker.
+// The walk keeps its work on an explicit stack so long chains of operators can't overflow the call stack
+class NameResolver {
+    enum class Step : unsigned char {
+        WALK,
+        WALK_MEMBER,  // Declaration of the program, a module or a type, which was declared when its scope was entered
+        DECLARE,
+        LEAVE
+    };
+    struct Work {
+        ASTNode* node;
+        Step step;
+    };
+    struct OpenScope {
+        SymTable** table;  // Field of the node, which stays nullptr unless the scope declares something
+        const ASTNode* node;
+        bool statements;         // A block or a for loop, where an assignment to a visible name declares nothing
+        size_t firstUnresolved;  // Names which were already unresolved when the scope was entered
+    };
+
+    const TokenList* tokens = nullptr;
+    ScopeStack scopes;
+    std::deque<SymTable> tables;  // Not trivially destructible so they can't live in the arena
+    std::vector<Work> work;
+    std::vector<OpenScope> openScopes;
+    std::vector<ASTName*> unresolved;  // Names in the open scopes which no declaration was visible to
+    std::vector<LateName> lateNames;  // Sorted by name once the program is resolved
+
+    inline void push(ASTNode* node, Step step = Step::WALK) {
+        if (node) work.push_back({node, step});
+    }
+    void enter(ASTNode* node, SymTable** table, bool statements);
+    void leave();
+    SymTable* scope_table();  // Table of the innermost scope, which is made when it first declares something
+    void declare(ASTDecl* decl);
+    void resolve_name(ASTName* name);
+    // Like push, but names are resolved and literals skipped right away since nothing between them and the rest of
+    // the node's children can declare anything they see. Only the children of a node may be visited this way
+    void visit(ASTNode* node);
+    void walk(ASTNode* node);
+    template <class List>
+    void walk_declarations(ASTNode* node, SymTable** table, List& declarations);
+
+   public:
+    void resolve(ASTProgram& program, const TokenList& tokens);
+
+    // Declaration further down in its scope of a name which is not declared, or nullptr if there is none
+    const ASTDecl* late_declaration(const ASTName& name) const;
+};
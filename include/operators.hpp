@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include "lexer.hpp"
+
+// How the parser treats each token in an expression, which is one lookup by token type. Pratt parsing: an operand is
+// parsed by what its first token does at the start of an expression, and then operators which bind tighter than the
+// enclosing one are taken in by what their token does after an operand.
+namespace Operators {
+enum { LOWEST_PRECEDENCE = 0, HIGHEST_PRECEDENCE = 100 };
+
+// What a token does at the start of an expression and after an operand
+enum class Prefix : unsigned char { NONE, MOD, TY, NAME, TYPE_LIT, LIT, UN_OP, LEFT_PARENS };
+enum class Infix : unsigned char { NONE, BIN_OP, CALL, DEREF, DOT };
+
+struct Operator {
+    unsigned char precedence;  // LOWEST_PRECEDENCE unless the token continues an expression
+    bool rightAssoc;
+    Prefix prefix;
+    Infix infix;
+};
+
+constexpr size_t NUM_TOKEN_TYPES = static_cast<size_t>(TokenType::END) + 1;
+
+constexpr std::array<Operator, NUM_TOKEN_TYPES> make_operators() {
+    std::array<Operator, NUM_TOKEN_TYPES> table{};
+    auto prefix = [&](TokenType type, Prefix kind) { table[static_cast<size_t>(type)].prefix = kind; };
+    auto infix = [&](TokenType type, unsigned char precedence, Infix kind) {
+        table[static_cast<size_t>(type)].precedence = precedence;
+        table[static_cast<size_t>(type)].infix = kind;
+    };
+
+    prefix(TokenType::MOD, Prefix::MOD);
+    prefix(TokenType::TY, Prefix::TY);
+    prefix(TokenType::IDENTIFIER, Prefix::NAME);
+    for (TokenType type : {TokenType::VOID_TYPE, TokenType::MOD_TYPE, TokenType::TY_TYPE, TokenType::INT_TYPE,
+                           TokenType::DOUBLE_TYPE, TokenType::STRING_TYPE, TokenType::BOOL_TYPE}) {
+        prefix(type, Prefix::TYPE_LIT);
+    }
+    for (TokenType type : {TokenType::INT_LITERAL, TokenType::DOUBLE_LITERAL, TokenType::STRING_LITERAL,
+                           TokenType::TRUE, TokenType::FALSE}) {
+        prefix(type, Prefix::LIT);
+    }
+    for (TokenType type : {TokenType::COND_NOT, TokenType::BIT_NOT, TokenType::OP_SUBTR, TokenType::OP_MULT}) {
+        prefix(type, Prefix::UN_OP);
+    }
+    prefix(TokenType::LEFT_PARENS, Prefix::LEFT_PARENS);
+
+    infix(TokenType::COND_OR, 1, Infix::BIN_OP);
+    infix(TokenType::COND_XOR, 2, Infix::BIN_OP);
+    infix(TokenType::COND_AND, 3, Infix::BIN_OP);
+
+    infix(TokenType::BIT_OR, 4, Infix::BIN_OP);
+    infix(TokenType::BIT_XOR, 5, Infix::BIN_OP);
+    infix(TokenType::BIT_AND, 6, Infix::BIN_OP);
+
+    infix(TokenType::COND_EQUALS, 7, Infix::BIN_OP);
+    infix(TokenType::COND_NOT_EQUALS, 7, Infix::BIN_OP);
+    infix(TokenType::COND_GREATER_EQUAL, 8, Infix::BIN_OP);
+    infix(TokenType::COND_LESS_EQUAL, 8, Infix::BIN_OP);
+    infix(TokenType::COND_GREATER, 8, Infix::BIN_OP);
+    infix(TokenType::COND_LESS, 8, Infix::BIN_OP);
+
+    infix(TokenType::BIT_SHIFT_LEFT, 9, Infix::BIN_OP);
+    infix(TokenType::BIT_SHIFT_RIGHT, 9, Infix::BIN_OP);
+
+    infix(TokenType::OP_ADD, 10, Infix::BIN_OP);
+    infix(TokenType::OP_SUBTR, 10, Infix::BIN_OP);
+    infix(TokenType::OP_MULT, 11, Infix::BIN_OP);
+    infix(TokenType::OP_DIV, 11, Infix::BIN_OP);
+    infix(TokenType::OP_MOD, 11, Infix::BIN_OP);
+    // a ^ b ^ c is a ^ (b ^ c) like it is in math
+    infix(TokenType::OP_CARROT, 12, Infix::BIN_OP);
+    table[static_cast<size_t>(TokenType::OP_CARROT)].rightAssoc = true;
+
+    infix(TokenType::LEFT_PARENS, 13, Infix::CALL);
+    infix(TokenType::DEREF, 13, Infix::DEREF);
+    infix(TokenType::DOT, 13, Infix::DOT);
+    return table;
+}
+
+// Indexed by token type so that parsing an expression takes a single lookup per token
+constexpr std::array<Operator, NUM_TOKEN_TYPES> OPERATORS = make_operators();
+
+inline const Operator& operator_of(TokenType type) { return OPERATORS[static_cast<size_t>(type)]; }
+}  // namespace Operators
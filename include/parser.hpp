@@ -1,39 +1,67 @@
 #pragma once
 
-#include <memory>
+#include <vector>
 
 #include "ast.hpp"
 #include "diagnostics.hpp"
+#include "flat_ast.hpp"
 #include "lexer.hpp"
+#include "name_resolver.hpp"
 
 class Parser {
     void assert_token(TokenType type, const std::string& msg = "");
-    inline bool check_token(TokenType type) { return lexer.peek_token()->type == type; }
+    inline bool check_token(TokenType type) { return lexer.peek_token().type == type; }
 
-    std::unique_ptr<ASTNode> parse_statement();
-    std::unique_ptr<ASTBlock> parse_block();
+    ASTNode* parse_statement();
+    ASTBlock* parse_block();
 
-    std::unique_ptr<ASTIf> parse_if();
-    std::unique_ptr<ASTFor> parse_for();
+    ASTIf* parse_if();
+    ASTFor* parse_for();
 
-    std::unique_ptr<ASTRet> parse_return();
+    ASTRet* parse_return();
 
-    std::unique_ptr<ASTDecl> assert_parse_decl();
-    std::unique_ptr<ASTNode> parse_decl_expr();
+    ASTDecl* parse_global_decl();  // nullptr if the statement isn't a declaration
+    ASTDecl* assert_parse_decl();
+    ASTNode* parse_decl_expr();
 
-    std::unique_ptr<ASTExpression> parse_left_paren_expr();
-    std::unique_ptr<ASTExpression> parse_function_type(std::unique_ptr<ASTExpression> reduceExpr);
+    ASTExpression* parse_left_paren_expr();
+    ASTExpression* parse_function_type(ASTExpression* reduceExpr);
 
     int exprDepth = 0;
     int unbalancedParenErrI = 0;
-    std::unique_ptr<ASTExpression> parse_expr();
-    std::unique_ptr<ASTExpression> parse_operand();
-    std::unique_ptr<ASTExpression> recur_expr(int prec);
+    ASTExpression* parse_expr();
+    ASTExpression* parse_operand();
+    ASTExpression* recur_expr(int prec);
+
+    // When the whole file was lexed ahead, the declarations of the program can be split into chunks which are parsed
+    // on separate threads by parsers of their own and then merged in order. See parallel_parse.cpp
+    struct Chunk;
+    Parser(Lexer& ahead, TokenID first) : lexer(ahead, first), dx(lexer.dx) {}
+    bool parse_chunks(ASTProgram* prgm);  // False if the program has to be parsed serially instead
+    ASTProgram* parse_chunk(TokenID end);
+    void merge_chunk(ASTProgram* prgm, Parser& chunk, ASTProgram* chunkPrgm);
+
+    std::vector<TypeID*> typeFields;  // Set by a chunk's parser to be renumbered when its types are merged
+    bool inChunk = false;
+    size_t numChunks = 1;
+
+    NameResolver resolver;
 
    public:
     Lexer lexer;
     Diagnostics& dx;
+    Arena arena;  // Owns every node of the AST so it lives as long as the parser
+    TypeTable types;
+    // Whether parse_program links names to their declarations once the program is parsed without errors. Names of
+    // flat programs are never resolved since their nodes are freed after each declaration
+    bool resolveNames = true;
     Parser() : dx(lexer.dx) {}
 
-    std::unique_ptr<ASTProgram> parse_program();
+    ASTProgram* parse_program();
+    // Not a parser of its own: each global declaration is parsed into the arena as usual, converted with
+    // FlatAST::add_tree and then rewound, so only the pointer tree of one declaration is ever held at a time
+    FlatAST parse_flat_program();
+
+    inline size_t chunk_count() const { return numChunks; }  // Chunks of declarations parsed in parallel
+    inline const NameResolver& name_resolver() const { return resolver; }
 };
\ No newline at end of file
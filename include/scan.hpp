@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+// Vectorized helpers for skipping over the parts of the source file which never produce tokens.
+// The widest implementation supported by the running cpu (AVX2, SSE2 or scalar) is chosen once at startup.
+namespace Scan {
+
+// Vectorized version of skip_whitespace which is only worth calling for longer runs of whitespace
+size_t skip_whitespace_run(const char* src, size_t i, size_t len);
+
+// Index of the first character at or after i which is not ' ', '\t' or '\n'. Returns i if i >= len
+inline size_t skip_whitespace(const char* src, size_t i, size_t len) {
+    // Most tokens are separated by a single space so the first two characters are checked inline
+    for (int n = 0; n < 2; n++) {
+        if (i >= len || !(src[i] == ' ' || src[i] == '\t' || src[i] == '\n')) return i;
+        i++;
+    }
+    return skip_whitespace_run(src, i, len);
+}
+
+// Index of the first '\n' at or after i. Returns len if there is none
+size_t find_newline(const char* src, size_t i, size_t len);
+
+// Index of the '*' of the first "*/" at or after i. Returns len if there is none
+size_t find_block_end(const char* src, size_t i, size_t len);
+
+// Name of the implementation picked for this cpu: "avx2", "sse2" or "scalar"
+const char* isa_name();
+
+}  // namespace Scan
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "atom_table.hpp"
+
+struct ASTNode;
+struct ASTDecl;
+
+// Index of a scope in a ScopeStack. Scopes are numbered in the order they are entered
+using ScopeID = uint32_t;
+constexpr ScopeID NULL_SCOPE = UINT32_MAX;
+
+// Names visible at one point of the walk: the innermost open scope and how many declarations had been made by then
+struct ScopeSnapshot {
+    ScopeID scope;
+    uint32_t numBindings;
+};
+
+// Name resolution for nested scopes. Instead of a table per scope, one array indexed by atom holds the innermost
+// visible declaration of every name and each declaration remembers the one it shadows. Leaving a scope restores the
+// names it declared, so looking up a name is a single index however deeply the scopes are nested.
+// Declarations and scopes are kept after their scope is left so that snapshots can still be queried later
+class ScopeStack {
+    static constexpr uint32_t NO_BINDING = UINT32_MAX;
+
+    struct Binding {
+        AtomID name;
+        ScopeID scope;
+        ASTDecl* decl;
+        uint32_t shadowed;    // Binding of the name which was visible when this one was made
+        uint32_t prevOfName;  // Previous binding of the name in any scope
+    };
+    struct Scope {
+        const ASTNode* node;
+        ScopeID parent;
+        uint32_t depth;
+        ScopeID lastDescendant;  // Last scope entered before this one was left or NULL_SCOPE while it is open
+        uint32_t firstLive;      // Index in live of the first binding of the scope
+    };
+    struct Name {
+        uint32_t visible;  // Innermost binding of the name in the open scopes
+        uint32_t latest;   // Most recent binding of the name in any scope
+    };
+
+    std::vector<Binding> bindings;
+    std::vector<Scope> scopes;
+    std::vector<uint32_t> live;  // Bindings of the open scopes from the outermost to the innermost
+    std::vector<Name> names;     // Indexed by atom
+    ScopeID current = NULL_SCOPE;
+
+    inline bool encloses(ScopeID outer, ScopeID inner) const {
+        return outer <= inner && inner <= scopes[outer].lastDescendant;
+    }
+
+   public:
+    ScopeID enter(const ASTNode* node);
+    void leave();
+
+    // Returns the declaration of the name which is already in the innermost scope, in which case nothing is declared,
+    // or nullptr if the name was added. Declarations in enclosing scopes are shadowed
+    ASTDecl* declare(AtomID name, ASTDecl* decl);
+
+    // Innermost visible declaration of the name or nullptr if it isn't declared in any open scope
+    inline ASTDecl* lookup(AtomID name) const {
+        if (name >= names.size() || names[name].visible == NO_BINDING) return nullptr;
+        return bindings[names[name].visible].decl;
+    }
+    // Scope of the innermost visible declaration of the name or NULL_SCOPE if it isn't declared in any open scope
+    inline ScopeID lookup_scope(AtomID name) const {
+        if (name >= names.size() || names[name].visible == NO_BINDING) return NULL_SCOPE;
+        return bindings[names[name].visible].scope;
+    }
+
+    inline ScopeSnapshot snapshot() const { return {current, static_cast<uint32_t>(bindings.size())}; }
+
+    // Declaration the name referred to when the snapshot was taken. This walks the earlier declarations of the name
+    // so it is meant for occasional queries after the walk rather than for resolving every name
+    ASTDecl* lookup_at(const ScopeSnapshot& snapshot, AtomID name) const;
+
+    inline ScopeID current_scope() const { return current; }
+    inline uint32_t depth() const { return current == NULL_SCOPE ? 0 : scopes[current].depth; }
+    inline const ASTNode* scope_node(ScopeID scope) const { return scopes[scope].node; }
+    inline ScopeID parent(ScopeID scope) const { return scopes[scope].parent; }
+    inline size_t scope_count() const { return scopes.size(); }
+
+    void clear();
+    size_t memory_usage() const;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+// Read-only contents of a source file. The file is memory mapped instead of copied when the platform allows it.
+// The contents are always followed by at least PADDING zero bytes so that the lexer can look ahead past the last
+// character (and vectorized scans can read whole chunks) without checking bounds first.
+class SourceBuffer {
+    const char* buffer;
+    size_t length = 0;
+    size_t mappedLength = 0;  // Size of the memory mapping or 0 if buffer is heap allocated or static
+    bool shared = false;      // Buffer is owned by another SourceBuffer
+
+    void release();
+
+   public:
+    static constexpr size_t PADDING = 64;
+
+    SourceBuffer();
+    ~SourceBuffer() { release(); }
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    bool open(const char* filePath);
+
+    // View the contents of another buffer without taking ownership. The other buffer must outlive this one
+    void share(const SourceBuffer& other);
+
+    inline const char* data() const { return buffer; }
+    inline size_t size() const { return length; }
+    inline std::string_view view() const { return std::string_view(buffer, length); }
+
+    // Unchecked access which is valid for any index up to size() + PADDING
+    inline char operator[](size_t index) const { return buffer[index]; }
+};
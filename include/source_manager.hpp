@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "source.hpp"
+
+// Position in one of the files of a SourceManager. Every file gets its own range of locations so a location alone
+// identifies both the file and the offset within it
+using SourceLoc = uint32_t;
+
+// Index of a file in a SourceManager
+using FileID = uint32_t;
+constexpr FileID NULL_FILE = UINT32_MAX;
+
+// Owns the loaded source files and maps locations back to files, lines and columns. The start of every line is found
+// once when a file is loaded so that looking up the line of a location is a binary search instead of a rescan of the
+// file. Locations stay below INT_MAX so that they can still be stored in the int indices of tokens and nodes
+class SourceManager {
+    struct File {
+        std::string path;
+        std::unique_ptr<SourceBuffer> buffer;
+        SourceLoc base;
+        std::vector<uint32_t> lineStarts;  // Offset of the first character of every line
+    };
+    std::vector<File> files;
+    SourceLoc nextBase = 0;
+
+   public:
+    // NULL_FILE if the file can't be read or there is no room left for its locations
+    FileID open(const char* filePath);
+
+    // File which the location belongs to. Locations just past the end of a file still belong to it
+    FileID file_of(SourceLoc loc) const;
+
+    inline SourceLoc base(FileID file) const { return files[file].base; }
+    inline const SourceBuffer& buffer(FileID file) const { return *files[file].buffer; }
+    inline const std::string& path(FileID file) const { return files[file].path; }
+    inline size_t file_count() const { return files.size(); }
+
+    // Lines are numbered from 0. Offsets are from the start of the file and past its end count as the last line
+    uint32_t line_of(FileID file, uint32_t offset) const;
+    inline uint32_t line_count(FileID file) const { return static_cast<uint32_t>(files[file].lineStarts.size()); }
+    inline uint32_t line_begin(FileID file, uint32_t line) const { return files[file].lineStarts[line]; }
+    // Offset of the newline which ends the line or the length of the file for the last line
+    inline uint32_t line_end(FileID file, uint32_t line) const {
+        const File& f = files[file];
+        return line + 1 < f.lineStarts.size() ? f.lineStarts[line + 1] - 1 : static_cast<uint32_t>(f.buffer->size());
+    }
+
+    // Bytes used by the line tables (not counting the contents of the files)
+    size_t memory_usage() const;
+};
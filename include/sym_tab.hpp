@@ -1,43 +1,53 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
+#include "atom_table.hpp"
+#include "scope_stack.hpp"
+
 struct ASTNode;
 struct ASTDecl;
-struct Token;
 
 struct TableEntry {
-    TableEntry* next;
-    TableEntry(TableEntry* next) : next(next) {}
-
-    Token* identifier;
+    AtomID identifier;
     ASTDecl* decl;
 };
 
+// Symbols of a single scope. Entries are stored in declaration order in one array and indexed by an open addressing
+// table of cache line sized groups. Each slot of a group has a one byte tag made from the hash of its identifier so a
+// lookup compares the tags of a whole group at once and only reads the entries whose tag matches. Most scopes only
+// declare a few names, so the groups are only made once a table outgrows a linear search of its entries.
+// Pointers to entries stay valid until the next insert
 struct SymTable {
-    static constexpr int NUM_BUCKETS = 32;
-    TableEntry* table[NUM_BUCKETS];
-
-    int id;  // TODO initialize id val
-    SymTable* parent;
-
-    ASTNode* source;
-
-    SymTable() : parent(nullptr) {
-        for (int i = 0; i < NUM_BUCKETS; i++) {
-            table[i] = nullptr;
-        }
-    }
-
-    ~SymTable() {
-        for (int i = 0; i < NUM_BUCKETS; i++) {
-            TableEntry* cur = table[i];
-            while (cur != nullptr) {
-                TableEntry* next = cur->next;
-                delete cur;
-                cur = next;
-            }
-        }
-    }
-
-    void insert(Token* identifier, ASTDecl* decl);
-    TableEntry* find(Token* identifier);
-};
\ No newline at end of file
+    static constexpr uint32_t GROUP_SLOTS = 12;
+    static constexpr uint32_t MAX_UNINDEXED = 8;  // Entries searched linearly before the table has any groups
+
+    struct alignas(64) Group {
+        uint8_t tags[16];  // EMPTY_TAG or a tag with the high bit set. The last 4 are always empty
+        uint32_t entries[GROUP_SLOTS];
+    };
+    static_assert(sizeof(Group) == 64, "Groups should fill exactly one cache line");
+
+   private:
+    std::vector<Group> groups;  // The number of groups is always 0 or a power of 2
+    std::vector<TableEntry> entries;
+
+    void grow();
+    void insert_index(uint32_t hash, uint32_t entry);
+
+   public:
+    ScopeID id = NULL_SCOPE;    // Scope the name resolver built the table for
+    SymTable* parent = nullptr;  // Innermost enclosing scope with a table
+
+    ASTNode* source = nullptr;
+
+    // Returns the entry which already declares the identifier, in which case nothing is inserted, or nullptr if the
+    // identifier was added
+    TableEntry* insert(AtomID identifier, ASTDecl* decl);
+    TableEntry* find(AtomID identifier);
+
+    inline size_t size() const { return entries.size(); }
+    inline TableEntry* begin() { return entries.data(); }
+    inline TableEntry* end() { return entries.data() + entries.size(); }
+};
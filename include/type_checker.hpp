@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.hpp"
+#include "diagnostics.hpp"
+#include "layout_table.hpp"
+#include "type_table.hpp"
+
+class NameResolver;
+
+// What the checker knows about the value of an expression. An expression of type Type also has the type it denotes
+// and an expression of type Module the module it is. NULL_TYPE is the type of anything which already caused an error
+// and of type parameters, and is accepted everywhere so that one mistake is only reported once
+struct CheckedValue {
+    TypeID type;
+    TypeID denoted;       // NULL_TYPE unless type is Type
+    const ASTMod* module;  // nullptr unless type is Module
+};
+
+// Checks the types of a parsed program. Declarations of the program, of modules and of types can be used before they
+// appear, so each of them is checked by its own task and the tasks are run by a scheduler instead of in source order.
+// A task which needs the type of a declaration that hasn't been checked yet is suspended and resumed once the type is
+// known, which makes the order of declarations irrelevant without ever checking anything twice. Tasks keep their work
+// on an explicit stack of frames rather than the call stack, so a suspended task resumes exactly where it stopped.
+// Bodies of functions with a return type only affect their own errors, so they are put aside until every declaration
+// outside of them has a type and then checked on several threads, or right away when there is only one. Each thread
+// has its own checker which extends this one with its own types, declarations and errors. Errors are sorted into
+// source order at the end so they are the same however the work was split up.
+// Once every type is known the layout of each ty {} is worked out, which finds the types which contain themselves.
+// Names must have been resolved, which parse_program does
+class TypeChecker {
+    using TaskID = uint32_t;
+    static constexpr TaskID NO_TASK = UINT32_MAX;
+    static constexpr uint32_t NO_DECL = UINT32_MAX;
+
+    struct DeclInfo {
+        ASTDecl* decl;
+        CheckedValue value;
+        TaskID task;         // Task which checks the declaration
+        TaskID firstWaiter;  // Tasks suspended until the type is known, linked through Task::nextWaiter
+        bool typed;
+    };
+
+    enum class TaskState : unsigned char { NEW, READY, SUSPENDED, DONE };
+    struct Frame {
+        ASTNode* node;
+        uint32_t step;  // How far the node has been checked
+        uint32_t base;  // Size of the value stack when the frame was pushed
+        uint32_t decl;  // Declaration the node is assigned to, whose type a function publishes as soon as it knows it
+        TypeID type;    // Declared type of a declaration, return type of a function or type of a type initialization
+    };
+    struct Task {
+        uint32_t decl;  // NO_DECL if the task checks a function body
+        uint32_t body;  // Index of the body in the parent checker
+        TaskState state;
+        uint32_t waitingOn;         // Declaration the task is suspended on
+        TaskID nextWaiter;          // Next task suspended on the same declaration
+        const ASTNode* waitNode;    // Use of the declaration which suspended the task
+        uint32_t walk;              // Last search for cycles which reached the task
+        std::vector<Frame> frames;  // Only hold anything while the task is suspended
+        std::vector<CheckedValue> values;
+    };
+
+    struct Body {
+        ASTFunc* func;
+        TypeID returnType;
+    };
+    struct Definition {
+        const ASTTy* ty;
+        TypeID type;
+    };
+    struct Worker;
+
+    TypeTable& types;
+    const TokenList& tokens;
+    const AtomTable& atoms;
+    Diagnostics& dx;
+
+    // A checker of function bodies reads the declarations and definitions of its parent, which are all done, and
+    // numbers its own after them
+    TypeChecker* parent = nullptr;
+    const NameResolver* resolver = nullptr;  // Explains names which aren't declared when it is set
+    uint32_t declBase = 0;
+    uint32_t definitionBase = 0;
+    std::vector<Body> bodies;  // Put aside to be checked in parallel
+
+    std::vector<DeclInfo> decls;
+    std::vector<Task> tasks;
+    std::vector<TaskID> ready;  // Run from the back so that a task wakes up or starts right after it is needed
+    std::vector<TaskID> suspended;
+    std::vector<Definition> definitions;  // Index of the operand of each DEFINED type
+    TaskID current = NO_TASK;
+
+    // Work of the running task
+    std::vector<Frame> frames;
+    std::vector<CheckedValue> values;
+    std::vector<TypeID> scratch;
+
+    LayoutTable layouts;
+
+    TypeID typeType;
+    TypeID moduleType;
+    TypeID voidType;
+    TypeID boolType;
+    TypeID intType;
+    TypeID doubleType;
+    TypeID stringType;
+
+    size_t numTasks = 0;
+    size_t numSuspensions = 0;
+    size_t numCycles = 0;
+    size_t numThreads = 0;
+
+    TypeChecker(TypeChecker& parent, TypeTable& types, Diagnostics& dx);
+
+    inline DeclInfo& info(uint32_t decl) { return decl < declBase ? parent->decls[decl] : decls[decl - declBase]; }
+    uint32_t info_of(ASTDecl* decl);
+    void spawn(ASTDecl* decl);
+    void publish(uint32_t decl, const CheckedValue& value);
+    bool need(uint32_t decl, const ASTNode& use);  // False if the running task has to be suspended
+    void run(TaskID task);
+    void run_all();
+    bool break_cycles();  // False if no task is suspended
+    void check_bodies();
+    void check_body(uint32_t body);
+    void check_layouts(uint32_t firstDefinition);  // Reports the types from the definition on which contain themselves
+
+    inline void push(ASTNode* node, uint32_t decl = NO_DECL) {
+        frames.push_back({node, 0, static_cast<uint32_t>(values.size()), decl, NULL_TYPE});
+    }
+    void push_declaration(ASTDecl* decl);
+    void push_statement(ASTNode* node);
+    void finish(CheckedValue value);
+    void finish_statement();
+
+    bool step();
+    void step_decl(Frame& frame);
+    void step_func(Frame& frame);
+    void step_ret(Frame& frame);
+    bool step_dot_op(Frame& frame);
+    bool step_type_init(Frame& frame);
+    void step_un_op(Frame& frame);
+    void step_bin_op(Frame& frame);
+    void step_call(Frame& frame);
+
+    TypeID signature_of(const Frame& funcFrame);
+    void publish_signature(const Frame& funcFrame);
+    bool expect(TypeID found, TypeID expected, const ASTNode& node);
+    TypeID expect_type(const CheckedValue& value, const ASTNode& node);  // Type the value denotes
+    inline std::string type_str(TypeID type) const { return types.to_str(type, atoms); }
+    std::string name_str(const ASTDecl& decl) const;
+
+   public:
+    TypeChecker(TypeTable& types, const TokenList& tokens, const AtomTable& atoms, Diagnostics& dx);
+
+    void check(ASTProgram& program);
+    // A name used before its declaration further down in a block is reported along with that declaration
+    inline void set_resolver(const NameResolver& names) { resolver = &names; }
+
+    // Checked type of a declaration or NULL_TYPE if it has none. Declarations inside of the function bodies which were
+    // checked in parallel are only known while their body is checked
+    inline TypeID type_of(const ASTDecl& decl) const {
+        if (decl.checkID < declBase) return parent->type_of(decl);
+        return decl.checkID - declBase < decls.size() ? decls[decl.checkID - declBase].value.type : NULL_TYPE;
+    }
+    // The ty {} expression which made a DEFINED type or nullptr if the type isn't DEFINED
+    const ASTTy* definition_of(TypeID type) const;
+
+    // Sizes, alignments and field offsets of the checked types
+    inline LayoutTable& layout_table() { return layouts; }
+
+    inline size_t task_count() const { return numTasks; }
+    inline size_t body_count() const { return bodies.size(); }
+    inline size_t thread_count() const { return numThreads; }
+    inline size_t suspension_count() const { return numSuspensions; }
+    inline size_t cycle_count() const { return numCycles; }
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "atom_table.hpp"
+
+enum class TokenType : unsigned char;
+class TokenList;
+struct ASTExpression;
+
+// Index of a canonical type in a TypeTable. Structurally identical types always have the same id
+using TypeID = uint32_t;
+constexpr TypeID NULL_TYPE = UINT32_MAX;
+
+enum class TypeKind : unsigned char {
+    PRIMITIVE,  // int, double, mod, ...
+    NAMED,      // Name which hasn't been resolved yet
+    MEMBER,     // Name of a member of another type like geo.Point
+    POINTER,
+    FUNCTION,
+    DEFINED,  // Made by a ty {} expression. name is the name it was declared with if there is one
+};
+
+// Operands are the types a type is made of: the type pointed to, the type a member belongs to or the parameters of a
+// function followed by its return type. The only operand of a DEFINED type is the index of the ty {} expression which
+// made it rather than a type, so that each expression makes a distinct type even if its members are the same
+struct Type {
+    TypeKind kind;
+    TokenType primitive;  // Type token of PRIMITIVE
+    AtomID name;          // NAMED and MEMBER
+    uint32_t firstOperand;
+    uint32_t numOperands;
+};
+
+// Hash-consed type expressions. A type is only added if no structurally identical type exists yet, so types are equal
+// exactly when their ids are. Operands are interned before the types made of them, which means comparing two types
+// never has to look past their own operand ids.
+// A table can extend a base table which no longer changes and doesn't extend another table itself. The types of the
+// base keep their ids and new types are numbered after them, so several threads can each intern into their own
+// extension of the same table
+class TypeTable {
+    struct Slot {
+        uint32_t hash;
+        TypeID type;  // NULL_TYPE if the slot is empty
+    };
+    std::vector<Slot> slots;  // Open addressing with linear probing. The size is always a power of 2
+    std::vector<Type> types;
+    std::vector<TypeID> operands;
+    std::vector<TypeID> scratch;  // Operands of the function types being interned with the innermost type's last
+
+    const TypeTable* base = nullptr;
+    TypeID baseSize = 0;  // Ids below are types of the base
+
+    void grow();
+    TypeID find(uint32_t hash, TypeKind kind, TokenType primitive, AtomID name, const TypeID* ops,
+                uint32_t numOps) const;
+    TypeID intern(TypeKind kind, TokenType primitive, AtomID name, const TypeID* ops, uint32_t numOps);
+    TypeID intern_scratch(TypeKind kind, size_t first);  // Interns the operands after first and pops them
+
+    inline const Type& local(TypeID type) const { return types[type - baseSize]; }
+
+   public:
+    TypeTable() = default;
+    explicit TypeTable(const TypeTable* base) : base(base), baseSize(static_cast<TypeID>(base->size())) {}
+
+    TypeID primitive(TokenType type);
+    TypeID named(AtomID name);
+    TypeID member(TypeID base, AtomID name);
+    TypeID pointer(TypeID inner);
+    TypeID function(const std::vector<TypeID>& params, TypeID returnType);
+    TypeID defined(uint32_t definition, AtomID name);
+
+    // Canonical type of a type annotation or NULL_TYPE if the expression isn't a type
+    TypeID intern_expr(const ASTExpression& typeExpr, const TokenList& tokens);
+
+    // Interns every type of other, which doesn't extend a table, in the order other made them and returns the id each
+    // one has in this table. Interning into other and then merging numbers the types the same as interning here would
+    std::vector<TypeID> merge(const TypeTable& other);
+
+    inline const Type& operator[](TypeID type) const { return type < baseSize ? (*base)[type] : local(type); }
+    inline TypeID operand(TypeID type, uint32_t i) const {
+        return type < baseSize ? base->operand(type, i) : operands[local(type).firstOperand + i];
+    }
+    inline size_t size() const { return baseSize + types.size(); }
+
+    inline size_t memory_usage() const {
+        return slots.capacity() * sizeof(Slot) + types.capacity() * sizeof(Type) +
+               operands.capacity() * sizeof(TypeID);
+    }
+
+    std::string to_str(TypeID type, const AtomTable& atoms) const;
+};
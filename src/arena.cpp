@@ -0,0 +1,76 @@
+#include "arena.hpp"
+
+namespace {
+
+constexpr size_t MAX_BLOCK_SIZE = 1 << 24;
+
+// Blocks start with their header so it is rounded up to keep the rest of the block aligned
+constexpr size_t MAX_ALIGN = alignof(std::max_align_t);
+constexpr size_t HEADER_SIZE = (2 * sizeof(size_t) + MAX_ALIGN - 1) & ~(MAX_ALIGN - 1);
+
+}  // namespace
+
+Arena::~Arena() {
+    while (head != nullptr) {
+        Block* prev = head->prev;
+        ::operator delete(head);
+        head = prev;
+    }
+    ::operator delete(spare);
+}
+
+void* Arena::allocate_slow(size_t size, size_t align) {
+    Block* block;
+    if (spare != nullptr && spare->size >= HEADER_SIZE + size + align) {
+        block = spare;
+        spare = nullptr;
+    } else {
+        // Blocks double in size so that even a large AST only needs a handful of them
+        size_t blockSize = nextBlockSize;
+        while (blockSize < size + align) blockSize *= 2;
+        if (nextBlockSize < MAX_BLOCK_SIZE) nextBlockSize *= 2;
+
+        block = static_cast<Block*>(::operator new(HEADER_SIZE + blockSize));
+        block->size = HEADER_SIZE + blockSize;
+    }
+    block->prev = head;
+    head = block;
+    reserved += block->size;
+
+    cur = reinterpret_cast<char*>(block) + HEADER_SIZE;
+    end = reinterpret_cast<char*>(block) + block->size;
+    return allocate(size, align);
+}
+
+void Arena::rewind(const Mark& mark) {
+    while (head != mark.head) {
+        Block* prev = head->prev;
+        reserved -= head->size;
+        ::operator delete(spare);
+        spare = head;
+        head = prev;
+    }
+    cur = mark.cur;
+    end = head == nullptr ? nullptr : reinterpret_cast<char*>(head) + head->size;
+}
+
+void Arena::absorb(Arena& other) {
+    if (other.head != nullptr) {
+        if (head == nullptr) {
+            head = other.head;
+            cur = other.cur;
+            end = other.end;
+        } else {
+            // The blocks go below the current one so that allocating carries on where it was
+            Block* oldest = other.head;
+            while (oldest->prev != nullptr) oldest = oldest->prev;
+            oldest->prev = head->prev;
+            head->prev = other.head;
+        }
+        reserved += other.reserved;
+    }
+    other.head = nullptr;
+    other.cur = nullptr;
+    other.end = nullptr;
+    other.reserved = 0;
+}
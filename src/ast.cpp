@@ -1,31 +1,160 @@
 #include "ast.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "diagnostics.hpp"
 #include "lexer.hpp"
 
-namespace internal {
+namespace {
 
-std::string indent_guide(int count) {
-    static constexpr int DUMP_INDENT_LENGTH = 2;
+constexpr int DUMP_INDENT_LENGTH = 2;
+constexpr size_t FLUSH_SIZE = 1 << 16;  // Output buffered before it's written to the stream
 
-    std::string base = "|" + std::string(DUMP_INDENT_LENGTH - 1, ' ');
-    std::string res = base;
-    for (int i = 1; i < count; i++) {
-        res += base;
+// Writes the dump or source of an AST into one buffer without recursing. A node is expanded into the pieces of its
+// output, which go onto a stack in reverse so they come off it in order, and child nodes are expanded only once they
+// come off the stack themselves. The stack holds just what's left to write of the nodes along the current path, so
+// memory is linear and deep trees can't overflow the call stack
+class ASTWriter {
+    enum class Piece : unsigned char {
+        DUMP,    // Dump of node with the indent guide count
+        SOURCE,  // print_ast of node with the indent count
+        EXPR,    // print_expr of node
+        TEXT,
+        NODE_TYPE,
+        TOKEN_TYPE,
+        LITERAL,
+        GUIDE,   // Indent guide repeated count times
+        INDENT,  // Indent repeated count times
+    };
+    struct Work {
+        Piece piece;
+        union {
+            NodeType nodeType;
+            TokenType tokenType;
+        };
+        uint32_t count;
+        union {
+            const ASTNode* node;
+            const char* text;  // count is the length
+            TokenID token;
+        };
+    };
+
+    const TokenList& tokens;
+    bool verbose;
+    std::string& out;
+    std::ostream* stream;  // Written to and cleared whenever out gets large, or null to keep everything in out
+
+    std::vector<Work> stack;
+
+    inline void push(Piece piece, uint32_t count) {
+        Work work;
+        work.piece = piece;
+        work.count = count;
+        work.node = nullptr;
+        stack.push_back(work);
     }
-    return res;
-}
+    inline void push_node(Piece piece, const ASTNode* node, int count) {
+        push(piece, static_cast<uint32_t>(count));
+        stack.back().node = node;
+    }
+
+    inline void dump(const ASTNode* node, int indentCt) { push_node(Piece::DUMP, node, indentCt); }
+    inline void source(const ASTNode* node, int indentCt) { push_node(Piece::SOURCE, node, indentCt); }
+    inline void expr(const ASTNode* node) { push_node(Piece::EXPR, node, 0); }
+    inline void text(std::string_view str) {
+        push(Piece::TEXT, static_cast<uint32_t>(str.size()));
+        stack.back().text = str.data();
+    }
+    inline void node_type(NodeType type) {
+        push(Piece::NODE_TYPE, 0);
+        stack.back().nodeType = type;
+    }
+    inline void token_type(TokenType type) {
+        push(Piece::TOKEN_TYPE, 0);
+        stack.back().tokenType = type;
+    }
+    inline void literal(TokenID value) {
+        push(Piece::LITERAL, 0);
+        stack.back().token = value;
+    }
+    inline void guide(int count) { push(Piece::GUIDE, static_cast<uint32_t>(count)); }
+    inline void indent(int count) { push(Piece::INDENT, static_cast<uint32_t>(count)); }
+
+    void expand_dump(const ASTNode& node, int indentCt);
+    void expand_source(const ASTNode& node, int indentCt);
+    void expand_expr(const ASTNode& expr);
+
+   public:
+    ASTWriter(const TokenList& tokens, bool verbose, std::string& out, std::ostream* stream)
+        : tokens(tokens), verbose(verbose), out(out), stream(stream) {}
+
+    void write_dump(const ASTNode& node) { write(Piece::DUMP, node); }
+    void write_source(const ASTNode& node) { write(Piece::SOURCE, node); }
+    void write_expr(const ASTNode& node) { write(Piece::EXPR, node); }
 
-inline std::string indent(int count) { return std::string(Lexer::TAB_WIDTH * count, ' '); }
+   private:
+    void write(Piece piece, const ASTNode& root);
+};
 
-std::string recur_dump(const ASTNode& node, int indentCt, bool verbose);
+void ASTWriter::write(Piece piece, const ASTNode& root) {
+    push_node(piece, &root, 0);
+    while (!stack.empty()) {
+        Work work = stack.back();
+        stack.pop_back();
 
-std::string recur_print_ast(const ASTNode& node, int indentCt);
+        size_t expansion = stack.size();
+        switch (work.piece) {
+            case Piece::DUMP:
+                expand_dump(*work.node, static_cast<int>(work.count));
+                break;
+            case Piece::SOURCE:
+                expand_source(*work.node, static_cast<int>(work.count));
+                break;
+            case Piece::EXPR:
+                expand_expr(*work.node);
+                break;
+            case Piece::TEXT:
+                out.append(work.text, work.count);
+                break;
+            case Piece::NODE_TYPE:
+                out += node_type_to_str(work.nodeType);
+                break;
+            case Piece::TOKEN_TYPE:
+                out += token_type_to_str(work.tokenType);
+                break;
+            case Piece::LITERAL:
+                out += print_literal(work.token, tokens);
+                break;
+            case Piece::GUIDE:
+                // Even a count of 0 has one guide
+                for (uint32_t i = 0; i < std::max(work.count, 1u); i++) {
+                    out += '|';
+                    out.append(DUMP_INDENT_LENGTH - 1, ' ');
+                }
+                break;
+            case Piece::INDENT:
+                out.append(Lexer::TAB_WIDTH * work.count, ' ');
+                break;
+        }
+        std::reverse(stack.begin() + expansion, stack.end());
+
+        if (stream != nullptr && out.size() >= FLUSH_SIZE) {
+            stream->write(out.data(), out.size());
+            out.clear();
+        }
+    }
+    if (stream != nullptr) {
+        stream->write(out.data(), out.size());
+        out.clear();
+    }
+}
 
-}  // namespace internal
+}  // namespace
 
 std::string node_type_to_str(NodeType type) {
     switch (type) {
@@ -76,57 +205,87 @@ std::string node_type_to_str(NodeType type) {
     }
 }
 
-void dump_ast(const ASTNode& node, bool verbose) { std::cout << internal::recur_dump(node, 0, verbose) << std::endl; }
+void dump_ast(const ASTNode& node, const TokenList& tokens, bool verbose) {
+    std::string buffer;
+    ASTWriter(tokens, verbose, buffer, &std::cout).write_dump(node);
+    std::cout << std::endl;
+}
+
+void print_ast(const ASTNode& node, const TokenList& tokens, std::ostream& stream) {
+    std::string buffer;
+    ASTWriter(tokens, false, buffer, &stream).write_source(node);
+}
+
+std::string print_ast(const ASTNode& node, const TokenList& tokens) {
+    std::string str;
+    ASTWriter(tokens, false, str, nullptr).write_source(node);
+    return str;
+}
+
+std::string print_expr(const ASTExpression& expr, const TokenList& tokens) {
+    std::string str;
+    ASTWriter(tokens, false, str, nullptr).write_expr(expr);
+    return str;
+}
 
-std::string internal::recur_dump(const ASTNode& node, int indentCt, bool verbose) {
-    std::string dump = indent_guide(indentCt) + node_type_to_str(node.nodeType) + " ";
+void ASTWriter::expand_dump(const ASTNode& node, int indentCt) {
+    guide(indentCt);
+    node_type(node.nodeType);
+    text(" ");
     switch (node.nodeType) {
         case NodeType::PROGRAM: {
             auto& prgm = static_cast<const ASTProgram&>(node);
-            dump += "\n";
+            text("\n");
             for (auto&& decl : prgm.declarations) {
-                dump += recur_dump(*decl, indentCt + 1, verbose) + "\n";
+                dump(decl, indentCt + 1);
+                text("\n");
             }
         } break;
         case NodeType::BLOCK: {
             auto& block = static_cast<const ASTBlock&>(node);
             if (!block.statements.empty()) {
-                dump += "\n";
-                for (auto&& stmt : block.statements) {
-                    dump += recur_dump(*stmt, indentCt + 1, verbose) + "\n";
+                text("\n");
+                for (size_t i = 0; i < block.statements.size(); i++) {
+                    if (i > 0) text("\n");
+                    dump(block.statements[i], indentCt + 1);
                 }
-                dump = dump.substr(0, dump.length() - 1);
             } else {
-                dump += " {EMPTY}";
+                text(" {EMPTY}");
             }
         } break;
         case NodeType::IF: {
             auto& ifStmt = static_cast<const ASTIf&>(node);
             if (verbose) {
-                dump += "\n";
-                dump += indent_guide(indentCt + 1) + "<condition>\n";
-                dump += recur_dump(*ifStmt.condition, indentCt + 2, verbose) + "\n";
-                dump += indent_guide(indentCt + 1) + "<conseq>\n";
-                dump += recur_dump(*ifStmt.conseq, indentCt + 2, verbose);
+                text("\n");
+                guide(indentCt + 1);
+                text("<condition>\n");
+                dump(ifStmt.condition, indentCt + 2);
+                text("\n");
+                guide(indentCt + 1);
+                text("<conseq>\n");
+                dump(ifStmt.conseq, indentCt + 2);
             } else {
-                dump += print_expr(*ifStmt.condition) + "\n";
-                dump += recur_dump(*ifStmt.conseq, indentCt + 1, verbose);
+                expr(ifStmt.condition);
+                text("\n");
+                dump(ifStmt.conseq, indentCt + 1);
             }
             if (ifStmt.alt != nullptr) {
-                dump += "\n";
-                dump += indent_guide(indentCt + 1) + "<alt>\n";
-                dump += recur_dump(*ifStmt.alt, indentCt + 2, verbose);
+                text("\n");
+                guide(indentCt + 1);
+                text("<alt>\n");
+                dump(ifStmt.alt, indentCt + 2);
             }
         } break;
         case NodeType::FOR: {
             ASSERT(false, "Unimplemented for loop dump");
             auto& forLoop = static_cast<const ASTFor&>(node);
-            dump += "\n";
+            text("\n");
             if (verbose) {
-                dump += indent_guide(indentCt + 1) + "<blockStmt>\n";
-                dump += recur_dump(*forLoop.blockStmt, indentCt + 2, verbose);
+                guide(indentCt + 1);
+                text("<blockStmt>\n");
+                dump(forLoop.blockStmt, indentCt + 2);
             } else {
-                dump += recur_dump(*forLoop.blockStmt, indentCt + 1, verbose);
+                dump(forLoop.blockStmt, indentCt + 1);
             }
         } break;
         case NodeType::BREAK:
@@ -135,449 +294,484 @@ std::string internal::recur_dump(const ASTNode& node, int indentCt, bool verbose
         case NodeType::RET: {
             auto& ret = static_cast<const ASTRet&>(node);
             if (ret.retValue != nullptr) {
-                dump += "\n";
-                dump += recur_dump(*ret.retValue, indentCt + 1, verbose);
+                text("\n");
+                dump(ret.retValue, indentCt + 1);
             }
         } break;
         case NodeType::DECL: {
             auto& decl = static_cast<const ASTDecl&>(node);
             if (verbose) {
-                dump += "\n";
-                dump += indent_guide(indentCt + 1) + "<lvalue>\n";
-                dump += recur_dump(*decl.lvalue, indentCt + 2, verbose) + "\n";
+                text("\n");
+                guide(indentCt + 1);
+                text("<lvalue>\n");
+                dump(decl.lvalue, indentCt + 2);
+                text("\n");
             } else {
-                dump += print_expr(*decl.lvalue) + "\n";
+                expr(decl.lvalue);
+                text("\n");
             }
             if (decl.type != nullptr) {
+                guide(indentCt + 1);
                 if (verbose) {
-                    dump += indent_guide(indentCt + 1) + "<type>\n";
-                    dump += recur_dump(*decl.type, indentCt + 2, verbose);
+                    text("<type>\n");
+                    dump(decl.type, indentCt + 2);
                 } else {
-                    dump += indent_guide(indentCt + 1) + ": " + print_expr(*decl.type);
+                    text(": ");
+                    expr(decl.type);
                 }
-                if (decl.rvalue != nullptr) dump += "\n";
+                if (decl.rvalue != nullptr) text("\n");
             }
             if (decl.rvalue != nullptr) {
+                guide(indentCt + 1);
                 if (verbose) {
-                    dump += indent_guide(indentCt + 1);
-                    dump += "<assignType> " + token_type_to_str(decl.assignType->type) + "\n";
-                    dump += indent_guide(indentCt + 1) + "<rvalue>\n";
-                    dump += recur_dump(*decl.rvalue, indentCt + 2, verbose);
+                    text("<assignType> ");
+                    token_type(tokens.type(decl.assignType));
+                    text("\n");
+                    guide(indentCt + 1);
+                    text("<rvalue>\n");
+                    dump(decl.rvalue, indentCt + 2);
                 } else {
-                    dump += indent_guide(indentCt + 1);
-                    dump += token_type_to_str(decl.assignType->type) + " ";
+                    token_type(tokens.type(decl.assignType));
+                    text(" ");
                     if (decl.rvalue->nodeType == NodeType::MOD || decl.rvalue->nodeType == NodeType::TYPE_DEF ||
                         decl.rvalue->nodeType == NodeType::FUNC) {
-                        dump += "\n";
-                        dump += recur_dump(*decl.rvalue, indentCt + 1, verbose);
+                        text("\n");
+                        dump(decl.rvalue, indentCt + 1);
                     } else {
-                        dump += print_expr(*decl.rvalue);
+                        expr(decl.rvalue);
                     }
                 }
             }
         } break;
-        case NodeType::TYPE_LIT: {
-            auto& typeLit = static_cast<const ASTTypeLit&>(node);
-            dump += print_ast(typeLit);
-        } break;
+        case NodeType::TYPE_LIT:
+            source(&node, 0);
+            break;
         case NodeType::FUNC_TYPE: {
             auto& funcType = static_cast<const ASTFuncType&>(node);
-            dump += "\n";
+            text("\n");
             if (!funcType.inTypes.empty()) {
-                dump += indent_guide(indentCt + 1) + "<inTypes>\n";
+                guide(indentCt + 1);
+                text("<inTypes>\n");
                 for (auto&& type : funcType.inTypes) {
-                    dump += recur_dump(*type, indentCt + 3, verbose) + "\n";
+                    dump(type, indentCt + 3);
+                    text("\n");
                 }
             }
-            dump += indent_guide(indentCt + 1) + "<outType>\n";
-            dump += indent_guide(indentCt + 2) + print_ast(*funcType.outType);
+            guide(indentCt + 1);
+            text("<outType>\n");
+            guide(indentCt + 2);
+            source(funcType.outType, 0);
         } break;
         case NodeType::MOD: {
             auto& mod = static_cast<const ASTMod&>(node);
             if (!mod.declarations.empty()) {
-                dump += "\n";
+                text("\n");
                 if (verbose) {
-                    dump += indent_guide(indentCt + 1);
-                    dump += "<declarations>\n";
+                    guide(indentCt + 1);
+                    text("<declarations>\n");
                     indentCt++;  // HACK to force an extra indent
                 }
-                for (auto&& decl : mod.declarations) {
-                    dump += recur_dump(*decl, indentCt + 1, verbose) + "\n";
+                for (size_t i = 0; i < mod.declarations.size(); i++) {
+                    if (i > 0) text("\n");
+                    dump(mod.declarations[i], indentCt + 1);
                 }
-                dump = dump.substr(0, dump.length() - 1);
             } else {
-                dump += "{EMPTY}";
+                text("{EMPTY}");
             }
         } break;
         case NodeType::TYPE_DEF: {
             auto& typeDef = static_cast<const ASTTy&>(node);
             if (!typeDef.declarations.empty()) {
-                dump += "\n";
+                text("\n");
                 if (verbose) {
-                    dump += indent_guide(indentCt + 1);
-                    dump += "<declarations>\n";
+                    guide(indentCt + 1);
+                    text("<declarations>\n");
                     indentCt++;  // HACK to force an extra indent
                 }
-                for (auto&& decl : typeDef.declarations) {
-                    dump += recur_dump(*decl, indentCt + 1, verbose) + "\n";
+                for (size_t i = 0; i < typeDef.declarations.size(); i++) {
+                    if (i > 0) text("\n");
+                    dump(typeDef.declarations[i], indentCt + 1);
                 }
-                dump = dump.substr(0, dump.length() - 1);
             } else {
-                dump += " {EMPTY}";
+                text(" {EMPTY}");
             }
         } break;
         case NodeType::FUNC: {
             auto& func = static_cast<const ASTFunc&>(node);
-            dump += "\n";
+            text("\n");
             if (!func.parameters.empty()) {
+                guide(indentCt + 1);
                 if (verbose) {
-                    dump += indent_guide(indentCt + 1) + "<parameters>\n";
+                    text("<parameters>\n");
                     for (auto&& param : func.parameters) {
-                        dump += recur_dump(*param, indentCt + 2, verbose) + "\n";
+                        dump(param, indentCt + 2);
+                        text("\n");
                     }
                 } else {
-                    dump += indent_guide(indentCt + 1) + "(";
-                    for (int i = 0; i < func.parameters.size(); i++) {
-                        dump += print_ast(*func.parameters[i]);
-                        if (i + 1 < func.parameters.size()) {
-                            dump += ", ";
-                        }
+                    text("(");
+                    for (size_t i = 0; i < func.parameters.size(); i++) {
+                        if (i > 0) text(", ");
+                        source(func.parameters[i], 0);
                     }
-                    dump += ")\n";
+                    text(")\n");
                 }
             }
             if (func.returnType != nullptr) {
+                guide(indentCt + 1);
                 if (verbose) {
-                    dump += indent_guide(indentCt + 1) + "<returnType>\n";
-                    dump += recur_dump(*func.returnType, indentCt + 2, verbose) + "\n";
+                    text("<returnType>\n");
+                    dump(func.returnType, indentCt + 2);
                 } else {
-                    dump += indent_guide(indentCt + 1) + "-> ";
-                    dump += print_ast(*func.returnType) + "\n";
+                    text("-> ");
+                    source(func.returnType, 0);
                 }
+                text("\n");
             }
             if (verbose) {
-                dump += indent_guide(indentCt + 1) + "<blockStmt>\n";
+                guide(indentCt + 1);
+                text("<blockStmt>\n");
                 indentCt++;  // HACK to force an extra indent
             }
-            dump += recur_dump(*func.blockOrExpr, indentCt + 1, verbose);
-        } break;
-        case NodeType::NAME: {
-            auto& name = static_cast<const ASTName&>(node);
-            dump += print_ast(name);
+            dump(func.blockOrExpr, indentCt + 1);
         } break;
+        case NodeType::NAME:
+            source(&node, 0);
+            break;
         case NodeType::DOT_OP: {
             auto& dotOp = static_cast<const ASTDotOp&>(node);
-            dump += "\n";
-            dump += indent_guide(indentCt + 1) + "<base>\n" + recur_dump(*dotOp.base, indentCt + 2, verbose) + "\n";
-            dump += indent_guide(indentCt + 1) + "<member>\n" + recur_dump(*dotOp.member, indentCt + 2, verbose);
+            text("\n");
+            guide(indentCt + 1);
+            text("<base>\n");
+            dump(dotOp.base, indentCt + 2);
+            text("\n");
+            guide(indentCt + 1);
+            text("<member>\n");
+            dump(dotOp.member, indentCt + 2);
         } break;
         case NodeType::CALL: {
             auto& call = static_cast<const ASTCall&>(node);
-            dump += "\n";
-            dump += indent_guide(indentCt + 1);
-            dump += "<callRef>\n" + recur_dump(*call.callRef, indentCt + 2, verbose);
+            text("\n");
+            guide(indentCt + 1);
+            text("<callRef>\n");
+            dump(call.callRef, indentCt + 2);
             if (!call.arguments.empty()) {
-                dump += "\n";
-                dump += indent_guide(indentCt + 1) + "<arguments>\n";
-                for (auto&& expr : call.arguments) {
-                    dump += recur_dump(*expr, indentCt + 2, verbose) + "\n";
+                text("\n");
+                guide(indentCt + 1);
+                text("<arguments>\n");
+                for (size_t i = 0; i < call.arguments.size(); i++) {
+                    if (i > 0) text("\n");
+                    dump(call.arguments[i], indentCt + 2);
                 }
-                dump = dump.substr(0, dump.length() - 1);
             }
         } break;
         case NodeType::TYPE_INIT: {
             auto& typeInit = static_cast<const ASTTypeInit&>(node);
-            dump += "\n";
-            dump += indent_guide(indentCt + 1) + "<typeRef>\n" + recur_dump(*typeInit.typeRef, indentCt + 2, verbose);
+            text("\n");
+            guide(indentCt + 1);
+            text("<typeRef>\n");
+            dump(typeInit.typeRef, indentCt + 2);
             if (!typeInit.assignments.empty()) {
-                dump += "\n";
-                dump += indent_guide(indentCt + 1) + "<assignments>\n";
-                for (auto&& assignment : typeInit.assignments) {
-                    dump += indent_guide(indentCt + 2) + "Assignment\n";
-                    dump += indent_guide(indentCt + 3) + "<fieldRef> " + print_ast(*assignment->lvalue) + "\n";
-                    dump += indent_guide(indentCt + 3) + "<rvalue>\n";
-                    dump += recur_dump(*assignment->rvalue, indentCt + 4, verbose) + "\n";
+                text("\n");
+                guide(indentCt + 1);
+                text("<assignments>\n");
+                for (size_t i = 0; i < typeInit.assignments.size(); i++) {
+                    if (i > 0) text("\n");
+                    guide(indentCt + 2);
+                    text("Assignment\n");
+                    guide(indentCt + 3);
+                    text("<fieldRef> ");
+                    source(typeInit.assignments[i]->lvalue, 0);
+                    text("\n");
+                    guide(indentCt + 3);
+                    text("<rvalue>\n");
+                    dump(typeInit.assignments[i]->rvalue, indentCt + 4);
                 }
-                dump = dump.substr(0, dump.length() - 1);
             }
         } break;
-        case NodeType::LIT: {
-            auto& lit = static_cast<const ASTLit&>(node);
-            dump += print_ast(lit);
-        } break;
+        case NodeType::LIT:
+            source(&node, 0);
+            break;
         case NodeType::UN_OP: {
             auto& unOp = static_cast<const ASTUnOp&>(node);
-            dump += "\n";
-            dump += indent_guide(indentCt + 1) + "<op> " + token_type_to_str(unOp.op->type) + "\n";
-            dump += indent_guide(indentCt + 1) + "<inner>\n" + recur_dump(*unOp.inner, indentCt + 2, verbose);
+            text("\n");
+            guide(indentCt + 1);
+            text("<op> ");
+            token_type(tokens.type(unOp.op));
+            text("\n");
+            guide(indentCt + 1);
+            text("<inner>\n");
+            dump(unOp.inner, indentCt + 2);
         } break;
         case NodeType::DEREF: {
             auto& deref = static_cast<const ASTDeref&>(node);
-            dump += "\n";
-            dump += indent_guide(indentCt + 1) + "<inner>\n" + recur_dump(*deref.inner, indentCt + 2, verbose);
+            text("\n");
+            guide(indentCt + 1);
+            text("<inner>\n");
+            dump(deref.inner, indentCt + 2);
         } break;
         case NodeType::BIN_OP: {
             auto& binOp = static_cast<const ASTBinOp&>(node);
-            dump += "\n";
-            dump += indent_guide(indentCt + 1) + "<left>\n" + recur_dump(*binOp.left, indentCt + 2, verbose) + "\n";
-            dump += indent_guide(indentCt + 1) + "<op> " + token_type_to_str(binOp.op->type) + "\n";
-            dump += indent_guide(indentCt + 1) + "<right>\n" + recur_dump(*binOp.right, indentCt + 2, verbose);
+            text("\n");
+            guide(indentCt + 1);
+            text("<left>\n");
+            dump(binOp.left, indentCt + 2);
+            text("\n");
+            guide(indentCt + 1);
+            text("<op> ");
+            token_type(tokens.type(binOp.op));
+            text("\n");
+            guide(indentCt + 1);
+            text("<right>\n");
+            dump(binOp.right, indentCt + 2);
         } break;
         default:
             ASSERT(false, "TODO DELETE: Unimplemented AST dump for node");
     }
-    return dump;
 }
 
-std::string print_ast(const ASTNode& node) { return internal::recur_print_ast(node, 0); }
-
-std::string internal::recur_print_ast(const ASTNode& node, int indentCt) {
-    std::string str;
+void ASTWriter::expand_source(const ASTNode& node, int indentCt) {
     switch (node.nodeType) {
         case NodeType::PROGRAM: {
             auto& prgm = static_cast<const ASTProgram&>(node);
             for (auto&& decl : prgm.declarations) {
-                str += recur_print_ast(*decl, indentCt) + "\n";
+                source(decl, indentCt);
+                text("\n");
             }
         } break;
         case NodeType::BLOCK: {
             auto& block = static_cast<const ASTBlock&>(node);
-            str += "{\n";
-            for (auto& stmt : block.statements) {
-                str += indent(indentCt + 1) + recur_print_ast(*stmt, indentCt + 1);
-                str += "\n";
-            }
-            str += indent(indentCt) + "}";
+            text("{\n");
+            for (auto&& stmt : block.statements) {
+                indent(indentCt + 1);
+                source(stmt, indentCt + 1);
+                text("\n");
+            }
+            indent(indentCt);
+            text("}");
         } break;
         case NodeType::IF: {
             auto& ifStmt = static_cast<const ASTIf&>(node);
-            str += "if " + recur_print_ast(*ifStmt.condition, indentCt) + " ";
-            str += recur_print_ast(*ifStmt.conseq, indentCt);
+            text("if ");
+            source(ifStmt.condition, indentCt);
+            text(" ");
+            source(ifStmt.conseq, indentCt);
             if (ifStmt.alt != nullptr) {
-                str += " else ";
-                str += recur_print_ast(*ifStmt.alt, indentCt);
+                text(" else ");
+                source(ifStmt.alt, indentCt);
             }
         } break;
         case NodeType::FOR: {
             auto& forLoop = static_cast<const ASTFor&>(node);
-            str += "for ";
+            text("for ");
             if (forLoop.initial != nullptr) {
-                str += recur_print_ast(*forLoop.initial, indentCt) + ", ";
+                source(forLoop.initial, indentCt);
+                text(", ");
             }
             if (forLoop.condition != nullptr) {
-                str += print_expr(*forLoop.condition);
-                if (forLoop.post != nullptr) str += ",";
-                str += " ";
+                expr(forLoop.condition);
+                if (forLoop.post != nullptr) text(",");
+                text(" ");
             }
             if (forLoop.post != nullptr) {
-                str += recur_print_ast(*forLoop.post, indentCt) + " ";
+                source(forLoop.post, indentCt);
+                text(" ");
             }
-            str += recur_print_ast(*forLoop.blockStmt, indentCt);
+            source(forLoop.blockStmt, indentCt);
         } break;
-        case NodeType::BREAK: {
-            return "break";
-        }
-        case NodeType::CONT: {
-            return "continue";
-        }
+        case NodeType::BREAK:
+            text("break");
+            break;
+        case NodeType::CONT:
+            text("continue");
+            break;
         case NodeType::RET: {
             auto& ret = static_cast<const ASTRet&>(node);
-            str += "return";
+            text("return");
             if (ret.retValue != nullptr) {
-                str += " " + recur_print_ast(*ret.retValue, indentCt);
+                text(" ");
+                source(ret.retValue, indentCt);
             }
         } break;
         case NodeType::DECL: {
             auto& decl = static_cast<const ASTDecl&>(node);
-            str += recur_print_ast(*decl.lvalue, indentCt);
+            source(decl.lvalue, indentCt);
             if (decl.type != nullptr) {
-                str += ": " + print_expr(*decl.type);
+                text(": ");
+                expr(decl.type);
             }
-            if (decl.assignType != nullptr) {
-                str += " " + token_type_to_str(decl.assignType->type) + " ";
-            }
-            if (decl.rvalue != nullptr) {
-                str += recur_print_ast(*decl.rvalue, indentCt);
+            if (decl.assignType != NULL_TOKEN) {
+                text(" ");
+                token_type(tokens.type(decl.assignType));
+                text(" ");
             }
+            if (decl.rvalue != nullptr) source(decl.rvalue, indentCt);
         } break;
-        case NodeType::MOD: {
-            auto& mod = static_cast<const ASTMod&>(node);
-            str += "mod {\n";
-            for (auto&& decl : mod.declarations) {
-                str += indent(indentCt + 1) + recur_print_ast(*decl, indentCt + 1);
-                str += "\n";
-            }
-            str += indent(indentCt) + "}";
-        } break;
+        case NodeType::MOD:
         case NodeType::TYPE_DEF: {
-            auto& typeDef = static_cast<const ASTTy&>(node);
-            str += "ty {\n";
-            for (auto&& decl : typeDef.declarations) {
-                str += indent(indentCt + 1) + recur_print_ast(*decl, indentCt + 1);
-                str += "\n";
-            }
-            str += indent(indentCt) + "}";
+            auto& declarations = node.nodeType == NodeType::MOD ? static_cast<const ASTMod&>(node).declarations
+                                                                : static_cast<const ASTTy&>(node).declarations;
+            text(node.nodeType == NodeType::MOD ? "mod {\n" : "ty {\n");
+            for (auto&& decl : declarations) {
+                indent(indentCt + 1);
+                source(decl, indentCt + 1);
+                text("\n");
+            }
+            indent(indentCt);
+            text("}");
         } break;
         case NodeType::FUNC: {
             auto& func = static_cast<const ASTFunc&>(node);
-            str = "(";
-            for (int i = 0; i < func.parameters.size(); i++) {
-                str += print_ast(*func.parameters[i]);
-                if (i + 1 < func.parameters.size()) {
-                    str += ", ";
-                }
+            text("(");
+            for (size_t i = 0; i < func.parameters.size(); i++) {
+                if (i > 0) text(", ");
+                source(func.parameters[i], 0);
             }
             if (func.returnType != nullptr) {
-                str += ") -> " + recur_print_ast(*func.returnType, indentCt) + " ";
+                text(") -> ");
+                source(func.returnType, indentCt);
+                text(" ");
             } else {
-                str += ") ";
+                text(") ");
             }
-            if (func.blockOrExpr->nodeType != NodeType::BLOCK) {
-                str += ":: ";
-            }
-            str += recur_print_ast(*func.blockOrExpr, indentCt);
+            if (func.blockOrExpr->nodeType != NodeType::BLOCK) text(":: ");
+            source(func.blockOrExpr, indentCt);
         } break;
         default:
-            return print_expr(static_cast<const ASTExpression&>(node));
+            expand_expr(node);
     }
-    return str;
 }
 
-std::string print_expr(const ASTExpression& expr) {
-    std::string str;
+void ASTWriter::expand_expr(const ASTNode& expr) {
     switch (expr.nodeType) {
-        case NodeType::TYPE_LIT: {
-            auto& typeLit = static_cast<const ASTTypeLit&>(expr);
-            return token_type_to_str(typeLit.type);
-        }
+        case NodeType::TYPE_LIT:
+            token_type(static_cast<const ASTTypeLit&>(expr).type);
+            break;
         case NodeType::FUNC_TYPE: {
             auto& funcType = static_cast<const ASTFuncType&>(expr);
-            str += "(";
-            for (int i = 0; i < funcType.inTypes.size(); i++) {
-                str += print_expr(*funcType.inTypes[i]);
-                if (i + 1 < funcType.inTypes.size()) {
-                    str += ", ";
-                }
+            text("(");
+            for (size_t i = 0; i < funcType.inTypes.size(); i++) {
+                if (i > 0) text(", ");
+                this->expr(funcType.inTypes[i]);
             }
-            str += ") -> " + print_expr(*funcType.outType);
+            text(") -> ");
+            this->expr(funcType.outType);
         } break;
-        case NodeType::MOD: {
-            auto& mod = static_cast<const ASTTy&>(expr);
-
-            std::string declListStr;
-            for (int i = 0; i < mod.declarations.size(); i++) {
-                auto&& decl = mod.declarations[i];
-                declListStr += print_expr(*decl->lvalue);
-                if (decl->type != nullptr) declListStr += ": " + print_expr(*decl->type);
-                if (decl->rvalue != nullptr) {
-                    declListStr += token_type_to_str(decl->assignType->type);
-                    declListStr += print_expr(*decl->rvalue);
-                }
-                if (i + 1 < mod.declarations.size()) {
-                    declListStr += ", ";
-                }
-            }
-            return "mod {" + declListStr + "}";
-        }
+        case NodeType::MOD:
         case NodeType::TYPE_DEF: {
-            auto& typeDef = static_cast<const ASTTy&>(expr);
-            std::string declListStr;
-            for (int i = 0; i < typeDef.declarations.size(); i++) {
-                auto&& decl = typeDef.declarations[i];
-                declListStr += print_expr(*decl->lvalue);
-                if (decl->type != nullptr) declListStr += ": " + print_expr(*decl->type);
-                if (decl->rvalue != nullptr) {
-                    declListStr += token_type_to_str(decl->assignType->type);
-                    declListStr += print_expr(*decl->rvalue);
+            auto& declarations = expr.nodeType == NodeType::MOD ? static_cast<const ASTMod&>(expr).declarations
+                                                                : static_cast<const ASTTy&>(expr).declarations;
+            text(expr.nodeType == NodeType::MOD ? "mod {" : "ty {");
+            for (size_t i = 0; i < declarations.size(); i++) {
+                if (i > 0) text(", ");
+                this->expr(declarations[i]->lvalue);
+                if (declarations[i]->type != nullptr) {
+                    text(": ");
+                    this->expr(declarations[i]->type);
                 }
-                if (i + 1 < typeDef.declarations.size()) {
-                    declListStr += ", ";
+                if (declarations[i]->rvalue != nullptr) {
+                    token_type(tokens.type(declarations[i]->assignType));
+                    this->expr(declarations[i]->rvalue);
                 }
             }
-            return "ty {" + declListStr + "}";
-        }
+            text("}");
+        } break;
         case NodeType::FUNC: {
             auto& func = static_cast<const ASTFunc&>(expr);
-            std::string paramListStr;
-            for (int i = 0; i < func.parameters.size(); i++) {
-                paramListStr += print_ast(*func.parameters[i]);
-                if (i + 1 < func.parameters.size()) {
-                    paramListStr += ", ";
-                }
+            text("(");
+            for (size_t i = 0; i < func.parameters.size(); i++) {
+                if (i > 0) text(", ");
+                source(func.parameters[i], 0);
             }
             if (func.returnType != nullptr) {
-                return "(" + paramListStr + ") -> " + print_expr(*func.returnType) + " {...}";
+                text(") -> ");
+                this->expr(func.returnType);
+                text(" {...}");
             } else {
-                return "(" + paramListStr + ") {...}";
+                text(") {...}");
             }
-        }
-        case NodeType::NAME: {
-            return static_cast<const ASTName&>(expr).ref->get_string_val();
-        }
+        } break;
+        case NodeType::NAME:
+            text(tokens.str(static_cast<const ASTName&>(expr).ref));
+            break;
         case NodeType::DOT_OP: {
             auto& dotOp = static_cast<const ASTDotOp&>(expr);
-            return "(" + print_expr(*dotOp.base) + "." + print_expr(*dotOp.member) + ")";
-        }
+            text("(");
+            this->expr(dotOp.base);
+            text(".");
+            this->expr(dotOp.member);
+            text(")");
+        } break;
         case NodeType::CALL: {
             auto& call = static_cast<const ASTCall&>(expr);
-            str = print_expr(*call.callRef) + "(";
-            for (int i = 0; i < call.arguments.size(); i++) {
-                str += print_expr(*call.arguments[i]);
-                if (i + 1 < call.arguments.size()) {
-                    str += ", ";
-                }
+            this->expr(call.callRef);
+            text("(");
+            for (size_t i = 0; i < call.arguments.size(); i++) {
+                if (i > 0) text(", ");
+                this->expr(call.arguments[i]);
             }
-            str += ")";
+            text(")");
         } break;
         case NodeType::TYPE_INIT: {
             auto& typeInit = static_cast<const ASTTypeInit&>(expr);
-            str = print_expr(*typeInit.typeRef) + ".{";
-            for (int i = 0; i < typeInit.assignments.size(); i++) {
-                str += print_expr(*typeInit.assignments[i]->lvalue);
-                str += "=";
-                str += print_expr(*typeInit.assignments[i]->rvalue);
-                if (i + 1 < typeInit.assignments.size()) {
-                    str += ", ";
-                }
-            }
-            str += "}";
-        } break;
-        case NodeType::LIT: {
-            auto& lit = static_cast<const ASTLit&>(expr);
-            switch (lit.value->type) {
-                case TokenType::INT_LITERAL:
-                    return std::to_string(lit.value->longVal);
-                case TokenType::DOUBLE_LITERAL:
-                    return std::to_string(lit.value->doubleVal);
-                case TokenType::STRING_LITERAL:
-                    return lit.value->get_string_val();
-                case TokenType::TRUE:
-                    return "true";
-                case TokenType::FALSE:
-                    return "false";
-                default:
-                    ASSERT(false, "Not a literal: " + token_type_to_str(lit.value->type));
-            }
-        }
+            this->expr(typeInit.typeRef);
+            text(".{");
+            for (size_t i = 0; i < typeInit.assignments.size(); i++) {
+                if (i > 0) text(", ");
+                this->expr(typeInit.assignments[i]->lvalue);
+                text("=");
+                this->expr(typeInit.assignments[i]->rvalue);
+            }
+            text("}");
+        } break;
+        case NodeType::LIT:
+            literal(static_cast<const ASTLit&>(expr).value);
+            break;
         case NodeType::UN_OP: {
             auto& unOp = static_cast<const ASTUnOp&>(expr);
-            return token_type_to_str(unOp.op->type) + "(" + print_expr(*unOp.inner) + ")";
-        }
+            token_type(tokens.type(unOp.op));
+            text("(");
+            this->expr(unOp.inner);
+            text(")");
+        } break;
         case NodeType::DEREF: {
-            auto& deref = static_cast<const ASTDeref&>(expr);
-            return "(" + print_expr(*deref.inner) + ").*";
-        }
+            text("(");
+            this->expr(static_cast<const ASTDeref&>(expr).inner);
+            text(").*");
+        } break;
         case NodeType::BIN_OP: {
             auto& binOp = static_cast<const ASTBinOp&>(expr);
-            return "(" + print_expr(*binOp.left) + " " + token_type_to_str(binOp.op->type) + " " +
-                   print_expr(*binOp.right) + ")";
-        }
+            text("(");
+            this->expr(binOp.left);
+            text(" ");
+            token_type(tokens.type(binOp.op));
+            text(" ");
+            this->expr(binOp.right);
+            text(")");
+        } break;
         case NodeType::UNKNOWN:
-            return "Unknown";
+            text("Unknown");
+            break;
         default:
             ASSERT(false, "Node is not an expression");
     }
-    return str;
+}
+
+std::string print_literal(TokenID value, const TokenList& tokens) {
+    switch (tokens.type(value)) {
+        case TokenType::INT_LITERAL:
+            return std::to_string(tokens.long_val(value)) + (tokens.suffix(value) ? "l" : "");
+        case TokenType::DOUBLE_LITERAL:
+            return std::to_string(tokens.double_val(value)) + (tokens.suffix(value) ? "f" : "");
+        case TokenType::STRING_LITERAL:
+            return std::string(tokens.str(value));
+        case TokenType::TRUE:
+            return "true";
+        case TokenType::FALSE:
+            return "false";
+        default:
+            ASSERT(false, "Not a literal: " + token_type_to_str(tokens.type(value)));
+    }
+    return "";
 }
 
 /* TODO possible formatting of dump print 2/8/21
@@ -0,0 +1,67 @@
+#include "atom_table.hpp"
+
+#include <cstring>
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 256;
+constexpr size_t PREFIX_LEN = sizeof(uint64_t);
+
+inline uint64_t load_prefix(std::string_view str) {
+    uint64_t prefix = 0;
+    memcpy(&prefix, str.data(), str.size() < PREFIX_LEN ? str.size() : PREFIX_LEN);
+    return prefix;
+}
+
+}  // namespace
+
+uint32_t AtomTable::hash_str(std::string_view str) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (char ch : str) {
+        hash = (hash ^ static_cast<unsigned char>(ch)) * 16777619u;
+    }
+    return hash;
+}
+
+void AtomTable::clear() {
+    slots.clear();
+    spellings.clear();
+    hashes.clear();
+}
+
+void AtomTable::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.empty() ? INITIAL_SLOTS : old.size() * 2, {0, 0, 0, NULL_ATOM});
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.atom == NULL_ATOM) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].atom != NULL_ATOM) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+AtomID AtomTable::intern(std::string_view str, uint32_t hash) {
+    // Keep the load factor under 1/2 so that probe sequences stay short
+    if ((spellings.size() + 1) * 2 > slots.size()) grow();
+
+    uint64_t prefix = load_prefix(str);
+    uint32_t length = static_cast<uint32_t>(str.size());
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].atom != NULL_ATOM) {
+        const Slot& slot = slots[i];
+        if (slot.hash == hash && slot.length == length && slot.prefix == prefix &&
+            (length <= PREFIX_LEN || spellings[slot.atom].substr(PREFIX_LEN) == str.substr(PREFIX_LEN))) {
+            return slot.atom;
+        }
+        i = (i + 1) & mask;
+    }
+
+    AtomID atom = static_cast<AtomID>(spellings.size());
+    slots[i] = {prefix, hash, length, atom};
+    spellings.push_back(str);
+    hashes.push_back(hash);
+    return atom;
+}
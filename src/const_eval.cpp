@@ -0,0 +1,362 @@
+#include "const_eval.hpp"
+
+#include <cstring>
+#include <string>
+
+#include "const_fold.hpp"
+#include "flags.hpp"
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 64;
+// Each nested call takes a few frames of the C++ stack to run, which this keeps well under a megabyte
+constexpr uint32_t MAX_DEPTH = 512;
+
+inline uint32_t hash_combine(uint32_t hash, uint32_t value) {
+    // FNV-1a over whole words instead of bytes
+    return (hash ^ value) * 16777619u;
+}
+
+inline uint32_t hash_value(uint32_t hash, const ConstValue& value) {
+    uint64_t bits;
+    if (value.type == TokenType::DOUBLE_LITERAL) {
+        memcpy(&bits, &value.doubleVal, sizeof(bits));
+    } else {
+        bits = static_cast<uint64_t>(value.intVal);
+    }
+    hash = hash_combine(hash, static_cast<uint32_t>(value.type) << 8 | static_cast<unsigned char>(value.suffix));
+    hash = hash_combine(hash, static_cast<uint32_t>(bits));
+    return hash_combine(hash, static_cast<uint32_t>(bits >> 32));
+}
+
+inline uint32_t hash_call(const ASTFunc& func, const ConstValue* args, size_t numArgs) {
+    auto address = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(&func));
+    uint32_t hash = hash_combine(hash_combine(2166136261u, static_cast<uint32_t>(address)),
+                                 static_cast<uint32_t>(address >> 32));
+    for (size_t i = 0; i < numArgs; i++) hash = hash_value(hash, args[i]);
+    return hash;
+}
+
+// Values are the same if they would be written the same, so 0.0 and -0.0 are different arguments
+inline bool same_value(const ConstValue& a, const ConstValue& b) {
+    return a.type == b.type && a.suffix == b.suffix && a.intVal == b.intVal &&
+           memcmp(&a.doubleVal, &b.doubleVal, sizeof(double)) == 0;
+}
+
+inline bool same_type(const ConstValue& a, const ConstValue& b) {
+    auto kind = [](TokenType type) { return type == TokenType::FALSE ? TokenType::TRUE : type; };
+    return kind(a.type) == kind(b.type);
+}
+
+// Whether a value can be stored in a variable with the type annotation. A variable without one takes any value
+bool fits(const ASTExpression* annotation, const ConstValue& value) {
+    if (!annotation) return true;
+    if (annotation->nodeType != NodeType::TYPE_LIT) return false;
+    switch (static_cast<const ASTTypeLit&>(*annotation).type) {
+        case TokenType::INT_TYPE:
+            return value.type == TokenType::INT_LITERAL;
+        case TokenType::DOUBLE_TYPE:
+            return value.type == TokenType::DOUBLE_LITERAL;
+        case TokenType::BOOL_TYPE:
+            return value.type == TokenType::TRUE || value.type == TokenType::FALSE;
+        default:
+            return false;
+    }
+}
+
+// Value of a variable which is declared without being assigned
+ConstValue zero_value(const ASTExpression* annotation) {
+    if (!annotation || annotation->nodeType != NodeType::TYPE_LIT) return {};
+    switch (static_cast<const ASTTypeLit&>(*annotation).type) {
+        case TokenType::INT_TYPE:
+            return {TokenType::INT_LITERAL};
+        case TokenType::DOUBLE_TYPE:
+            return {TokenType::DOUBLE_LITERAL};
+        case TokenType::BOOL_TYPE:
+            return {TokenType::FALSE};
+        default:
+            return {};
+    }
+}
+
+}  // namespace
+
+void ConstEvaluator::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.empty() ? INITIAL_SLOTS : old.size() * 2, {0, NO_CALL});
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.call == NO_CALL) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].call != NO_CALL) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+uint32_t ConstEvaluator::find(uint32_t hash, const ASTFunc& func, size_t firstArg, uint32_t numArgs) const {
+    if (slots.empty()) return NO_CALL;
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask; slots[i].call != NO_CALL; i = (i + 1) & mask) {
+        if (slots[i].hash != hash) continue;
+        const Call& call = calls[slots[i].call];
+        if (call.func != &func || call.numArgs != numArgs) continue;
+        uint32_t same = 0;
+        while (same < numArgs && same_value(callArgs[call.firstArg + same], args[firstArg + same])) same++;
+        if (same == numArgs) return slots[i].call;
+    }
+    return NO_CALL;
+}
+
+void ConstEvaluator::remember(uint32_t hash, const ASTFunc& func, size_t firstArg, uint32_t numArgs,
+                              const ConstValue& result) {
+    // Keep the load factor under 1/2 so that probe sequences stay short
+    if ((calls.size() + 1) * 2 > slots.size()) grow();
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].call != NO_CALL) i = (i + 1) & mask;
+
+    slots[i] = {hash, static_cast<uint32_t>(calls.size())};
+    calls.push_back({&func, static_cast<uint32_t>(callArgs.size()), numArgs, result});
+    callArgs.insert(callArgs.end(), args.begin() + firstArg, args.begin() + firstArg + numArgs);
+}
+
+const ASTFunc* ConstEvaluator::function_of(const ASTExpression& callRef) const {
+    // Only a => declaration is sure to still hold the same function when the call runs
+    if (callRef.nodeType != NodeType::NAME) return nullptr;
+    const ASTDecl* decl = static_cast<const ASTName&>(callRef).decl;
+    if (!decl || !decl->rvalue || decl->rvalue->nodeType != NodeType::FUNC || decl->assignType == NULL_TOKEN ||
+        tokens.type(decl->assignType) != TokenType::CONST_ASSIGNMENT) {
+        return nullptr;
+    }
+    return static_cast<const ASTFunc*>(decl->rvalue);
+}
+
+ConstValue ConstEvaluator::call(const ASTCall& call, const ASTFunc& func, const ConstValue* argValues) {
+    size_t firstArg = args.size();
+    args.insert(args.end(), argValues, argValues + call.arguments.size());
+    // A constant needed by a running call can call functions of its own, which share the steps of the outer call
+    if (running) {
+        ConstValue result = run(func, firstArg);
+        args.resize(firstArg);
+        return result;
+    }
+
+    running = true;
+    fuel = Flags::evalFuel;
+    abort = Abort::NONE;
+    ConstValue result = run(func, firstArg);
+    running = false;
+
+    if (abort != Abort::NONE) {
+        // The call itself is remembered so that it is only given up on once
+        auto numArgs = static_cast<uint32_t>(call.arguments.size());
+        remember(hash_call(func, &args[firstArg], numArgs), func, firstArg, numArgs, ConstValue());
+
+        std::string name = print_expr(*call.callRef, tokens);
+        if (abort == Abort::OUT_OF_FUEL) {
+            dx.err_node("Gave up running " + name + " while compiling after " + std::to_string(Flags::evalFuel) +
+                            " steps",
+                        call)
+                ->tag(ErrorMsg::WARNING)
+                ->note("Use -fuel [steps] to allow more steps if the call does finish");
+        } else {
+            dx.err_node("Gave up running " + name + " while compiling after nesting " + std::to_string(MAX_DEPTH) +
+                            " calls",
+                        call)
+                ->tag(ErrorMsg::WARNING)
+                ->note("A function which calls itself has to reach a case which doesn't");
+        }
+    }
+    args.resize(firstArg);
+    return result;
+}
+
+ConstValue ConstEvaluator::run(const ASTFunc& func, size_t firstArg) {
+    auto numArgs = static_cast<uint32_t>(args.size() - firstArg);
+    uint32_t hash = hash_call(func, args.data() + firstArg, numArgs);
+    uint32_t memo = find(hash, func, firstArg, numArgs);
+    if (memo != NO_CALL) {
+        numHits++;
+        return calls[memo].result;
+    }
+    if (!use_fuel()) return {};
+    if (depth == MAX_DEPTH) {
+        abort = Abort::TOO_DEEP;
+        return {};
+    }
+
+    ConstValue result;
+    bool bound = numArgs == func.parameters.size() && func.blockOrExpr;
+    for (uint32_t i = 0; bound && i < numArgs; i++) bound = fits(func.parameters[i]->type, args[firstArg + i]);
+    if (bound) {
+        size_t outerBase = frameBase;
+        frameBase = locals.size();
+        for (uint32_t i = 0; i < numArgs; i++) locals.push_back({func.parameters[i], args[firstArg + i]});
+        depth++;
+
+        if (func.blockOrExpr->nodeType == NodeType::BLOCK) {
+            // A function without a return type returns nothing, which is never constant
+            if (exec(*func.blockOrExpr) == Flow::RETURN && func.returnType) result = returned;
+        } else {
+            result = eval(static_cast<const ASTExpression&>(*func.blockOrExpr));
+        }
+        if (func.returnType && !fits(func.returnType, result)) result = {};
+
+        depth--;
+        locals.resize(frameBase);
+        frameBase = outerBase;
+    }
+
+    // A call which was given up on may well be constant, it just didn't get to finish
+    if (abort == Abort::NONE) remember(hash, func, firstArg, numArgs, result);
+    return result;
+}
+
+ConstEvaluator::Flow ConstEvaluator::exec(const ASTNode& stmt) {
+    if (!use_fuel()) return Flow::FAIL;
+    switch (stmt.nodeType) {
+        case NodeType::BLOCK: {
+            // Variables declared in the block are gone once it ends
+            size_t numLocals = locals.size();
+            Flow flow = Flow::NEXT;
+            for (const ASTNode* inner : static_cast<const ASTBlock&>(stmt).statements) {
+                flow = exec(*inner);
+                if (flow != Flow::NEXT) break;
+            }
+            locals.resize(numLocals);
+            return flow;
+        }
+        case NodeType::IF: {
+            auto& ifStmt = static_cast<const ASTIf&>(stmt);
+            ConstValue condition = eval(*ifStmt.condition);
+            if (condition.type == TokenType::TRUE) return exec(*ifStmt.conseq);
+            if (condition.type != TokenType::FALSE) return Flow::FAIL;
+            return ifStmt.alt ? exec(*ifStmt.alt) : Flow::NEXT;
+        }
+        case NodeType::FOR: {
+            auto& forLoop = static_cast<const ASTFor&>(stmt);
+            size_t numLocals = locals.size();
+            Flow flow = forLoop.initial ? exec(*forLoop.initial) : Flow::NEXT;
+            while (flow == Flow::NEXT && use_fuel()) {
+                if (forLoop.condition) {
+                    ConstValue condition = eval(*forLoop.condition);
+                    if (condition.type == TokenType::FALSE) break;
+                    if (condition.type != TokenType::TRUE) flow = Flow::FAIL;
+                }
+                if (flow == Flow::NEXT && forLoop.blockStmt) flow = exec(*forLoop.blockStmt);
+                if (flow == Flow::BREAK) {
+                    flow = Flow::NEXT;
+                    break;
+                }
+                if (flow == Flow::CONTINUE) flow = Flow::NEXT;
+                if (flow == Flow::NEXT && forLoop.post) flow = exec(*forLoop.post);
+            }
+            if (abort != Abort::NONE) flow = Flow::FAIL;
+            locals.resize(numLocals);
+            return flow;
+        }
+        case NodeType::BREAK:
+            return Flow::BREAK;
+        case NodeType::CONT:
+            return Flow::CONTINUE;
+        case NodeType::RET: {
+            auto& ret = static_cast<const ASTRet&>(stmt);
+            returned = ret.retValue ? eval(*ret.retValue) : ConstValue();
+            return ret.retValue && !returned.is_constant() ? Flow::FAIL : Flow::RETURN;
+        }
+        case NodeType::DECL:
+            return exec_decl(static_cast<const ASTDecl&>(stmt));
+        default:
+            // Whatever an expression statement does is only of use if it does something other than return a value
+            if (!is_expression_type(stmt.nodeType)) return Flow::FAIL;
+            return eval(static_cast<const ASTExpression&>(stmt)).is_constant() ? Flow::NEXT : Flow::FAIL;
+    }
+}
+
+ConstEvaluator::Flow ConstEvaluator::exec_decl(const ASTDecl& decl) {
+    // Constants are folded when they are read
+    if (decl.assignType != NULL_TOKEN && tokens.type(decl.assignType) == TokenType::CONST_ASSIGNMENT) return Flow::NEXT;
+    if (decl.lvalue->nodeType != NodeType::NAME) return Flow::FAIL;
+    const ASTDecl* target = static_cast<const ASTName&>(*decl.lvalue).decl;
+    if (!target) return Flow::FAIL;
+
+    ConstValue value = decl.rvalue ? eval(*decl.rvalue) : zero_value(decl.type);
+    if (!value.is_constant() || !fits(decl.type, value)) return Flow::FAIL;
+    ConstValue* variable = local(*target);
+    if (target == &decl && !variable) {
+        locals.push_back({&decl, value});
+        return Flow::NEXT;
+    }
+    // Assigning anything but a variable of the call, or changing what type it holds, isn't something to run here
+    if (!variable || !same_type(*variable, value)) return Flow::FAIL;
+    *variable = value;
+    return Flow::NEXT;
+}
+
+ConstValue ConstEvaluator::eval(const ASTExpression& expr) {
+    if (!use_fuel()) return {};
+    switch (expr.nodeType) {
+        case NodeType::LIT:
+            return folder.literal_value(static_cast<const ASTLit&>(expr));
+        case NodeType::NAME: {
+            ASTDecl* decl = static_cast<const ASTName&>(expr).decl;
+            if (!decl) return {};
+            ConstValue* variable = local(*decl);
+            return variable ? *variable : folder.constant(*decl);
+        }
+        case NodeType::UN_OP: {
+            auto& unOp = static_cast<const ASTUnOp&>(expr);
+            ConstValue inner = eval(*unOp.inner);
+            if (!inner.is_constant()) return {};
+            // Overflow and the like only mean that the call isn't constant
+            bool wasQuiet = folder.set_quiet(true);
+            ConstValue value = folder.fold_un_op(unOp, inner);
+            folder.set_quiet(wasQuiet);
+            return value;
+        }
+        case NodeType::BIN_OP: {
+            auto& binOp = static_cast<const ASTBinOp&>(expr);
+            ConstValue left = eval(*binOp.left);
+            if (!left.is_constant()) return {};
+            // The right of && and || only runs when it is needed, which is what lets a call stop recursing
+            TokenType op = tokens.type(binOp.op);
+            if ((op == TokenType::COND_AND && left.type == TokenType::FALSE) ||
+                (op == TokenType::COND_OR && left.type == TokenType::TRUE)) {
+                return left;
+            }
+            ConstValue right = eval(*binOp.right);
+            if (!right.is_constant()) return {};
+            bool wasQuiet = folder.set_quiet(true);
+            ConstValue value = folder.fold_bin_op(binOp, left, right);
+            folder.set_quiet(wasQuiet);
+            return value;
+        }
+        case NodeType::CALL:
+            return eval_call(static_cast<const ASTCall&>(expr));
+        default:
+            return {};
+    }
+}
+
+ConstValue ConstEvaluator::eval_call(const ASTCall& call) {
+    const ASTFunc* func = function_of(*call.callRef);
+    if (!func) return {};
+    size_t firstArg = args.size();
+    ConstValue result;
+    for (const ASTExpression* arg : call.arguments) {
+        ConstValue value = eval(*arg);
+        if (!value.is_constant()) break;
+        args.push_back(value);
+    }
+    if (args.size() - firstArg == call.arguments.size()) result = run(*func, firstArg);
+    args.resize(firstArg);
+    return result;
+}
+
+ConstValue* ConstEvaluator::local(const ASTDecl& decl) {
+    // Functions have few variables, and the ones used most are usually the latest
+    for (size_t i = locals.size(); i-- > frameBase;) {
+        if (locals[i].decl == &decl) return &locals[i].value;
+    }
+    return nullptr;
+}
@@ -0,0 +1,512 @@
+#include "const_fold.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <new>
+
+#include "ast_visitor.hpp"
+
+namespace {
+
+// a + b, a - b and a * b. Return false instead if the result doesn't fit in a long long
+inline bool checked_add(long long a, long long b, long long& result) {
+#ifdef __GNUC__
+    return !__builtin_add_overflow(a, b, &result);
+#else
+    if ((b > 0 && a > LLONG_MAX - b) || (b < 0 && a < LLONG_MIN - b)) return false;
+    result = a + b;
+    return true;
+#endif
+}
+inline bool checked_sub(long long a, long long b, long long& result) {
+#ifdef __GNUC__
+    return !__builtin_sub_overflow(a, b, &result);
+#else
+    if ((b < 0 && a > LLONG_MAX + b) || (b > 0 && a < LLONG_MIN + b)) return false;
+    result = a - b;
+    return true;
+#endif
+}
+inline bool checked_mul(long long a, long long b, long long& result) {
+#ifdef __GNUC__
+    return !__builtin_mul_overflow(a, b, &result);
+#else
+    if (a != 0 && b != 0) {
+        if ((a == -1 && b == LLONG_MIN) || (b == -1 && a == LLONG_MIN)) return false;
+        if (a != -1 && b != -1 && (a * b) / b != a) return false;
+    }
+    result = a * b;
+    return true;
+#endif
+}
+
+inline ConstValue bool_value(bool value) { return {value ? TokenType::TRUE : TokenType::FALSE}; }
+inline bool is_bool(const ConstValue& value) { return value.type == TokenType::TRUE || value.type == TokenType::FALSE; }
+
+}  // namespace
+
+void ConstFolder::fold(ASTProgram& program) {
+    size_t firstError = dx.error_count();
+    push(&program, false);
+    while (!frames.empty()) step();
+    // Constants which are used before they appear are folded out of order
+    dx.sort_errors(firstError);
+}
+
+void ConstFolder::push_children(ASTNode& node) {
+    size_t first = frames.size();
+    for_each_child(node, [&](const ASTNode* child) { push(const_cast<ASTNode*>(child), false); });
+    std::reverse(frames.begin() + first, frames.end());
+}
+
+bool ConstFolder::push_operand(ASTExpression* expr) {
+    // Literals and constants which are already folded are by far the most common operands so they skip the frame
+    if (expr->nodeType == NodeType::LIT) {
+        values.push_back(literal_value(static_cast<const ASTLit&>(*expr)));
+        return false;
+    }
+    if (expr->nodeType == NodeType::NAME) {
+        const ASTDecl* decl = static_cast<const ASTName&>(*expr).decl;
+        if (decl && decl->foldState != FoldState::UNFOLDED) {
+            values.push_back(constant_value(*decl));
+            return false;
+        }
+    }
+    push(expr, true);
+    return true;
+}
+
+void ConstFolder::finish(const ConstValue& value) {
+    Frame frame = frames.back();
+    frames.pop_back();
+    if (frame.operand) {
+        values.push_back(value);
+    } else if (value.is_constant()) {
+        fold_in_place(static_cast<ASTExpression&>(*frame.node), value);
+    }
+}
+
+void ConstFolder::fold_in_place(ASTExpression& expr, const ConstValue& value) {
+    if (value.is_constant() &&
+        (expr.nodeType == NodeType::BIN_OP || expr.nodeType == NodeType::UN_OP || expr.nodeType == NodeType::CALL)) {
+        replace_with_literal(expr, value);
+    }
+}
+
+void ConstFolder::step() {
+    // Pushing a frame can move the frame, so each step sets up the frame before pushing anything
+    Frame& frame = frames.back();
+    switch (frame.node->nodeType) {
+        case NodeType::LIT:
+            finish(literal_value(static_cast<const ASTLit&>(*frame.node)));
+            return;
+        case NodeType::NAME:
+            step_name(static_cast<const ASTName&>(*frame.node));
+            return;
+        case NodeType::DECL:
+            step_decl(static_cast<ASTDecl&>(*frame.node));
+            return;
+        case NodeType::CALL:
+            step_call(static_cast<ASTCall&>(*frame.node));
+            return;
+        case NodeType::UN_OP: {
+            auto& unOp = static_cast<const ASTUnOp&>(*frame.node);
+            if (frame.step == 0) {
+                frame.step = 1;
+                if (push_operand(unOp.inner)) return;
+            }
+            ConstValue inner = values.back();
+            values.pop_back();
+            ConstValue value = fold_un_op(unOp, inner);
+            // Operands which are constant on their own are still folded when the operator isn't
+            if (!value.is_constant()) fold_in_place(*unOp.inner, inner);
+            finish(value);
+            return;
+        }
+        case NodeType::BIN_OP: {
+            auto& binOp = static_cast<const ASTBinOp&>(*frame.node);
+            if (frame.step == 0) {
+                frame.step = 1;
+                if (push_operand(binOp.left)) return;
+            }
+            if (frame.step == 1) {
+                frame.step = 2;
+                if (push_operand(binOp.right)) return;
+            }
+            ConstValue right = values.back();
+            values.pop_back();
+            ConstValue left = values.back();
+            values.pop_back();
+            ConstValue value = fold_bin_op(binOp, left, right);
+            if (!value.is_constant()) {
+                fold_in_place(*binOp.left, left);
+                fold_in_place(*binOp.right, right);
+            }
+            finish(value);
+            return;
+        }
+        default:
+            if (frame.step == 0) {
+                frame.step = 1;
+                push_children(*frame.node);
+                return;
+            }
+            finish(ConstValue());
+            return;
+    }
+}
+
+void ConstFolder::step_decl(ASTDecl& decl) {
+    Frame& frame = frames.back();
+    bool constant = decl.assignType != NULL_TOKEN && tokens.type(decl.assignType) == TokenType::CONST_ASSIGNMENT;
+    if (!constant || !decl.rvalue) {
+        if (frame.step == 0) {
+            frame.step = 1;
+            push_children(decl);
+        } else {
+            frames.pop_back();
+        }
+        return;
+    }
+
+    if (frame.step == 0) {
+        // Already folded because something used it before it appeared
+        if (decl.foldState != FoldState::UNFOLDED) {
+            frames.pop_back();
+            return;
+        }
+        decl.foldState = FoldState::FOLDING;
+        frame.step = 1;
+        push(decl.rvalue, true);
+        return;
+    }
+
+    ConstValue value = values.back();
+    values.pop_back();
+    frames.pop_back();
+
+    // An annotation which doesn't match the value is an error for the type checker to report
+    TokenType annotation = TokenType::UNKNOWN;
+    if (decl.type && decl.type->nodeType == NodeType::TYPE_LIT) {
+        annotation = static_cast<const ASTTypeLit&>(*decl.type).type;
+    }
+    TokenType valueType = value.type == TokenType::INT_LITERAL      ? TokenType::INT_TYPE
+                          : value.type == TokenType::DOUBLE_LITERAL ? TokenType::DOUBLE_TYPE
+                                                                    : TokenType::BOOL_TYPE;
+    if (!value.is_constant() || (decl.type && annotation != valueType)) {
+        fold_in_place(*decl.rvalue, value);
+        decl.foldState = FoldState::NOT_CONSTANT;
+        return;
+    }
+    if (decl.rvalue->nodeType != NodeType::LIT) replace_with_literal(*decl.rvalue, value);
+    decl.foldState = FoldState::CONSTANT;
+    numConstants++;
+}
+
+void ConstFolder::step_name(const ASTName& name) {
+    ASTDecl* decl = name.decl;
+    if (!frames.back().operand || !decl) {
+        finish(ConstValue());
+        return;
+    }
+    // Only => declarations ever leave UNFOLDED
+    if (decl->foldState == FoldState::UNFOLDED && decl->rvalue && decl->assignType != NULL_TOKEN &&
+        tokens.type(decl->assignType) == TokenType::CONST_ASSIGNMENT) {
+        // Come back to the name once the constant is folded
+        push(decl, false);
+        return;
+    }
+    finish(constant_value(*decl));
+}
+
+void ConstFolder::step_call(ASTCall& call) {
+    Frame& frame = frames.back();
+    const ASTFunc* func = evaluator.function_of(*call.callRef);
+    if (!func) {
+        if (frame.step == 0) {
+            frame.step = 1;
+            push_children(call);
+            return;
+        }
+        finish(ConstValue());
+        return;
+    }
+
+    size_t numArgs = call.arguments.size();
+    while (frame.step < numArgs) {
+        if (push_operand(call.arguments[frame.step++])) return;
+    }
+    size_t firstArg = values.size() - numArgs;
+    bool constant = std::all_of(values.begin() + firstArg, values.end(),
+                                [](const ConstValue& value) { return value.is_constant(); });
+    ConstValue value = constant ? evaluator.call(call, *func, values.data() + firstArg) : ConstValue();
+    if (!value.is_constant()) {
+        for (size_t i = 0; i < numArgs; i++) fold_in_place(*call.arguments[i], values[firstArg + i]);
+    }
+    values.resize(firstArg);
+    finish(value);
+}
+
+ConstValue ConstFolder::constant(ASTDecl& decl) {
+    // Only values are folded on demand. Folding a function or module would rewrite code which may be running
+    bool constant = decl.assignType != NULL_TOKEN && tokens.type(decl.assignType) == TokenType::CONST_ASSIGNMENT;
+    if (decl.foldState == FoldState::UNFOLDED && constant && decl.rvalue && decl.rvalue->nodeType != NodeType::FUNC &&
+        decl.rvalue->nodeType != NodeType::MOD && decl.rvalue->nodeType != NodeType::TYPE_DEF) {
+        size_t depth = frames.size();
+        push(&decl, false);
+        while (frames.size() > depth) step();
+    }
+    return constant_value(decl);
+}
+
+ConstValue ConstFolder::constant_value(const ASTDecl& decl) const {
+    // Otherwise not a constant, not constant after all or depends on itself
+    if (decl.foldState != FoldState::CONSTANT) return {};
+    return literal_value(static_cast<const ASTLit&>(*decl.rvalue));
+}
+
+ConstValue ConstFolder::fold_un_op(const ASTUnOp& unOp, const ConstValue& inner) {
+    switch (tokens.type(unOp.op)) {
+        case TokenType::OP_SUBTR:
+            if (inner.type == TokenType::INT_LITERAL) {
+                bool overflowed = inner.intVal == LLONG_MIN;
+                return check_int(unOp, overflowed ? 0 : -inner.intVal, overflowed, inner.suffix);
+            }
+            if (inner.type == TokenType::DOUBLE_LITERAL) {
+                return {TokenType::DOUBLE_LITERAL, inner.suffix, 0, -inner.doubleVal};
+            }
+            break;
+        case TokenType::BIT_NOT:
+            if (inner.type == TokenType::INT_LITERAL) return {TokenType::INT_LITERAL, inner.suffix, ~inner.intVal};
+            break;
+        case TokenType::COND_NOT:
+            if (is_bool(inner)) return bool_value(inner.type == TokenType::FALSE);
+            break;
+        default:
+            break;
+    }
+    return {};
+}
+
+ConstValue ConstFolder::fold_bin_op(const ASTBinOp& binOp, const ConstValue& left, const ConstValue& right) {
+    TokenType op = tokens.type(binOp.op);
+    if (left.type == TokenType::INT_LITERAL && right.type == TokenType::INT_LITERAL) {
+        char suffix = left.suffix == 'l' || right.suffix == 'l' ? 'l' : 0;
+        return fold_int(binOp, op, left.intVal, right.intVal, suffix);
+    }
+    if (left.type == TokenType::DOUBLE_LITERAL && right.type == TokenType::DOUBLE_LITERAL) {
+        char suffix = left.suffix == 'f' && right.suffix == 'f' ? 'f' : 0;
+        return fold_double(binOp, op, left.doubleVal, right.doubleVal, suffix);
+    }
+    if (is_bool(left) && is_bool(right)) {
+        bool a = left.type == TokenType::TRUE;
+        bool b = right.type == TokenType::TRUE;
+        switch (op) {
+            case TokenType::COND_AND:
+                return bool_value(a && b);
+            case TokenType::COND_OR:
+                return bool_value(a || b);
+            case TokenType::COND_XOR:
+            case TokenType::COND_NOT_EQUALS:
+                return bool_value(a != b);
+            case TokenType::COND_EQUALS:
+                return bool_value(a == b);
+            default:
+                break;
+        }
+    }
+    return {};
+}
+
+ConstValue ConstFolder::fold_int(const ASTBinOp& binOp, TokenType op, long long left, long long right, char suffix) {
+    long long result = 0;
+    bool overflowed = false;
+    switch (op) {
+        case TokenType::OP_ADD:
+            overflowed = !checked_add(left, right, result);
+            break;
+        case TokenType::OP_SUBTR:
+            overflowed = !checked_sub(left, right, result);
+            break;
+        case TokenType::OP_MULT:
+            overflowed = !checked_mul(left, right, result);
+            break;
+        case TokenType::OP_DIV:
+        case TokenType::OP_MOD:
+            if (right == 0) {
+                if (!quiet) {
+                    dx.err_node("Division by zero in a constant expression", *binOp.right)->tag(ErrorMsg::WARNING);
+                }
+                return {};
+            }
+            overflowed = left == LLONG_MIN && right == -1;
+            if (!overflowed) result = op == TokenType::OP_DIV ? left / right : left % right;
+            break;
+        case TokenType::OP_CARROT: {
+            if (right < 0) return {};  // Not an int
+            long long base = left;
+            result = 1;
+            for (long long exponent = right; exponent > 0; exponent >>= 1) {
+                if (exponent & 1) overflowed |= !checked_mul(result, base, result);
+                if (exponent > 1) overflowed |= !checked_mul(base, base, base);
+                if (overflowed) break;
+            }
+            break;
+        }
+        case TokenType::BIT_AND:
+            result = left & right;
+            break;
+        case TokenType::BIT_OR:
+            result = left | right;
+            break;
+        case TokenType::BIT_XOR:
+            result = left ^ right;
+            break;
+        case TokenType::BIT_SHIFT_LEFT:
+        case TokenType::BIT_SHIFT_RIGHT: {
+            int bits = suffix == 'l' ? 64 : 32;
+            if (right < 0 || right >= bits) {
+                if (quiet) return {};
+                dx.err_node("Shift by " + std::to_string(right) + " is out of range for " +
+                                (suffix == 'l' ? "a long" : "an int"),
+                            *binOp.right)
+                    ->tag(ErrorMsg::WARNING)
+                    ->note("Shifts must be by 0 to " + std::to_string(bits - 1));
+                return {};
+            }
+            if (op == TokenType::BIT_SHIFT_RIGHT) {
+                result = left >> right;
+            } else if (right == 63) {
+                overflowed = left != 0;
+            } else {
+                overflowed = !checked_mul(left, 1LL << right, result);
+            }
+            break;
+        }
+        case TokenType::COND_EQUALS:
+            return bool_value(left == right);
+        case TokenType::COND_NOT_EQUALS:
+            return bool_value(left != right);
+        case TokenType::COND_LESS:
+            return bool_value(left < right);
+        case TokenType::COND_LESS_EQUAL:
+            return bool_value(left <= right);
+        case TokenType::COND_GREATER:
+            return bool_value(left > right);
+        case TokenType::COND_GREATER_EQUAL:
+            return bool_value(left >= right);
+        default:
+            return {};
+    }
+    return check_int(binOp, result, overflowed, suffix);
+}
+
+ConstValue ConstFolder::fold_double(const ASTBinOp& binOp, TokenType op, double left, double right, char suffix) {
+    // Literals which were already too large to fit were reported by the lexer
+    if (!std::isfinite(left) || !std::isfinite(right)) return {};
+    double result;
+    switch (op) {
+        case TokenType::OP_ADD:
+            result = left + right;
+            break;
+        case TokenType::OP_SUBTR:
+            result = left - right;
+            break;
+        case TokenType::OP_MULT:
+            result = left * right;
+            break;
+        case TokenType::OP_DIV:
+        case TokenType::OP_MOD:
+            if (right == 0) {
+                if (!quiet) {
+                    dx.err_node("Division by zero in a constant expression", *binOp.right)->tag(ErrorMsg::WARNING);
+                }
+                return {};
+            }
+            result = op == TokenType::OP_DIV ? left / right : std::fmod(left, right);
+            break;
+        case TokenType::OP_CARROT:
+            result = std::pow(left, right);
+            break;
+        case TokenType::COND_EQUALS:
+            return bool_value(left == right);
+        case TokenType::COND_NOT_EQUALS:
+            return bool_value(left != right);
+        case TokenType::COND_LESS:
+            return bool_value(left < right);
+        case TokenType::COND_LESS_EQUAL:
+            return bool_value(left <= right);
+        case TokenType::COND_GREATER:
+            return bool_value(left > right);
+        case TokenType::COND_GREATER_EQUAL:
+            return bool_value(left >= right);
+        default:
+            return {};
+    }
+    return check_double(binOp, result, suffix);
+}
+
+ConstValue ConstFolder::check_int(const ASTExpression& expr, long long value, bool overflowed, char suffix) {
+    bool fits = !overflowed && (suffix == 'l' || (value >= INT_MIN && value <= INT_MAX));
+    if (fits) return {TokenType::INT_LITERAL, suffix, value};
+    if (quiet) return {};
+    if (suffix == 'l') {
+        dx.err_node("Constant expression overflows a long", expr)
+            ->tag(ErrorMsg::WARNING)
+            ->note("A long holds values from -2^63 to 2^63-1 = 9_223_372_036_854_775_807");
+    } else {
+        dx.err_node("Constant expression overflows an int", expr)
+            ->tag(ErrorMsg::WARNING)
+            ->note("An int holds values from -2^31 to 2^31-1 = 2_147_483_647. Use the l suffix to make a long");
+    }
+    return {};
+}
+
+ConstValue ConstFolder::check_double(const ASTExpression& expr, double value, char suffix) {
+    if (suffix == 'f') value = static_cast<float>(value);
+    if (std::isinf(value)) {
+        if (quiet) return {};
+        dx.err_node(std::string("Constant expression overflows a ") + (suffix == 'f' ? "float" : "double"), expr)
+            ->tag(ErrorMsg::WARNING)
+            ->note(suffix == 'f' ? "The max value for a float is about 3.4e38"
+                                 : "The max value for a double is about 1.8e308");
+        return {};
+    }
+    // Not a number, which is only known once the program runs
+    if (std::isnan(value)) return {};
+    return {TokenType::DOUBLE_LITERAL, suffix, 0, value};
+}
+
+ConstValue ConstFolder::literal_value(const ASTLit& lit) const {
+    TokenType type = tokens.type(lit.value);
+    switch (type) {
+        case TokenType::INT_LITERAL:
+            return {type, tokens.suffix(lit.value), tokens.long_val(lit.value)};
+        case TokenType::DOUBLE_LITERAL:
+            return {type, tokens.suffix(lit.value), 0, tokens.double_val(lit.value)};
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+            return {type};
+        default:
+            return {};
+    }
+}
+
+void ConstFolder::replace_with_literal(ASTExpression& expr, const ConstValue& value) {
+    static_assert(sizeof(ASTLit) <= sizeof(ASTName) && sizeof(ASTLit) <= sizeof(ASTUnOp) &&
+                      sizeof(ASTLit) <= sizeof(ASTBinOp) && sizeof(ASTLit) <= sizeof(ASTCall),
+                  "A literal has to fit in the place of any expression which is folded");
+    int beginI = expr.beginI;
+    int endI = expr.endI();
+    TokenID token = tokens.push_loc(value.type, beginI, endI);
+    if (value.type == TokenType::INT_LITERAL) tokens.set_long(token, value.intVal, value.suffix);
+    if (value.type == TokenType::DOUBLE_LITERAL) tokens.set_double(token, value.doubleVal, value.suffix);
+
+    // Nodes are never destroyed and the arena owns their memory, so the literal simply takes over the expression's
+    auto* lit = new (&expr) ASTLit();
+    lit->beginI = beginI;
+    lit->set_end(endI);
+    lit->value = token;
+    numFolded++;
+}
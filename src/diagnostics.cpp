@@ -1,5 +1,6 @@
 #include "diagnostics.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <stdexcept>
 
@@ -14,11 +15,12 @@ ErrorMsg* Diagnostics::last_err() {
 ErrorMsg* Diagnostics::err_loc(std::string&& msg, int beginI, int endI) {
     ASSERT(endI > beginI, "Invalid error location(beginI = " + std::to_string(beginI) +
                               ", endI = " + std::to_string(endI) + " ). End index must be greater than begin index");
-    if (endI > maxIndex) maxIndex = endI;
 
     // Ignore duplicate errors at the same place
-    auto errorMsg = std::make_unique<ErrorMsg>(std::move(msg), beginI, endI);
+    return add_err(std::make_unique<ErrorMsg>(std::move(msg), beginI, endI));
+}
 
+ErrorMsg* Diagnostics::add_err(std::unique_ptr<ErrorMsg> errorMsg) {
     if (isRecovering) {
         discardErrors.push_back(std::move(errorMsg));
         return discardErrors.back().get();
@@ -28,6 +30,27 @@ ErrorMsg* Diagnostics::err_loc(std::string&& msg, int beginI, int endI) {
     }
 }
 
+void Diagnostics::sort_errors(size_t first) {
+    struct Group {
+        int beginI;
+        size_t first;
+        size_t end;
+    };
+    std::vector<Group> groups;
+    for (size_t i = first; i < errors.size(); i++) {
+        if (groups.empty() || errors[i]->infoTag != ErrorMsg::EMPTY) groups.push_back({errors[i]->beginI, i, i});
+        groups.back().end = i + 1;
+    }
+    std::stable_sort(groups.begin(), groups.end(), [](const Group& a, const Group& b) { return a.beginI < b.beginI; });
+
+    std::vector<std::unique_ptr<ErrorMsg>> sorted;
+    sorted.reserve(errors.size() - first);
+    for (const Group& group : groups) {
+        for (size_t i = group.first; i < group.end; i++) sorted.push_back(std::move(errors[i]));
+    }
+    std::move(sorted.begin(), sorted.end(), errors.begin() + first);
+}
+
 ErrorMsg* Diagnostics::err_loc(std::string&& msg, int beginI) { return err_loc(std::move(msg), beginI, beginI + 1); }
 
 ErrorMsg* Diagnostics::err_token(std::string&& msg, const Token& token) {
@@ -35,14 +58,13 @@ ErrorMsg* Diagnostics::err_token(std::string&& msg, const Token& token) {
 }
 
 ErrorMsg* Diagnostics::err_after_token(std::string&& msg, const Token& token) {
-    if (token.endI > maxIndex) maxIndex = token.endI;
     auto errMsg = err_loc(std::move(msg), token.endI - 1, token.endI);
     errMsg->offset = 1;
     return errMsg;
 }
 
 ErrorMsg* Diagnostics::err_node(std::string&& msg, const ASTNode& node) {
-    return err_loc(std::move(msg), node.beginI, node.endI);
+    return err_loc(std::move(msg), node.beginI, node.endI());
 }
 
 namespace {
@@ -56,83 +78,72 @@ inline int strlen_num(int num) { return static_cast<int>(floor(log10(num)) + 1);
 }  // namespace
 
 std::string Diagnostics::emit() {
-    auto end = std::chrono::steady_clock::now();
+    auto end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double, std::milli> diff = end - start;
     std::string finishTime = "\n-- Finished in " + std::to_string(diff.count()) + "ms";
 
-    int line = 1;
-    Line* lastLine = nullptr;
-    for (int c = 0; c <= maxIndex; c++) {
-        Line* l = new Line;
-        l->line = line++;
-        l->beginI = c;
-        l->leading = 0;
-        bool isLeading = true;
-        for (; c < src.length() && src[c] != '\n'; c++) {
-            if (isLeading && !Lexer::is_whitespace(src[c])) {
-                l->leading = c - l->beginI;
-                isLeading = false;
-            }
-        }
-        l->endI = c;
-        l->next = lastLine;
-        lastLine = l;
-    }
-
     size_t size = 0;
-    ErrorMsg* lastErr = nullptr;
     for (const auto& e : errors) {
         size += e->msg.size() + 1;  // Add new line char
-        for (Line* l = lastLine; l != nullptr; l = l->next) {
-            if (e->beginI >= l->beginI) {
-                int ch = 0;
-                for (int i = l->beginI; i < e->beginI; i++) {
-                    ch += src[i] == '\t' ? Lexer::TAB_WIDTH : 1;
-                }
-                size += TAG_LEN;
-                size += 3;  // (l:
-                e->line = l->line;
-                size += strlen_num(e->line);
-                size += 4;  // , c:
-                e->ch = ch;
-                size += strlen_num(e->ch + 1 + e->offset);
-                size += 2;  // )
-
-                // Get minimum leading space
-                Line* b = l;
-                e->leading = l->leading;
-                for (int i = 0; i < TOTAL_DISPLAY_LINES && l != nullptr; i++) {
-                    if (l->leading < e->leading) e->leading = l->leading;
-                    l = l->next;
-                }
 
-                // Calculated new begin index after leading space adjustments
-                l = b;
-                e->maxNumLen = std::max(ELLIPSES_LEN, strlen_num(e->line));
-                for (int i = 0; i < TOTAL_DISPLAY_LINES && l != nullptr; i++) {
-                    size += TAG_LEN + e->maxNumLen + LINE_NUM_TRAILING_WHITESPACE;
-                    e->lines[i] = l;
-                    size += l->endI - l->beginI - e->leading;
-                    size += 1;  // Add new line char
-                    l = l->next;
-                }
-                size += TAG_LEN + e->maxNumLen;
-                size += LINE_NUM_TRAILING_WHITESPACE + e->ch - e->leading + e->offset;
-                size += std::min(e->lines[0]->endI, e->endI) - e->beginI;
+        e->file = sources.file_of(e->beginI);
+        ASSERT(e->file != NULL_FILE, "Error location is before the first file");
+        int base = static_cast<int>(sources.base(e->file));
+        const char* src = sources.buffer(e->file).data();
+        uint32_t lineI = sources.line_of(e->file, e->beginI - base);
 
-                if (!e->fixMsg.empty()) {
-                    size += FIX_LEN;
-                    size += e->fixMsg.size();
-                }
-                size += 1;  // Add new line char
-                if (!e->noteMsg.empty()) {
-                    size += TAG_LEN + e->maxNumLen;
-                    size += NOTE_LEN;
-                    size += e->noteMsg.size();
-                    size += 1;  // Add new line char
+        int ch = 0;
+        int lineBeginI = base + static_cast<int>(sources.line_begin(e->file, lineI));
+        for (int i = lineBeginI; i < e->beginI; i++) {
+            ch += src[i - base] == '\t' ? Lexer::TAB_WIDTH : 1;
+        }
+        size += TAG_LEN;
+        size += 3;  // (l:
+        e->line = static_cast<int>(lineI) + 1;
+        size += strlen_num(e->line);
+        size += 4;  // , c:
+        e->ch = ch;
+        size += strlen_num(e->ch + 1 + e->offset);
+        size += 2;  // )
+
+        // Find the lines to display along with the minimum leading space of all of them
+        int numLines = std::min<int>(TOTAL_DISPLAY_LINES, e->line);
+        for (int i = 0; i < numLines; i++) {
+            Line& l = e->lines[i];
+            l.line = e->line - i;
+            l.beginI = base + static_cast<int>(sources.line_begin(e->file, lineI - i));
+            l.endI = base + static_cast<int>(sources.line_end(e->file, lineI - i));
+            l.leading = 0;
+            for (int c = l.beginI; c < l.endI; c++) {
+                if (!Lexer::is_whitespace(src[c - base])) {
+                    l.leading = c - l.beginI;
+                    break;
                 }
-                break;
             }
+            if (i == 0 || l.leading < e->leading) e->leading = l.leading;
+        }
+
+        // Calculated new begin index after leading space adjustments
+        e->maxNumLen = std::max(ELLIPSES_LEN, strlen_num(e->line));
+        for (int i = 0; i < numLines; i++) {
+            size += TAG_LEN + e->maxNumLen + LINE_NUM_TRAILING_WHITESPACE;
+            size += e->lines[i].endI - e->lines[i].beginI - e->leading;
+            size += 1;  // Add new line char
+        }
+        size += TAG_LEN + e->maxNumLen;
+        size += LINE_NUM_TRAILING_WHITESPACE + e->ch - e->leading + e->offset;
+        size += std::min(e->lines[0].endI, e->endI) - e->beginI;
+
+        if (!e->fixMsg.empty()) {
+            size += FIX_LEN;
+            size += e->fixMsg.size();
+        }
+        size += 1;  // Add new line char
+        if (!e->noteMsg.empty()) {
+            size += TAG_LEN + e->maxNumLen;
+            size += NOTE_LEN;
+            size += e->noteMsg.size();
+            size += 1;  // Add new line char
         }
     }
     size += finishTime.size();
@@ -167,7 +178,9 @@ std::string Diagnostics::emit() {
             res += std::string(e->maxNumLen - strlen_num(lineNum), ' ');
             res += std::to_string(lineNum);
             res += std::string(LINE_NUM_TRAILING_WHITESPACE, ' ');
-            res += src.substr(e->lines[i]->beginI + e->leading, e->lines[i]->endI - e->lines[i]->beginI - e->leading);
+            const Line& l = e->lines[i];
+            int lineOffset = l.beginI - static_cast<int>(sources.base(e->file));
+            res.append(sources.buffer(e->file).data() + lineOffset + e->leading, l.endI - l.beginI - e->leading);
             res += "\n";
         }
         res += std::string(TAG_LEN, ' ');
@@ -175,10 +188,10 @@ std::string Diagnostics::emit() {
         res += "...";
         res += std::string(LINE_NUM_TRAILING_WHITESPACE + e->ch - e->leading + e->offset, ' ');
         res += "^";
-        Line* errLine = e->lines[0];
+        const Line& errLine = e->lines[0];
         if (e->endI > e->beginI + 1) {
-            if (e->endI > errLine->endI) {
-                res += std::string(errLine->endI - e->beginI - 1, '-');
+            if (e->endI > errLine.endI) {
+                res += std::string(errLine.endI - e->beginI - 1, '-');
             } else {
                 res += std::string(e->endI - e->beginI - 2, '-');
                 res += "^";
@@ -198,12 +211,5 @@ std::string Diagnostics::emit() {
     }
     res += finishTime;
     ASSERT(res.size() == size, "Bad string size allocation");
-
-    Line* cur = lastLine;
-    while (cur != nullptr) {
-        Line* next = cur->next;
-        delete cur;
-        cur = next;
-    }
     return res;
 }
\ No newline at end of file
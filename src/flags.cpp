@@ -1,5 +1,7 @@
 #include "flags.hpp"
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <string>
 
@@ -8,9 +10,16 @@ namespace Flags {
 const char* filePath;
 
 bool sourceFmt = false;
+bool dumpFlat = false;  //-dump-flat
+bool typeCheck = false;  //-check
+bool constFold = false;  //-fold
+long long evalFuel = 1000000;  //-fuel [steps], steps a call may take while compiling
 
 DumpInfo dumpInfo;
 bool dwSemiColons = false;  //-dw-semi-colons
+bool streamTokens = false;  //-stream
+bool printStats = false;    //-stats
+int numThreads = 0;         //-j [count]
 
 bool parse_flags(int argc, char** argv) {
     filePath = argv[1];
@@ -22,10 +31,32 @@ bool parse_flags(int argc, char** argv) {
                 dumpInfo.verbose = true;
                 i++;
             }
+        } else if (strcmp(argv[i], "-dump-flat") == 0) {
+            dumpFlat = true;
+        } else if (strcmp(argv[i], "-check") == 0) {
+            typeCheck = true;
+        } else if (strcmp(argv[i], "-fold") == 0) {
+            constFold = true;
+        } else if (strcmp(argv[i], "-fuel") == 0) {
+            if (i + 1 >= argc || atoll(argv[i + 1]) <= 0) {
+                std::cerr << "Expected a step count greater than 0 after -fuel" << std::endl;
+                return false;
+            }
+            evalFuel = atoll(argv[++i]);
         } else if (strcmp(argv[i], "-src") == 0) {
             sourceFmt = true;
         } else if (strcmp(argv[i], "-dw-semi-colons") == 0) {
             dwSemiColons = true;
+        } else if (strcmp(argv[i], "-stream") == 0) {
+            streamTokens = true;
+        } else if (strcmp(argv[i], "-stats") == 0) {
+            printStats = true;
+        } else if (strcmp(argv[i], "-j") == 0) {
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+                std::cerr << "Expected a thread count greater than 0 after -j" << std::endl;
+                return false;
+            }
+            numThreads = atoi(argv[++i]);
         } else {
             std::cerr << "Unknown command line argument: " << argv[i] << std::endl;
             return false;
@@ -0,0 +1,165 @@
+#include "flat_ast.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "ast_visitor.hpp"
+#include "lexer.hpp"
+
+namespace {
+
+constexpr uint32_t NO_SLOT = UINT32_MAX;
+
+inline FlatNode make_flat_node(NodeType nodeType, int beginI, int endI) {
+    FlatNode node;
+    node.nodeType = nodeType;
+    node.op = TokenType::END;
+    node.numChildren = 0;
+    node.firstChild = 0;
+    node.subtreeEnd = NULL_NODE;
+    node.beginI = beginI;
+    node.endI = endI;
+    return node;
+}
+
+}  // namespace
+
+uint32_t FlatAST::fixed_children(NodeType nodeType) {
+    switch (nodeType) {
+        case NodeType::FOR:
+            return 4;
+        case NodeType::IF:
+        case NodeType::DECL:
+            return 3;
+        case NodeType::FUNC:
+        case NodeType::DOT_OP:
+        case NodeType::BIN_OP:
+            return 2;
+        case NodeType::RET:
+        case NodeType::FUNC_TYPE:
+        case NodeType::CALL:
+        case NodeType::TYPE_INIT:
+        case NodeType::UN_OP:
+        case NodeType::DEREF:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+NodeID FlatAST::add_node(const ASTNode& node, const TokenList& tokens) {
+    NodeID id = static_cast<NodeID>(nodes.size());
+    nodes.push_back(make_flat_node(node.nodeType, node.beginI, node.endI()));
+
+    // Children are pushed in source order and then reversed so that they come off the stack in source order
+    size_t firstPending = pending.size();
+    uint32_t firstChild = static_cast<uint32_t>(children.size());
+    for_each_child(node, [&](const ASTNode* child) {
+        uint32_t slot = static_cast<uint32_t>(children.size());
+        children.push_back(NULL_NODE);
+        if (child != nullptr) pending.push_back({child, slot});
+    });
+
+    switch (node.nodeType) {
+        case NodeType::DECL: {
+            TokenID assignType = static_cast<const ASTDecl&>(node).assignType;
+            if (assignType != NULL_TOKEN) nodes[id].op = tokens.type(assignType);
+        } break;
+        case NodeType::TYPE_LIT:
+            nodes[id].op = static_cast<const ASTTypeLit&>(node).type;
+            break;
+        case NodeType::NAME:
+            nodes[id].token = static_cast<const ASTName&>(node).ref;
+            break;
+        case NodeType::LIT:
+            nodes[id].token = static_cast<const ASTLit&>(node).value;
+            break;
+        case NodeType::UN_OP:
+            nodes[id].op = tokens.type(static_cast<const ASTUnOp&>(node).op);
+            break;
+        case NodeType::BIN_OP:
+            nodes[id].op = tokens.type(static_cast<const ASTBinOp&>(node).op);
+            break;
+        default:
+            break;
+    }
+    nodes[id].numChildren = static_cast<uint32_t>(children.size()) - firstChild;
+    if (nodes[id].numChildren > 0) nodes[id].firstChild = firstChild;
+    std::reverse(pending.begin() + firstPending, pending.end());
+    return id;
+}
+
+NodeID FlatAST::add_tree(const ASTNode& root, const TokenList& tokens) {
+    NodeID rootID = static_cast<NodeID>(nodes.size());
+    pending.push_back({&root, NO_SLOT});
+    while (!pending.empty()) {
+        Pending next = pending.back();
+        pending.pop_back();
+        NodeID id = add_node(*next.node, tokens);
+        if (next.slot != NO_SLOT) children[next.slot] = id;
+    }
+
+    // Going backwards, the last child of every node already knows where its own subtree ends
+    for (NodeID id = static_cast<NodeID>(nodes.size()); id-- > rootID;) {
+        FlatNode& node = nodes[id];
+        node.subtreeEnd = id + 1;
+        for (uint32_t c = node.numChildren; c-- > 0;) {
+            NodeID child = children[node.firstChild + c];
+            if (child != NULL_NODE) {
+                node.subtreeEnd = nodes[child].subtreeEnd;
+                break;
+            }
+        }
+    }
+    return rootID;
+}
+
+NodeID FlatAST::begin_list_node(NodeType nodeType, int beginI) {
+    NodeID id = static_cast<NodeID>(nodes.size());
+    nodes.push_back(make_flat_node(nodeType, beginI, beginI));
+    return id;
+}
+
+void FlatAST::end_list_node(NodeID id, const std::vector<NodeID>& list, int endI) {
+    FlatNode& node = nodes[id];
+    node.firstChild = static_cast<uint32_t>(children.size());
+    node.numChildren = static_cast<uint32_t>(list.size());
+    node.subtreeEnd = static_cast<NodeID>(nodes.size());
+    node.endI = endI;
+    children.insert(children.end(), list.begin(), list.end());
+}
+
+void dump_flat_ast(const FlatAST& ast, const TokenList& tokens) {
+    std::string dump;
+    std::vector<NodeID> ancestorEnds;  // Subtree end of every ancestor of the current node
+    for (NodeID id = 0; id < ast.size(); id++) {
+        const FlatNode& node = ast[id];
+        while (!ancestorEnds.empty() && ancestorEnds.back() <= id) ancestorEnds.pop_back();
+
+        for (size_t i = 0; i < ancestorEnds.size(); i++) dump += "| ";
+        dump += node_type_to_str(node.nodeType);
+        switch (node.nodeType) {
+            case NodeType::NAME:
+                dump += " ";
+                dump += tokens.str(node.token);
+                break;
+            case NodeType::LIT:
+                dump += " " + print_literal(node.token, tokens);
+                break;
+            case NodeType::DECL:
+                if (node.op != TokenType::END) dump += " " + token_type_to_str(node.op);
+                break;
+            case NodeType::TYPE_LIT:
+            case NodeType::UN_OP:
+            case NodeType::BIN_OP:
+                dump += " " + token_type_to_str(node.op);
+                break;
+            default:
+                break;
+        }
+        dump += "\n";
+        ancestorEnds.push_back(node.subtreeEnd);
+    }
+    std::cout << dump;
+}
@@ -0,0 +1,99 @@
+#include "layout_table.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "ast.hpp"
+#include "lexer.hpp"
+#include "sym_tab.hpp"
+#include "type_checker.hpp"
+
+namespace {
+
+constexpr uint32_t POINTER_SIZE = 8;
+constexpr Layout NO_LAYOUT = {UNSIZED, 1, 0, 0};
+
+inline uint32_t align_to(uint32_t offset, uint32_t align) { return (offset + align - 1) & ~(align - 1); }
+
+Layout primitive_layout(TokenType type) {
+    switch (type) {
+        case TokenType::INT_TYPE:
+        case TokenType::DOUBLE_TYPE:
+            return {8, 8, 0, 0};
+        case TokenType::BOOL_TYPE:
+            return {1, 1, 0, 0};
+        case TokenType::STRING_TYPE:
+            return {2 * POINTER_SIZE, POINTER_SIZE, 0, 0};  // Pointer to the characters and their length
+        default:  // Void, Type and Module
+            return {0, 1, 0, 0};
+    }
+}
+
+}  // namespace
+
+const Layout& LayoutTable::layout_of(TypeID type) {
+    if (type == NULL_TYPE) return NO_LAYOUT;
+    if (type >= layouts.size()) layouts.resize(types.size(), {UNKNOWN, 1, 0, 0});
+    if (layouts[type].size != UNKNOWN) return layouts[type];
+
+    switch (types[type].kind) {
+        case TypeKind::PRIMITIVE:
+            layouts[type] = primitive_layout(types[type].primitive);
+            break;
+        case TypeKind::POINTER:
+        case TypeKind::FUNCTION:
+            layouts[type] = {POINTER_SIZE, POINTER_SIZE, 0, 0};
+            break;
+        case TypeKind::DEFINED:
+            return layout_defined(type);
+        default:  // Names which were never resolved
+            layouts[type] = NO_LAYOUT;
+            break;
+    }
+    return layouts[type];
+}
+
+const Layout& LayoutTable::layout_defined(TypeID type) {
+    SymTable& symbols = *checker.definition_of(type)->symbolTable;
+    uint32_t first = static_cast<uint32_t>(members.size());
+    uint32_t numMembers = static_cast<uint32_t>(symbols.size());
+    members.resize(first + numMembers);
+    layouts[type] = {IN_PROGRESS, 1, first, numMembers};
+
+    // Fields can lay out other types, which moves both layouts and members, so nothing is held across the loop
+    uint32_t size = 0;
+    uint32_t align = 1;
+    for (uint32_t i = 0; i < numMembers; i++) {
+        const ASTDecl& decl = *symbols.begin()[i].decl;
+        TypeID memberType = checker.type_of(decl);
+        uint32_t offset = NOT_STORED;
+        bool field = decl.assignType == NULL_TOKEN || tokens.type(decl.assignType) != TokenType::CONST_ASSIGNMENT;
+        // The remaining fields are still laid out after one without a size, so that every loop is found
+        if (field && memberType < layouts.size() && layouts[memberType].size == IN_PROGRESS) {
+            cycles.push_back({memberType, &decl});
+            size = UNSIZED;
+        } else if (field) {
+            Layout fieldLayout = layout_of(memberType);
+            if (fieldLayout.size == UNSIZED || size == UNSIZED) {
+                size = UNSIZED;
+            } else {
+                offset = align_to(size, fieldLayout.align);
+                size = offset + fieldLayout.size;
+                align = std::max(align, fieldLayout.align);
+            }
+        }
+        members[first + i] = {&decl, memberType, offset};
+    }
+    layouts[type] = {size == UNSIZED ? UNSIZED : align_to(size, align), align, first, numMembers};
+    return layouts[type];
+}
+
+const MemberLayout* LayoutTable::member(TypeID type, AtomID name) {
+    const ASTTy* ty = checker.definition_of(type);
+    if (!ty) return nullptr;
+    uint32_t first = layout_of(type).firstMember;
+    TableEntry* entry = ty->symbolTable->find(name);
+    return entry ? &members[first + static_cast<uint32_t>(entry - ty->symbolTable->begin())] : nullptr;
+}
+
+std::vector<LayoutCycle> LayoutTable::take_cycles() { return std::move(cycles); }
@@ -1,10 +1,136 @@
 #include "lexer.hpp"
 
-#include <fstream>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <thread>
 
 #include "flags.hpp"
+#include "literal.hpp"
+#include "scan.hpp"
+
+namespace {
+
+struct Keyword {
+    std::string_view str;
+    TokenType type;
+};
+
+// Every reserved word in the language. Words mapped to UNKNOWN are reserved but rejected with an error
+constexpr Keyword KEYWORDS[] = {
+    {"mod", TokenType::MOD},
+    {"ty", TokenType::TY},
+    {"if", TokenType::IF},
+    {"else", TokenType::ELSE},
+    {"for", TokenType::FOR},
+    {"while", TokenType::UNKNOWN},
+    {"break", TokenType::BREAK},
+    {"continue", TokenType::CONTINUE},
+    {"true", TokenType::TRUE},
+    {"false", TokenType::FALSE},
+    {"Void", TokenType::VOID_TYPE},
+    {"Module", TokenType::MOD_TYPE},
+    {"Type", TokenType::TY_TYPE},
+    {"Int", TokenType::INT_TYPE},
+    {"Double", TokenType::DOUBLE_TYPE},
+    {"String", TokenType::STRING_TYPE},
+    {"Bool", TokenType::BOOL_TYPE},
+    {"return", TokenType::RETURN},
+};
+constexpr int NUM_KEYWORDS = sizeof(KEYWORDS) / sizeof(Keyword);
+constexpr int NUM_TOKEN_TYPES = static_cast<int>(TokenType::END) + 1;
+
+// Perfect hash of the keywords using only the length, first and last characters of a word
+constexpr int KEYWORD_SLOTS = 64;
+constexpr unsigned keyword_hash(const char* str, size_t len, unsigned seed) {
+    return ((static_cast<unsigned char>(str[0]) + static_cast<unsigned char>(str[len - 1]) * seed) ^ len) &
+           (KEYWORD_SLOTS - 1);
+}
+
+// Keywords are at most 8 characters long so each one is compared as a single little endian 64-bit word
+constexpr size_t MAX_KEYWORD_LEN = 8;
+constexpr uint64_t keyword_word(std::string_view str) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < str.size(); i++) {
+        word |= static_cast<uint64_t>(static_cast<unsigned char>(str[i])) << (i * 8);
+    }
+    return word;
+}
+
+inline uint64_t load_word(const char* str) {
+    uint64_t word;
+    memcpy(&word, str, sizeof(word));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+
+struct KeywordSlot {
+    uint64_t word = 0;
+    unsigned char len = 0;  // 0 if the slot is empty since identifiers are never empty
+    TokenType type = TokenType::IDENTIFIER;
+};
+
+struct KeywordTable {
+    unsigned seed = 0;
+    KeywordSlot slots[KEYWORD_SLOTS] = {};
+    std::string_view spellings[NUM_TOKEN_TYPES] = {};  // Keyword string of each keyword token type
+};
+
+// Search for the smallest seed for which no two keywords share a slot
+constexpr KeywordTable make_keyword_table() {
+    KeywordTable table;
+    for (unsigned seed = 1; seed < 1024; seed++) {
+        bool collision = false;
+        for (int i = 0; i < KEYWORD_SLOTS; i++) table.slots[i] = KeywordSlot();
+        for (int k = 0; k < NUM_KEYWORDS && !collision; k++) {
+            const std::string_view& str = KEYWORDS[k].str;
+            KeywordSlot& slot = table.slots[keyword_hash(str.data(), str.size(), seed)];
+            if (slot.len != 0) collision = true;
+            slot.word = keyword_word(str);
+            slot.len = static_cast<unsigned char>(str.size());
+            slot.type = KEYWORDS[k].type;
+        }
+        if (!collision) {
+            table.seed = seed;
+            for (int k = 0; k < NUM_KEYWORDS; k++) {
+                if (KEYWORDS[k].type != TokenType::UNKNOWN) {
+                    table.spellings[static_cast<int>(KEYWORDS[k].type)] = KEYWORDS[k].str;
+                }
+            }
+            return table;
+        }
+    }
+    return table;
+}
+
+constexpr bool keywords_fit_in_word() {
+    for (int k = 0; k < NUM_KEYWORDS; k++) {
+        if (KEYWORDS[k].str.size() > MAX_KEYWORD_LEN) return false;
+    }
+    return true;
+}
+
+constexpr KeywordTable KEYWORD_TABLE = make_keyword_table();
+static_assert(KEYWORD_TABLE.seed != 0, "No perfect hash seed exists for the keyword list. Increase KEYWORD_SLOTS");
+static_assert(keywords_fit_in_word(), "Keywords longer than MAX_KEYWORD_LEN can't be compared as a single word");
+
+}  // namespace
+
+TokenType keyword_type(const char* str, size_t len) {
+    const KeywordSlot& slot = KEYWORD_TABLE.slots[keyword_hash(str, len, KEYWORD_TABLE.seed)];
+    // Neither the length nor whether the word matches is predictable, so both are checked without branching on them
+    uint64_t mask = ~uint64_t{0} >> ((MAX_KEYWORD_LEN - std::min(len, MAX_KEYWORD_LEN)) * 8);
+    bool match = (slot.len == len) & ((load_word(str) & mask) == slot.word);
+    return match ? slot.type : TokenType::IDENTIFIER;
+}
 
 std::string token_type_to_str(TokenType type) {
+    const std::string_view& keyword = KEYWORD_TABLE.spellings[static_cast<int>(type)];
+    if (!keyword.empty()) return std::string(keyword);
+
     switch (type) {
         case TokenType::UNKNOWN:
             return "'unknown token'";
@@ -16,38 +142,10 @@ std::string token_type_to_str(TokenType type) {
             return "(";
         case TokenType::RIGHT_PARENS:
             return ")";
-        case TokenType::MOD:
-            return "mod";
-        case TokenType::TY:
-            return "ty";
-        case TokenType::IF:
-            return "if";
-        case TokenType::ELSE:
-            return "else";
-        case TokenType::FOR:
-            return "for";
-        case TokenType::BREAK:
-            return "break";
-        case TokenType::CONTINUE:
-            return "continue";
         case TokenType::IDENTIFIER:
             return "'identifier'";
         case TokenType::COLON:
             return ":";
-        case TokenType::VOID_TYPE:
-            return "Void";
-        case TokenType::MOD_TYPE:
-            return "Module";
-        case TokenType::TY_TYPE:
-            return "Type";
-        case TokenType::INT_TYPE:
-            return "Int";
-        case TokenType::DOUBLE_TYPE:
-            return "Double";
-        case TokenType::STRING_TYPE:
-            return "String";
-        case TokenType::BOOL_TYPE:
-            return "Bool";
         case TokenType::ASSIGNMENT:
             return "=";
         case TokenType::CONST_ASSIGNMENT:
@@ -58,10 +156,6 @@ std::string token_type_to_str(TokenType type) {
             return "'double literal'";
         case TokenType::STRING_LITERAL:
             return "'string literal'";
-        case TokenType::TRUE:
-            return "true";
-        case TokenType::FALSE:
-            return "false";
         case TokenType::COND_NOT:
             return "!";
         case TokenType::COND_OR:
@@ -92,6 +186,8 @@ std::string token_type_to_str(TokenType type) {
             return "$";
         case TokenType::BIT_SHIFT_LEFT:
             return "<<";
+        case TokenType::BIT_SHIFT_RIGHT:
+            return ">>";
         case TokenType::DOT:
             return ".";
         case TokenType::OP_ADD:
@@ -124,8 +220,6 @@ std::string token_type_to_str(TokenType type) {
             return "->";
         case TokenType::SINGLE_RETURN:
             return "::";
-        case TokenType::RETURN:
-            return "return";
         case TokenType::COMMA:
             return ",";
         case TokenType::DEREF:
@@ -137,54 +231,207 @@ std::string token_type_to_str(TokenType type) {
     }
 }
 
+void TokenList::reset(std::string_view src, int base, size_t expectedTokens) {
+    firstID = 0;
+    this->base = base;
+    types.clear();
+    begins.clear();
+    lengths.clear();
+    payloads.clear();
+    literals.clear();
+    sourceStr = src;
+
+    types.reserve(expectedTokens);
+    begins.reserve(expectedTokens);
+    lengths.reserve(expectedTokens);
+    payloads.reserve(expectedTokens);
+}
+
+TokenID TokenList::append(const TokenList& other, TokenID id) {
+    size_t i = id - other.firstID;
+    TokenID newID = push(other.types[i], other.begins[i], other.begins[i] + other.lengths[i]);
+    if (other.is_pooled(i)) {
+        pool_literal(types.size() - 1, other.payloads[i] & ~VALUE_MASK, other.literals[other.payloads[i] & VALUE_MASK]);
+    } else {
+        payloads.back() = other.payloads[i];
+    }
+    return newID;
+}
+
+void TokenList::discard_before(TokenID id) {
+    size_t count = id - firstID;
+    types.erase(types.begin(), types.begin() + count);
+    begins.erase(begins.begin(), begins.begin() + count);
+    lengths.erase(lengths.begin(), lengths.begin() + count);
+    payloads.erase(payloads.begin(), payloads.begin() + count);
+    firstID = id;
+
+    // Compact the pooled literals of the remaining tokens to the front of the pool
+    size_t pooled = 0;
+    for (size_t i = 0; i < types.size(); i++) {
+        if (is_pooled(i)) {
+            uint32_t flags = payloads[i] & ~VALUE_MASK;
+            literals[pooled] = literals[payloads[i] & VALUE_MASK];
+            payloads[i] = flags | static_cast<uint32_t>(pooled++);
+        }
+    }
+    literals.resize(pooled);
+}
+
+void TokenList::resize(size_t numTokens, size_t numLiterals) {
+    types.resize(numTokens);
+    begins.resize(numTokens);
+    lengths.resize(numTokens);
+    payloads.resize(numTokens);
+    literals.resize(numLiterals);
+}
+
+void TokenList::copy_chunk(const TokenList& chunk, size_t first, TokenID firstID, size_t firstLiteral,
+                           const std::vector<AtomID>& atomMap) {
+    size_t dest = firstID - this->firstID;
+    std::copy(chunk.types.begin() + first, chunk.types.end(), types.begin() + dest);
+    std::copy(chunk.begins.begin() + first, chunk.begins.end(), begins.begin() + dest);
+    std::copy(chunk.lengths.begin() + first, chunk.lengths.end(), lengths.begin() + dest);
+    std::copy(chunk.payloads.begin() + first, chunk.payloads.end(), payloads.begin() + dest);
+    std::copy(chunk.literals.begin(), chunk.literals.end(), literals.begin() + firstLiteral);
+    for (size_t i = first; i < chunk.types.size(); i++) {
+        if (chunk.types[i] == TokenType::IDENTIFIER || chunk.types[i] == TokenType::STRING_LITERAL) {
+            payloads[dest + i - first] = atomMap[chunk.payloads[i]];
+        } else if (chunk.is_pooled(i)) {
+            payloads[dest + i - first] += static_cast<uint32_t>(firstLiteral);
+        }
+    }
+}
+
+size_t TokenList::memory_usage() const {
+    return types.size() * (sizeof(TokenType) + sizeof(uint32_t) * 3) + literals.size() * sizeof(LiteralVal);
+}
+
 bool Lexer::from_file_path(const char* filePath) {
-    std::ifstream file(filePath);
-    if (file.is_open()) {
-        file.seekg(0, std::ios::end);
-        size_t size = file.tellg();
-        this->sourceStr = std::string(size, ' ');
-        file.seekg(0);
-        file.read(&this->sourceStr[0], size);
+    FileID opened = sources.open(filePath);
+    if (opened != NULL_FILE) {
+        file = opened;
+        fileBase = static_cast<int>(sources.base(file));
+        source.share(sources.buffer(file));
+        this->sourceStr = source.view();
+
+        streaming = Flags::streamTokens;
+        lexedAhead = false;
+        peakScratchMemory = 0;
+        deferredErrors.clear();
+        nextDeferred = 0;
+        deferredTokenID = NULL_TOKEN;
 
         curIndex = 0;
         curCLen = 1;
+        cacheIndex = 0;
+        atoms.clear();
+
+        int numThreads = Flags::numThreads > 0 ? Flags::numThreads : std::thread::hardware_concurrency();
+        if (streaming) {
+            tokens.reset(sourceStr, fileBase, 0);
+            window.reset(sourceStr, fileBase, STREAM_WINDOW);
+        } else if (numThreads > 1 && sourceStr.length() >= PARALLEL_MIN_SIZE) {
+            tokens.reset(sourceStr, fileBase, 0);
+            lex_parallel(numThreads);
+            lexedAhead = true;
+        } else {
+            // Real code averages well over 4 characters per token so this is rarely exceeded. Pages reserved past the
+            // last token are never touched and so don't take up physical memory
+            tokens.reset(sourceStr, fileBase, sourceStr.length() / 4 + 16);
+        }
         return true;
     } else {
         return false;
     }
 }
 
-std::unique_ptr<Token> Lexer::make_token(TokenType type) {
-    auto tkn = std::make_unique<Token>();
-    tkn->type = type;
-    tkn->beginI = curIndex;
-    tkn->endI = curIndex + curCLen;
+Lexer::Lexer(Lexer& ahead, TokenID first) : dx(sources), tokens(ahead.tokens) {
+    ASSERT(ahead.lexedAhead, "Tokens can only be shared once the whole file has been lexed");
+    sourceStr = ahead.sourceStr;
+    file = ahead.file;
+    fileBase = ahead.fileBase;
+    curIndex = static_cast<int>(sourceStr.length());
+    cacheIndex = first;
+    lexedAhead = true;
+}
+
+size_t Lexer::peak_token_memory() const {
+    return tokens.memory_usage() + std::max(peakScratchMemory, window.memory_usage());
+}
+
+TokenID Lexer::make_token(TokenType type) {
+    TokenID id = lexed_tokens().push(type, curIndex, curIndex + curCLen);
 
     curIndex += curCLen;
     curCLen = 1;
-    return tkn;
+    return id;
+}
+
+TokenID Lexer::make_atom_token(TokenType type) {
+    AtomID atom = atoms.intern(sourceStr.substr(curIndex, curCLen));
+    TokenID id = make_token(type);
+    lexed_tokens().set_atom(id, atom);
+    return id;
 }
 
-std::unique_ptr<Token> Lexer::consume_token() {
-    if (curIndex < sourceStr.length() && sourceStr[curIndex] == '\r') {
-        dx.err_loc("\\r is not a supported character in this language", curIndex)->note("Use \\n instead");
-        return make_token(TokenType::UNKNOWN);
+TokenID Lexer::consume_token() {
+    if (streaming && window.size() >= STREAM_WINDOW) {
+        // The parser only ever looks back at the last token so everything before it can be dropped. Every token after
+        // it is still to be lexed, so the window is left with only that one
+        peakScratchMemory = std::max(peakScratchMemory, window.memory_usage());
+        window.discard_before(cacheIndex - 1);
+        ASSERT(window.size() == 1, "Streaming window kept tokens which are still to be read");
     }
 
-    // Skip over whitespace
-    while (curIndex < sourceStr.length() && is_whitespace(sourceStr[curIndex])) curIndex++;
+    // Offsets into the file are ints
+    const int sourceLen = static_cast<int>(sourceStr.length());
 
-    if (curIndex >= sourceStr.length()) return make_token(TokenType::END);
+    // Skip over whitespace, semi-colons and comments until the start of the next token
+    for (;;) {
+        if (curIndex >= chunkEnd) {
+            chunkSynced = curIndex == chunkEnd;
+            return NULL_TOKEN;
+        }
+
+        if (curIndex < sourceLen && source[curIndex] == '\r') {
+            dx.err_loc("\\r is not a supported character in this language", loc(curIndex))->note("Use \\n instead");
+            return make_token(TokenType::UNKNOWN);
+        }
 
-    switch (sourceStr[curIndex]) {
-        case ';':
+        curIndex = Scan::skip_whitespace(source.data(), curIndex, sourceLen);
+        if (curIndex >= chunkEnd && source[curIndex] != '\r') {
+            // A \r is only reported at the start of the loop so the next chunk's lexer would disagree about it
+            chunkSynced = true;
+            return NULL_TOKEN;
+        }
+
+        if (curIndex >= sourceLen) return make_token(TokenType::END);
+
+        if (source[curIndex] == ';') {
             if (!Flags::dwSemiColons) {
-                dx.err_loc("Semi-colons are not required in this language", curIndex)
+                dx.err_loc("Semi-colons are not required in this language", loc(curIndex))
                     ->tag(ErrorMsg::WARNING)
                     ->note("Semi-colons are treated as whitespace. Use -dw-semi-colons to disable warning");
             }
             curIndex++;
-            return consume_token();
+        } else if (source[curIndex] == '/' && is_cursor_char('/')) {
+            curIndex = Scan::find_newline(source.data(), curIndex, sourceLen) + 1;
+        } else if (source[curIndex] == '/' && is_cursor_char('*')) {
+            // Note that the search starts on the opening '*' so "/*/" is a complete block comment
+            size_t endI = Scan::find_block_end(source.data(), curIndex + 1, sourceStr.length());
+            if (endI == sourceStr.length()) {
+                curCLen = endI - curIndex + 1;
+                dx.err_loc("Unterminated block comment", loc(curIndex));
+                return make_token(TokenType::UNKNOWN);
+            }
+            curIndex = endI + 2;
+        } else {
+            break;
+        }
+    }
+
+    switch (source[curIndex]) {
         case '{':
             return make_token(TokenType::LEFT_CURLY);
         case '}':
@@ -294,7 +541,7 @@ std::unique_ptr<Token> Lexer::consume_token() {
                 return make_token(TokenType::OP_MULT_EQUAL);
             } else if (is_cursor_char('/')) {
                 curCLen++;
-                dx.err_loc("Invalid closing of block comment", curIndex);
+                dx.err_loc("Invalid closing of block comment", loc(curIndex));
                 return make_token(TokenType::UNKNOWN);
             } else {
                 return make_token(TokenType::OP_MULT);
@@ -303,26 +550,6 @@ std::unique_ptr<Token> Lexer::consume_token() {
             if (is_cursor_char('=')) {
                 curCLen++;
                 return make_token(TokenType::OP_DIV_EQUAL);
-            } else if (is_cursor_char('/')) {
-                while (curIndex < sourceStr.length() && sourceStr[curIndex] != '\n') {
-                    curIndex++;
-                }
-                curIndex++;
-                curCLen = 1;
-                return consume_token();
-            } else if (is_cursor_char('*')) {
-                while (curIndex + curCLen < sourceStr.length() &&
-                       !(sourceStr[curIndex + curCLen - 1] == '*' && is_cursor_char('/'))) {
-                    curCLen++;
-                }
-                curCLen++;
-                if (curIndex + curCLen > sourceStr.length()) {
-                    dx.err_loc("Unterminated block comment", curIndex);
-                    return make_token(TokenType::UNKNOWN);
-                }
-                curIndex += curCLen;
-                curCLen = 1;
-                return consume_token();
             } else {
                 return make_token(TokenType::OP_DIV);
             }
@@ -338,156 +565,150 @@ std::unique_ptr<Token> Lexer::consume_token() {
         case ',':
             return make_token(TokenType::COMMA);
         case '"': {
-            while (curIndex + curCLen < sourceStr.length() && !is_cursor_char('"')) {
+            while (curIndex + curCLen < sourceLen && !is_cursor_char('"')) {
                 if (is_cursor_char('\\')) curCLen++;
                 curCLen++;
             }
             curCLen++;
-            if (curIndex + curCLen > sourceStr.length()) {
-                dx.err_loc("Unterminated string literal", curIndex);
+            if (curIndex + curCLen > sourceLen) {
+                dx.err_loc("Unterminated string literal", loc(curIndex));
                 return make_token(TokenType::UNKNOWN);
             }
-            auto tkn = make_token(TokenType::STRING_LITERAL);
-            tkn->sourceStr = &sourceStr;
-            return tkn;
+            return make_atom_token(TokenType::STRING_LITERAL);
         }
         default:
-            if (is_letter(sourceStr[curIndex])) {
-                while (is_letter(sourceStr[curIndex + curCLen]) || is_number(sourceStr[curIndex + curCLen])) {
+            if (is_letter(source[curIndex])) {
+                while (is_letter(source[curIndex + curCLen]) || is_number(source[curIndex + curCLen])) {
                     curCLen++;
                 }
-                std::string_view keyword(sourceStr.c_str() + curIndex, curCLen);
-                if (keyword == "mod") {
-                    return make_token(TokenType::MOD);
-                } else if (keyword == "ty") {
-                    return make_token(TokenType::TY);
-                } else if (keyword == "if") {
-                    return make_token(TokenType::IF);
-                } else if (keyword == "else") {
-                    return make_token(TokenType::ELSE);
-                } else if (keyword == "for") {
-                    return make_token(TokenType::FOR);
-                } else if (keyword == "while") {
-                    dx.err_loc("While loops are not allowed in this language", curIndex, curIndex + curCLen)
+                TokenType keyword = keyword_type(source.data() + curIndex, curCLen);
+                if (keyword == TokenType::IDENTIFIER) {
+                    return make_atom_token(TokenType::IDENTIFIER);
+                } else if (keyword == TokenType::UNKNOWN) {
+                    // The only rejected keyword is while
+                    dx.err_loc("While loops are not allowed in this language", loc(curIndex), loc(curIndex + curCLen))
                         ->fix("Use for loop instead in the form: for [condition] {}")
                         ->note("Using 'while' as a variable name can cause confusion with other languages");
-                } else if (keyword == "break") {
-                    return make_token(TokenType::BREAK);
-                } else if (keyword == "continue") {
-                    return make_token(TokenType::CONTINUE);
-                } else if (keyword == "true") {
-                    return make_token(TokenType::TRUE);
-                } else if (keyword == "false") {
-                    return make_token(TokenType::FALSE);
-                } else if (keyword == "Void") {
-                    return make_token(TokenType::VOID_TYPE);
-                } else if (keyword == "Module") {
-                    return make_token(TokenType::MOD_TYPE);
-                } else if (keyword == "Type") {
-                    return make_token(TokenType::TY_TYPE);
-                } else if (keyword == "Int") {
-                    return make_token(TokenType::INT_TYPE);
-                } else if (keyword == "Double") {
-                    return make_token(TokenType::DOUBLE_TYPE);
-                } else if (keyword == "String") {
-                    return make_token(TokenType::STRING_TYPE);
-                } else if (keyword == "Bool") {
-                    return make_token(TokenType::BOOL_TYPE);
-                } else if (keyword == "return") {
-                    return make_token(TokenType::RETURN);
                 } else {
-                    auto tkn = make_token(TokenType::IDENTIFIER);
-                    tkn->sourceStr = &sourceStr;
-                    return tkn;
-                }
-            } else if (is_number(sourceStr[curIndex])) {
-                int base = 10;
-                if (sourceStr[curIndex] == '0') {
-                    if (is_cursor_char('b')) {
-                        base = 2;
-                        curCLen++;
-                    } else if (is_cursor_char('o')) {
-                        base = 8;
-                        curCLen++;
-                    } else if (is_cursor_char('x')) {
-                        base = 16;
-                        curCLen++;
-                    }
-                } else {
-                    curCLen--;
-                }
-                bool overflow = false;
-                long long number = 0;
-                double divisor = 0;
-                char ch = sourceStr[curIndex + curCLen];
-                while ((base == 16 && is_hex(ch)) || is_number(ch) || ch == '.') {
-                    if (ch != '_') {
-                        if (ch == '.') {
-                            if (sourceStr[curIndex + curCLen - 1] == '_') {
-                                dx.err_loc("Underscore is not allowed here", curIndex + curCLen - 1);
-                            }
-                            if (divisor > 0) {
-                                dx.err_loc("Numeric literal has too many decimal points \"" +
-                                               sourceStr.substr(curIndex, curCLen) + ".\"",
-                                           curIndex + curCLen);
-                            } else {
-                                divisor = 1;
-                            }
-                        } else {
-                            // Convert digit into corresponding base: (in hexadecimal) A -> 10
-                            int val;
-                            if (to_num(ch) >= 0 && to_num(ch) < 10) {
-                                val = to_num(ch);
-                            } else if (is_hex(ch)) {
-                                val = ch - 65 + 10;
-                                if (val > 15) {
-                                    val -= (97 - 65);
-                                }
-                            } else {
-                                ASSERT(false, "String is not assignable to a numeric value");
-                            }
-
-                            if (val < base) {
-                                number = base * number + val;
-                                if (divisor > 0) {
-                                    divisor *= base;
-                                } else {
-                                    // Check for overflow
-                                    // Negative number can indicate an overflow
-                                    if ((number > INT_MAX || number < 0) && !overflow) overflow = true;
-                                }
-                            } else {
-                                dx.err_loc(std::to_string(to_num(ch)) + " is an invalid digit value in base " +
-                                               std::to_string(base),
-                                           curIndex + curCLen);
-                            }
-                        }
-                    } else if (divisor == 1) {
-                        dx.err_loc("Underscore is not allowed here", curIndex + curCLen);
-                    }
-                    curCLen++;
-                    ch = sourceStr[curIndex + curCLen];
-                }
-                if (sourceStr[curIndex + curCLen - 1] == '_') {
-                    dx.err_loc("Underscore is not allowed here", curIndex + curCLen - 1);
-                }
-                if (overflow && divisor == 0) {
-                    dx.err_loc("Numeric literal is too large to fit in an int ", curIndex, curIndex + curCLen)
-                        ->tag(ErrorMsg::WARNING)
-                        ->note("The max value for an int literal is 2^31-1 = 2_147_483_647");
+                    return make_token(keyword);
                 }
+            } else if (is_number(source[curIndex])) {
+                return lex_number();
+            }
+            return make_token(TokenType::UNKNOWN);
+    }
+}
 
-                if (divisor > 0) {
-                    // TODO make sure there is no precision loss
-                    auto tkn = make_token(TokenType::DOUBLE_LITERAL);
-                    tkn->doubleVal = static_cast<double>(number) / divisor;
-                    return tkn;
+TokenID Lexer::lex_number() {
+    int base = 10;
+    if (source[curIndex] == '0') {
+        if (is_cursor_char('b')) {
+            base = 2;
+            curCLen++;
+        } else if (is_cursor_char('o')) {
+            base = 8;
+            curCLen++;
+        } else if (is_cursor_char('x')) {
+            base = 16;
+            curCLen++;
+        }
+    } else {
+        curCLen--;
+    }
+    int digitsI = curIndex + (base == 10 ? 0 : curCLen);
+
+    // The digits are accumulated modulo 2^64 and wrapped records whether the true value ever went past that
+    uint64_t number = 0;
+    bool wrapped = false;
+    int fractionDigits = -1;  // Valid digits after the decimal point or -1 if there is no decimal point
+    for (;;) {
+        uint64_t digits;
+        int numDigits = Literal::parse_digits(source.data() + curIndex + curCLen, base, digits);
+        if (numDigits > 0) {
+            wrapped |= Literal::accumulate(number, Literal::digit_scale(base, numDigits), digits);
+            if (fractionDigits >= 0) fractionDigits += numDigits;
+            curCLen += numDigits;
+            if (numDigits == 8) continue;
+        }
+
+        // Otherwise the digits are followed by a separator, a decimal point, a digit too large for the base or the end
+        // of the literal
+        char ch = source[curIndex + curCLen];
+        if (!((base == 16 && is_hex(ch)) || is_number(ch) || ch == '.')) break;
+        if (ch != '_') {
+            if (ch == '.') {
+                if (source[curIndex + curCLen - 1] == '_') {
+                    dx.err_loc("Underscore is not allowed here", loc(curIndex + curCLen - 1));
+                }
+                if (fractionDigits >= 0) {
+                    dx.err_loc("Numeric literal has too many decimal points \"" +
+                                   std::string(sourceStr.substr(curIndex, curCLen)) + ".\"",
+                               loc(curIndex + curCLen));
                 } else {
-                    auto tkn = make_token(TokenType::INT_LITERAL);
-                    tkn->longVal = number;
-                    return tkn;
+                    fractionDigits = 0;
                 }
+            } else {
+                dx.err_loc(std::to_string(to_num(ch)) + " is an invalid digit value in base " + std::to_string(base),
+                           loc(curIndex + curCLen));
             }
-            return make_token(TokenType::UNKNOWN);
+        } else if (fractionDigits == 0) {
+            dx.err_loc("Underscore is not allowed here", loc(curIndex + curCLen));
+        }
+        curCLen++;
+    }
+    if (source[curIndex + curCLen - 1] == '_') {
+        dx.err_loc("Underscore is not allowed here", loc(curIndex + curCLen - 1));
+    }
+    std::string_view digitStr = sourceStr.substr(digitsI, curIndex + curCLen - digitsI);
+
+    // An l suffix makes an int literal 64-bit and an f suffix makes any literal a float
+    char suffix = source[curIndex + curCLen];
+    char afterSuffix = source[curIndex + curCLen + 1];
+    if ((suffix == 'l' || suffix == 'f') && !is_letter(afterSuffix) && !is_number(afterSuffix)) {
+        curCLen++;
+    } else {
+        suffix = 0;
+    }
+
+    if (fractionDigits < 0 && suffix != 'f') {
+        bool isLong = suffix == 'l';
+        if (wrapped || number > static_cast<uint64_t>(isLong ? LLONG_MAX : INT_MAX)) {
+            if (isLong) {
+                dx.err_loc("Numeric literal is too large to fit in a long", loc(curIndex), loc(curIndex + curCLen))
+                    ->tag(ErrorMsg::WARNING)
+                    ->note("The max value for a long literal is 2^63-1 = 9_223_372_036_854_775_807");
+            } else {
+                dx.err_loc("Numeric literal is too large to fit in an int ", loc(curIndex), loc(curIndex + curCLen))
+                    ->tag(ErrorMsg::WARNING)
+                    ->note("The max value for an int literal is 2^31-1 = 2_147_483_647");
+            }
+        }
+        TokenID tkn = make_token(TokenType::INT_LITERAL);
+        lexed_tokens().set_long(tkn, static_cast<long long>(number), suffix);
+        return tkn;
+    }
+
+    if (suffix == 'l') {
+        dx.err_loc("A long suffix is not allowed on a floating point literal", loc(curIndex + curCLen - 1))
+            ->fix("Use the f suffix for a float or no suffix for a double");
     }
-}
\ No newline at end of file
+    bool isFloat = suffix == 'f';
+    Literal::Range range;
+    double value = Literal::to_floating(digitStr, base, number, !wrapped, std::max(fractionDigits, 0), isFloat, range);
+    const char* typeName = isFloat ? "float" : "double";
+    if (range == Literal::Range::TOO_LARGE) {
+        dx.err_loc(std::string("Numeric literal is too large to fit in a ") + typeName, loc(curIndex),
+                   loc(curIndex + curCLen))
+            ->tag(ErrorMsg::WARNING)
+            ->note(isFloat ? "The max value for a float literal is about 3.4e38"
+                           : "The max value for a double literal is about 1.8e308");
+    } else if (range == Literal::Range::TOO_SMALL) {
+        dx.err_loc(std::string("Numeric literal is too small to fit in a ") + typeName, loc(curIndex),
+                   loc(curIndex + curCLen))
+            ->tag(ErrorMsg::WARNING)
+            ->note("The value is rounded to 0");
+    }
+    TokenID tkn = make_token(TokenType::DOUBLE_LITERAL);
+    lexed_tokens().set_double(tkn, value, isFloat ? 'f' : 0);
+    return tkn;
+}
@@ -0,0 +1,112 @@
+#include "literal.hpp"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+namespace {
+
+// Powers of 10 which are exactly representable
+constexpr double POW10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+constexpr float POW10F[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+constexpr int MAX_POW10 = sizeof(POW10) / sizeof(double) - 1;
+constexpr int MAX_POW10F = sizeof(POW10F) / sizeof(float) - 1;
+constexpr uint64_t MAX_EXACT_DOUBLE = uint64_t{1} << 53;
+constexpr uint64_t MAX_EXACT_FLOAT = uint64_t{1} << 24;
+
+double decimal_to_floating(std::string_view digits, uint64_t mantissa, bool exact, int fractionDigits, bool isFloat,
+                           Literal::Range& range) {
+    // When both the mantissa and the power of 10 are exact, a single division is correctly rounded
+    if (isFloat) {
+        if (exact && mantissa <= MAX_EXACT_FLOAT && fractionDigits <= MAX_POW10F) {
+            return static_cast<float>(mantissa) / POW10F[fractionDigits];
+        }
+    } else if (exact && mantissa <= MAX_EXACT_DOUBLE && fractionDigits <= MAX_POW10) {
+        return static_cast<double>(mantissa) / POW10[fractionDigits];
+    }
+
+    // Otherwise the separators are removed so that the standard library can do the conversion
+    std::string clean;
+    clean.reserve(digits.size());
+    bool seenPoint = false;
+    bool nonZeroInt = false;
+    for (char ch : digits) {
+        if (ch == '.') {
+            if (seenPoint) break;  // Too many decimal points has already been reported
+            seenPoint = true;
+            clean += ch;
+        } else if (ch >= '0' && ch <= '9') {
+            if (!seenPoint && ch != '0') nonZeroInt = true;
+            clean += ch;
+        }
+    }
+
+    const char* begin = clean.data();
+    const char* end = begin + clean.size();
+    double value;
+    std::from_chars_result result;
+    if (isFloat) {
+        float floatValue = 0;
+        result = std::from_chars(begin, end, floatValue);
+        value = floatValue;
+    } else {
+        value = 0;
+        result = std::from_chars(begin, end, value);
+    }
+    if (result.ec == std::errc::result_out_of_range) {
+        // Literals are never negative and have no exponent so only a non zero integer part can be too large
+        range = nonZeroInt ? Literal::Range::TOO_LARGE : Literal::Range::TOO_SMALL;
+        value = nonZeroInt ? HUGE_VAL : 0;
+    }
+    return value;
+}
+
+double binary_to_floating(std::string_view digits, int base, bool isFloat, Literal::Range& range) {
+    int bits = base == 2 ? 1 : base == 8 ? 3 : 4;
+
+    // Keep at least the leading 61 bits of the mantissa. Any non zero bits dropped after that are folded into the
+    // lowest bit so that the final conversion still rounds correctly
+    uint64_t top = 0;
+    int exponent = 0;
+    bool sticky = false;
+    bool fraction = false;
+    for (char ch : digits) {
+        if (ch == '.') {
+            if (fraction) break;
+            fraction = true;
+            continue;
+        }
+        if (ch == '_') continue;
+        int val = Literal::digit_value(ch);
+        if (val >= base) continue;  // Invalid digits have already been reported
+
+        if ((top >> (64 - bits)) == 0) {
+            top = (top << bits) | static_cast<uint64_t>(val);
+            if (fraction) exponent -= bits;
+        } else {
+            sticky |= val != 0;
+            if (!fraction) exponent += bits;
+        }
+    }
+    if (sticky) top |= 1;
+
+    double value = isFloat ? std::ldexp(static_cast<float>(top), exponent)
+                           : std::ldexp(static_cast<double>(top), exponent);
+    if (std::isinf(value)) {
+        range = Literal::Range::TOO_LARGE;
+    } else if (value == 0 && top != 0) {
+        range = Literal::Range::TOO_SMALL;
+    }
+    return value;
+}
+
+}  // namespace
+
+double Literal::to_floating(std::string_view digits, int base, uint64_t mantissa, bool exact, int fractionDigits,
+                            bool isFloat, Range& range) {
+    range = Range::OK;
+    if (base == 10) return decimal_to_floating(digits, mantissa, exact, fractionDigits, isFloat, range);
+    return binary_to_floating(digits, base, isFloat, range);
+}
@@ -1,9 +1,33 @@
+#include <chrono>
 #include <fstream>
 #include <iostream>
 
+#include "ast_visitor.hpp"
+#include "const_fold.hpp"
 #include "flags.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "type_checker.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+inline double elapsed_ms(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+struct NodeCounter : ASTVisitor<NodeCounter> {
+    size_t count = 0;
+
+    template <class T>
+    bool enter(const T&) {
+        count++;
+        return true;
+    }
+};
+
+}  // namespace
 
 int main(int argc, char** argv) {
     if (argc == 1) {
@@ -14,11 +38,79 @@ int main(int argc, char** argv) {
     if (Flags::parse_flags(argc, argv)) {
         Parser parser;
         if (parser.lexer.from_file_path(Flags::filePath)) {
-            auto astTree = parser.parse_program();
+            ASTProgram* astTree = nullptr;
+            FlatAST flatTree;
+            Clock::time_point parseStart = Clock::now();
+            if (Flags::dumpFlat) {
+                flatTree = parser.parse_flat_program();
+            } else {
+                astTree = parser.parse_program();
+            }
+            Clock::time_point parseEnd = Clock::now();
+
+            // Names of flat programs aren't resolved so only a whole AST can be folded or checked
+            bool parsed = !Flags::dumpFlat && !parser.dx.has_errors();
+            ConstFolder folder(parser.lexer.tokens, parser.dx);
+            bool folded = Flags::constFold && parsed;
+            if (folded) folder.fold(*astTree);
+            Clock::time_point foldEnd = Clock::now();
+
+            TypeChecker checker(parser.types, parser.lexer.tokens, parser.lexer.atoms, parser.dx);
+            checker.set_resolver(parser.name_resolver());
+            bool checked = Flags::typeCheck && parsed;
+            if (checked) checker.check(*astTree);
+            Clock::time_point checkEnd = Clock::now();
+
             std::cout << parser.dx.emit() << std::endl;
+            if (Flags::printStats) {
+                std::cout << "-- Peak token memory: " << parser.lexer.peak_token_memory() << " bytes ("
+                          << parser.lexer.lexed_tokens().next_id() << " tokens lexed, " << parser.lexer.tokens.size()
+                          << " retained)" << std::endl;
+                if (Flags::dumpFlat) {
+                    std::cout << "-- AST memory: " << flatTree.memory_usage() << " bytes (" << flatTree.size()
+                              << " flat nodes)" << std::endl;
+                } else {
+                    NodeCounter counter;
+                    counter.traverse(*astTree);
+                    std::cout << "-- AST memory: " << parser.arena.memory_usage() << " bytes (" << counter.count
+                              << " nodes)" << std::endl;
+                }
+                std::cout << "-- Type table: " << parser.types.size() << " distinct types in "
+                          << parser.types.memory_usage() << " bytes" << std::endl;
+                std::cout << "-- Lex and parse: " << elapsed_ms(parseStart, parseEnd) << "ms";
+                if (parser.chunk_count() > 1) {
+                    std::cout << " (" << parser.chunk_count() << " chunks parsed in parallel)";
+                }
+                std::cout << std::endl;
+                if (folded) {
+                    std::cout << "-- Constant folding: " << elapsed_ms(parseEnd, foldEnd) << "ms ("
+                              << folder.folded_count() << " expressions folded, " << folder.constant_count()
+                              << " constants, " << folder.call_count() << " distinct calls run, "
+                              << folder.memo_hit_count() << " reused)" << std::endl;
+                }
+                if (checked) {
+                    std::cout << "-- Type check: " << elapsed_ms(foldEnd, checkEnd) << "ms (" << checker.task_count()
+                              << " tasks, " << checker.suspension_count() << " suspensions, "
+                              << checker.cycle_count() << " cycles";
+                    if (checker.body_count() > 0) {
+                        std::cout << ", " << checker.body_count() << " function bodies on " << checker.thread_count()
+                                  << " threads";
+                    }
+                    std::cout << ")" << std::endl;
+                    std::cout << "-- Type layouts: " << checker.layout_table().memory_usage() << " bytes"
+                              << std::endl;
+                }
+            }
             if (!parser.dx.has_errors()) {
-                if (Flags::dumpInfo.print) dump_ast(*astTree, Flags::dumpInfo.verbose);
-                if (Flags::sourceFmt) std::cout << print_ast(*astTree) << std::endl;
+                if (Flags::dumpFlat) {
+                    dump_flat_ast(flatTree, parser.lexer.tokens);
+                    return EXIT_SUCCESS;
+                }
+                if (Flags::dumpInfo.print) dump_ast(*astTree, parser.lexer.tokens, Flags::dumpInfo.verbose);
+                if (Flags::sourceFmt) {
+                    print_ast(*astTree, parser.lexer.tokens, std::cout);
+                    std::cout << std::endl;
+                }
                 return EXIT_SUCCESS;
             }
         } else {
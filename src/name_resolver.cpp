@@ -0,0 +1,198 @@
+#include "name_resolver.hpp"
+
+#include <algorithm>
+
+#include "ast_visitor.hpp"
+
+void NameResolver::resolve(ASTProgram& program, const TokenList& tokens) {
+    this->tokens = &tokens;
+    push(&program);
+    while (!work.empty()) {
+        Work next = work.back();
+        work.pop_back();
+        switch (next.step) {
+            case Step::WALK:
+                walk(next.node);
+                break;
+            case Step::WALK_MEMBER: {
+                auto decl = static_cast<ASTDecl*>(next.node);
+                visit(decl->rvalue);
+                visit(decl->type);
+                if (decl->lvalue->nodeType != NodeType::NAME) visit(decl->lvalue);
+            } break;
+            case Step::DECLARE:
+                declare(static_cast<ASTDecl*>(next.node));
+                break;
+            case Step::LEAVE:
+                leave();
+                break;
+        }
+    }
+    std::sort(lateNames.begin(), lateNames.end(),
+              [](const LateName& a, const LateName& b) { return a.name < b.name; });
+}
+
+const ASTDecl* NameResolver::late_declaration(const ASTName& name) const {
+    auto late = std::lower_bound(lateNames.begin(), lateNames.end(), &name,
+                                 [](const LateName& late, const ASTName* name) { return late.name < name; });
+    if (late == lateNames.end() || late->name != &name) return nullptr;
+    return scopes.lookup_at(late->at, late->atom);
+}
+
+void NameResolver::enter(ASTNode* node, SymTable** table, bool statements) {
+    scopes.enter(node);
+    openScopes.push_back({table, node, statements, unresolved.size()});
+}
+
+void NameResolver::leave() {
+    const OpenScope& scope = openScopes.back();
+    // A name which no declaration was visible to but which the scope declares now was used before its declaration
+    if (*scope.table != nullptr) {
+        size_t numUnresolved = scope.firstUnresolved;
+        for (size_t i = scope.firstUnresolved; i < unresolved.size(); i++) {
+            AtomID atom = tokens->atom(unresolved[i]->ref);
+            if (scopes.lookup(atom) != nullptr) {
+                lateNames.push_back({unresolved[i], atom, scopes.snapshot()});
+            } else {
+                unresolved[numUnresolved++] = unresolved[i];
+            }
+        }
+        unresolved.resize(numUnresolved);
+    }
+    scopes.leave();
+    openScopes.pop_back();
+}
+
+SymTable* NameResolver::scope_table() {
+    const OpenScope& open = openScopes.back();
+    if (*open.table == nullptr) {
+        SymTable& table = tables.emplace_back();
+        table.id = scopes.current_scope();
+        table.source = const_cast<ASTNode*>(open.node);
+        for (size_t i = openScopes.size() - 1; i-- > 0;) {
+            if (*openScopes[i].table != nullptr) {
+                table.parent = *openScopes[i].table;
+                break;
+            }
+        }
+        *open.table = &table;
+    }
+    return *open.table;
+}
+
+void NameResolver::declare(ASTDecl* decl) {
+    auto name = static_cast<ASTName*>(decl->lvalue);
+    AtomID atom = tokens->atom(name->ref);
+
+    // Without a type, a statement like x = 3 only declares x if no declaration of x is visible yet
+    if (openScopes.back().statements && decl->type == nullptr) {
+        name->decl = scopes.lookup(atom);
+        if (name->decl != nullptr) return;
+    }
+    ASTDecl* existing = scopes.declare(atom, decl);
+    if (existing == nullptr) scope_table()->insert(atom, decl);
+    name->decl = existing != nullptr ? existing : decl;
+}
+
+void NameResolver::resolve_name(ASTName* name) {
+    name->decl = scopes.lookup(tokens->atom(name->ref));
+    if (name->decl == nullptr) unresolved.push_back(name);
+}
+
+void NameResolver::visit(ASTNode* node) {
+    if (node == nullptr) return;
+    switch (node->nodeType) {
+        case NodeType::NAME:
+            resolve_name(static_cast<ASTName*>(node));
+            break;
+        case NodeType::LIT:
+        case NodeType::TYPE_LIT:
+            break;
+        default:
+            work.push_back({node, Step::WALK});
+    }
+}
+
+template <class List>
+void NameResolver::walk_declarations(ASTNode* node, SymTable** table, List& declarations) {
+    enter(node, table, false);
+    scope_table();
+    for (ASTDecl* decl : declarations) {
+        if (decl->lvalue->nodeType == NodeType::NAME) declare(decl);
+    }
+    push(node, Step::LEAVE);
+    size_t first = work.size();
+    for (ASTDecl* decl : declarations) push(decl, Step::WALK_MEMBER);
+    std::reverse(work.begin() + first, work.end());
+}
+
+void NameResolver::walk(ASTNode* node) {
+    switch (node->nodeType) {
+        case NodeType::PROGRAM: {
+            auto program = static_cast<ASTProgram*>(node);
+            walk_declarations(program, &program->symbolTable, program->declarations);
+        } break;
+        case NodeType::MOD: {
+            auto mod = static_cast<ASTMod*>(node);
+            walk_declarations(mod, &mod->symbolTable, mod->declarations);
+        } break;
+        case NodeType::TYPE_DEF: {
+            auto ty = static_cast<ASTTy*>(node);
+            walk_declarations(ty, &ty->symbolTable, ty->declarations);
+        } break;
+        case NodeType::BLOCK: {
+            auto block = static_cast<ASTBlock*>(node);
+            enter(block, &block->symbolTable, true);
+            push(block, Step::LEAVE);
+            size_t first = work.size();
+            for (ASTNode* statement : block->statements) push(statement);
+            std::reverse(work.begin() + first, work.end());
+        } break;
+        case NodeType::FOR: {
+            auto forLoop = static_cast<ASTFor*>(node);
+            enter(forLoop, &forLoop->symbolTable, true);
+            push(forLoop, Step::LEAVE);
+            push(forLoop->blockStmt);
+            push(forLoop->post);
+            if (forLoop->condition != forLoop->initial) push(forLoop->condition);
+            push(forLoop->initial);
+        } break;
+        case NodeType::FUNC: {
+            auto func = static_cast<ASTFunc*>(node);
+            enter(func, &func->symbolTable, false);
+            push(func, Step::LEAVE);
+            push(func->blockOrExpr);
+            push(func->returnType);
+            size_t first = work.size();
+            for (ASTDecl* param : func->parameters) push(param);
+            std::reverse(work.begin() + first, work.end());
+        } break;
+        case NodeType::DECL: {
+            // Declared before the rvalue is walked so that a function can refer to itself
+            auto decl = static_cast<ASTDecl*>(node);
+            push(decl->rvalue);
+            if (decl->lvalue->nodeType == NodeType::NAME) push(decl, Step::DECLARE);
+            visit(decl->type);
+            if (decl->lvalue->nodeType != NodeType::NAME) visit(decl->lvalue);
+        } break;
+        case NodeType::NAME:
+            resolve_name(static_cast<ASTName*>(node));
+            break;
+        case NodeType::DOT_OP:
+            visit(static_cast<ASTDotOp*>(node)->base);  // Members are resolved with the type of the base
+            break;
+        case NodeType::TYPE_INIT: {
+            // Fields are found in the type being initialized
+            auto typeInit = static_cast<ASTTypeInit*>(node);
+            size_t first = work.size();
+            visit(typeInit->typeRef);
+            for (ASTDecl* assignment : typeInit->assignments) visit(assignment->rvalue);
+            std::reverse(work.begin() + first, work.end());
+        } break;
+        default: {
+            size_t first = work.size();
+            for_each_child(*node, [&](const ASTNode* child) { visit(const_cast<ASTNode*>(child)); });
+            std::reverse(work.begin() + first, work.end());
+        }
+    }
+}
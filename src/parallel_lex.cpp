@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "lexer.hpp"
+#include "scan.hpp"
+
+// Parallel lexing of a single file happens in three steps:
+//  1. The file is split into chunks just after newlines. Apart from string literals and comments, no token contains a
+//     newline, so almost every split lands between two tokens.
+//  2. Every chunk is lexed on a worker thread as if the serial lexer had reached the start of the chunk between tokens.
+//  3. The chunks are stitched together in order. A chunk's guessed tokens are only kept if the lexer of the previous
+//     chunk actually passed through the start of the chunk between tokens. Otherwise (the split was inside a string
+//     or block comment) the chunk is lexed again from where the previous chunk really stopped until the new tokens
+//     line up with the guessed ones, which usually happens right after the string or comment ends.
+//     Every chunk lexer interns into its own atom table and those tables are merged into the file's table here.
+
+namespace {
+
+constexpr size_t CHUNKS_PER_THREAD = 4;  // Extra chunks so threads which finish early can pick up more work
+constexpr size_t MIN_CHUNK_SIZE = 1 << 18;
+
+// Run work(0) to work(count - 1) on numThreads threads including the calling thread
+template <class F>
+void parallel_for(size_t count, int numThreads, F work) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) work(i);
+    };
+    std::vector<std::thread> threads;
+    for (size_t t = 1; t < static_cast<size_t>(numThreads) && t < count; t++) threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads) thread.join();
+}
+
+}  // namespace
+
+struct Lexer::ChunkLex {
+    TokenList tokens;
+    std::vector<std::unique_ptr<ErrorMsg>> errors;
+    std::vector<TokenID> errorTokens;  // Token in the list which was being lexed when each error was reported
+
+    AtomTable atoms;
+    std::vector<AtomID> atomMap;  // Atom in the file's table of each atom in the chunk's table
+
+    int stopIndex = 0;  // Where the lexer stopped. See chunkSynced
+    bool synced = false;
+
+    // When lexing again after a bad guess: whether the tokens lined up with the guess and if so, how many of the
+    // guessed tokens were replaced
+    bool aligned = false;
+    size_t replaced = 0;
+};
+
+struct Lexer::Chunk {
+    int beginI;
+    int endI;  // INT_MAX for the last chunk so that it lexes until the end of the file
+
+    ChunkLex guess = {};
+    ChunkLex fix = {};
+    bool fixed = false;
+
+    TokenID firstID = 0;
+    size_t firstLiteral = 0;
+
+    // The lexer which decided where the chunk ends
+    inline const ChunkLex& last() const { return fixed && !fix.aligned ? fix : guess; }
+};
+
+void Lexer::lex_chunk(int beginI, int endI, ChunkLex& out, const TokenList* guess) const {
+    Lexer lexer;
+    lexer.source.share(source);
+    lexer.sourceStr = lexer.source.view();
+    size_t expectedTokens = 0;
+    if (guess == nullptr) expectedTokens = (std::min<size_t>(endI, sourceStr.length()) - beginI) / 4 + 16;
+    // Tokens of a chunk keep plain offsets so that they can be lined up with the lexer's position. Only the errors
+    // need real locations
+    lexer.tokens.reset(lexer.sourceStr, 0, expectedTokens);
+    lexer.fileBase = fileBase;
+    lexer.curIndex = beginI;
+    lexer.chunkEnd = endI;
+
+    TokenID guessID = 0;
+    for (;;) {
+        if (guess != nullptr) {
+            // Both lexers are between tokens here so once a guessed token ends at the same place, the rest line up.
+            // END doesn't count since it also ends past the last character, where an unterminated token may stop
+            while (guessID < guess->size() && guess->end(guessID) < lexer.curIndex) guessID++;
+            if (guessID < guess->size() && guess->end(guessID) == lexer.curIndex &&
+                guess->type(guessID) != TokenType::END) {
+                out.aligned = true;
+                out.replaced = guessID + 1;
+                break;
+            }
+        }
+
+        TokenID lexingID = lexer.tokens.next_id();
+        size_t numErrors = lexer.dx.error_count();
+        TokenID id = lexer.consume_token();
+        for (size_t i = numErrors; i < lexer.dx.error_count(); i++) out.errorTokens.push_back(lexingID);
+        if (id == NULL_TOKEN || lexer.tokens.type(id) == TokenType::END) break;
+    }
+    if (guess != nullptr && !out.aligned) out.replaced = guess->size();
+
+    out.stopIndex = lexer.curIndex;
+    out.synced = lexer.chunkSynced;
+    out.tokens = std::move(lexer.tokens);
+    out.atoms = std::move(lexer.atoms);
+    out.errors = lexer.dx.take_errors();
+}
+
+void Lexer::lex_parallel(int numThreads) {
+    size_t length = sourceStr.length();
+    size_t numChunks = std::max<size_t>(1, std::min(numThreads * CHUNKS_PER_THREAD, length / MIN_CHUNK_SIZE));
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(numChunks);
+    size_t beginI = 0;
+    for (size_t c = 1; c <= numChunks; c++) {
+        size_t endI = length;
+        if (c < numChunks) {
+            endI = Scan::find_newline(source.data(), std::max(beginI, length * c / numChunks), length) + 1;
+        }
+        if (endI >= length) {
+            chunks.push_back({static_cast<int>(beginI), INT_MAX});
+            break;
+        }
+        chunks.push_back({static_cast<int>(beginI), static_cast<int>(endI)});
+        beginI = endI;
+    }
+
+    parallel_for(chunks.size(), numThreads, [&](size_t c) {
+        lex_chunk(chunks[c].beginI, chunks[c].endI, chunks[c].guess, nullptr);
+    });
+
+    size_t numTokens = 0;
+    size_t numLiterals = 0;
+    size_t scratchMemory = 0;
+    auto merge_atoms = [&](ChunkLex& lex) {
+        lex.atomMap.resize(lex.atoms.size());
+        for (AtomID atom = 0; atom < lex.atoms.size(); atom++) {
+            lex.atomMap[atom] = atoms.intern(lex.atoms.str(atom), lex.atoms.hash(atom));
+        }
+    };
+    for (size_t c = 0; c < chunks.size(); c++) {
+        Chunk& chunk = chunks[c];
+        if (c > 0 && !chunks[c - 1].last().synced) {
+            chunk.fixed = true;
+            lex_chunk(chunks[c - 1].last().stopIndex, chunk.endI, chunk.fix, &chunk.guess.tokens);
+        }
+
+        chunk.firstID = static_cast<TokenID>(numTokens);
+        chunk.firstLiteral = numLiterals;
+        for (size_t e = 0; e < chunk.fix.errors.size(); e++) {
+            deferredErrors.push_back({chunk.firstID + chunk.fix.errorTokens[e], std::move(chunk.fix.errors[e])});
+        }
+        numTokens += chunk.fix.tokens.size();
+        merge_atoms(chunk.fix);
+        bool keepGuess = !chunk.fixed || chunk.fix.aligned;
+        if (keepGuess) merge_atoms(chunk.guess);
+        for (size_t e = 0; keepGuess && e < chunk.guess.errors.size(); e++) {
+            TokenID guessID = chunk.guess.errorTokens[e];
+            if (guessID < chunk.fix.replaced) continue;
+            deferredErrors.push_back({static_cast<TokenID>(numTokens + guessID - chunk.fix.replaced),
+                                      std::move(chunk.guess.errors[e])});
+        }
+        numTokens += chunk.guess.tokens.size() - chunk.fix.replaced;
+        numLiterals += chunk.fix.tokens.literal_count() + chunk.guess.tokens.literal_count();
+        scratchMemory += chunk.fix.tokens.memory_usage() + chunk.guess.tokens.memory_usage();
+    }
+
+    tokens.resize(numTokens, numLiterals);
+    parallel_for(chunks.size(), numThreads, [&](size_t c) {
+        const Chunk& chunk = chunks[c];
+        const TokenList& fix = chunk.fix.tokens;
+        tokens.copy_chunk(fix, 0, chunk.firstID, chunk.firstLiteral, chunk.fix.atomMap);
+        tokens.copy_chunk(chunk.guess.tokens, chunk.fix.replaced, chunk.firstID + fix.size(),
+                          chunk.firstLiteral + fix.literal_count(), chunk.guess.atomMap);
+    });
+
+    peakScratchMemory = scratchMemory;
+    if (!deferredErrors.empty()) deferredTokenID = deferredErrors[0].token;
+}
+
+void Lexer::flush_deferred_errors() {
+    while (nextDeferred < deferredErrors.size() && deferredErrors[nextDeferred].token <= cacheIndex) {
+        dx.add_err(std::move(deferredErrors[nextDeferred++].msg));
+    }
+    deferredTokenID = nextDeferred < deferredErrors.size() ? deferredErrors[nextDeferred].token : NULL_TOKEN;
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "flags.hpp"
+#include "parser.hpp"
+
+// Parallel parsing of a program whose whole file was lexed ahead, which -j above 1 and a large file turn on, happens in
+// three steps:
+//  1. A scan of the tokens which only keeps track of brackets finds where the global declarations of names start: an
+//     identifier followed by :, = or => outside of any brackets, right after a token which can end an expression.
+//     The program is split into one chunk per thread at some of these.
+//  2. Every chunk is parsed on a worker thread by a parser of its own, with its own arena, type table and diagnostics.
+//  3. The chunks are merged in order. Their types are interned into the program's table in the order they were made,
+//     which numbers them the same as the serial parser. Like the serial parser, nothing after the first chunk with
+//     errors is kept. The names of the merged program are then resolved just like after a serial parse.
+// A chunk is only merged if the chunk before it stopped right at its first token. Otherwise the scan guessed wrong,
+// which can only happen in code with errors, and the program is parsed serially instead.
+
+namespace {
+
+constexpr size_t MIN_CHUNK_TOKENS = 1 << 16;
+// Smaller files are always parsed serially. Below this the scan and the merge cost about as much as a chunk saves
+constexpr size_t MIN_SOURCE_SIZE = 4 << 20;
+
+// Whether an expression can end with the token, in which case the next token may start another declaration
+inline bool ends_expression(TokenType type) {
+    switch (type) {
+        case TokenType::IDENTIFIER:
+        case TokenType::VOID_TYPE:
+        case TokenType::MOD_TYPE:
+        case TokenType::TY_TYPE:
+        case TokenType::INT_TYPE:
+        case TokenType::DOUBLE_TYPE:
+        case TokenType::STRING_TYPE:
+        case TokenType::BOOL_TYPE:
+        case TokenType::INT_LITERAL:
+        case TokenType::DOUBLE_LITERAL:
+        case TokenType::STRING_LITERAL:
+        case TokenType::TRUE:
+        case TokenType::FALSE:
+        case TokenType::RIGHT_PARENS:
+        case TokenType::RIGHT_CURLY:
+        case TokenType::DEREF:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// First token of every global declaration of a name the scan finds
+void scan_globals(const TokenList& tokens, std::vector<TokenID>& starts) {
+    int depth = 0;
+    TokenType prev = TokenType::RIGHT_CURLY;  // The first token starts a declaration
+    for (TokenID id = 0; id + 1 < tokens.next_id(); id++) {
+        TokenType type = tokens.type(id);
+        switch (type) {
+            case TokenType::LEFT_CURLY:
+            case TokenType::LEFT_PARENS:
+                depth++;
+                break;
+            case TokenType::RIGHT_CURLY:
+            case TokenType::RIGHT_PARENS:
+                depth--;
+                break;
+            case TokenType::IDENTIFIER: {
+                if (depth != 0 || !ends_expression(prev)) break;
+                TokenType next = tokens.type(id + 1);
+                if (next == TokenType::COLON || next == TokenType::ASSIGNMENT || next == TokenType::CONST_ASSIGNMENT) {
+                    starts.push_back(id);
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        prev = type;
+    }
+}
+
+// Run work(0) to work(count - 1) on a thread each, with work(0) on the calling thread
+template <class F>
+void run_each(size_t count, F work) {
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < count; i++) threads.emplace_back(work, i);
+    work(0);
+    for (auto& thread : threads) thread.join();
+}
+
+}  // namespace
+
+struct Parser::Chunk {
+    TokenID first;
+    TokenID end;  // First token of the next chunk or the END token
+
+    std::unique_ptr<Parser> parser;
+    ASTProgram* prgm = nullptr;  // Holds the declarations of the chunk
+};
+
+bool Parser::parse_chunks(ASTProgram* prgm) {
+    // Unlike lexing, parsing only splits the program when -j asks for more than one thread, since the merge only pays
+    // for itself with several cores to spare
+    int numThreads = Flags::numThreads;
+    const TokenList& tokens = lexer.tokens;
+    if (numThreads < 2 || lexer.sourceStr.size() < MIN_SOURCE_SIZE || tokens.size() < 2 * MIN_CHUNK_TOKENS) {
+        return false;
+    }
+
+    std::vector<TokenID> starts;
+    scan_globals(tokens, starts);
+
+    // Chunks are split at the first declaration after an even share of the tokens
+    TokenID endID = tokens.next_id() - 1;
+    size_t maxChunks = std::min<size_t>(numThreads, tokens.size() / MIN_CHUNK_TOKENS);
+    std::vector<Chunk> chunks;
+    chunks.push_back({lexer.peek_token().id, endID, nullptr});
+    for (size_t s = 0, c = 1; c < maxChunks; c++) {
+        TokenID target = static_cast<TokenID>(tokens.size() * c / maxChunks);
+        while (s < starts.size() && (starts[s] < target || starts[s] <= chunks.back().first)) s++;
+        if (s == starts.size()) break;
+        chunks.back().end = starts[s];
+        chunks.push_back({starts[s], endID, nullptr});
+    }
+    if (chunks.size() < 2) return false;
+
+    for (Chunk& chunk : chunks) chunk.parser.reset(new Parser(lexer, chunk.first));
+    run_each(chunks.size(), [&](size_t c) { chunks[c].prgm = chunks[c].parser->parse_chunk(chunks[c].end); });
+
+    // Chunks after one with errors are left out just like the serial parser stops at the first error
+    size_t numMerged = chunks.size();
+    for (size_t c = 0; c < chunks.size(); c++) {
+        Parser& parser = *chunks[c].parser;
+        if (parser.dx.has_errors()) {
+            numMerged = c + 1;
+            break;
+        }
+        if (parser.lexer.peek_token().id != chunks[c].end) return false;
+    }
+
+    for (size_t c = 0; c < numMerged; c++) merge_chunk(prgm, *chunks[c].parser, chunks[c].prgm);
+    numChunks = chunks.size();
+    return true;
+}
+
+ASTProgram* Parser::parse_chunk(TokenID end) {
+    inChunk = true;
+    auto prgm = arena.make<ASTProgram>();
+    while (!check_token(TokenType::END) && lexer.peek_token().id < end) {
+        auto decl = parse_global_decl();
+        if (decl != nullptr) prgm->declarations.push_back(arena, decl);
+        if (dx.has_errors()) break;
+    }
+    return prgm;
+}
+
+void Parser::merge_chunk(ASTProgram* prgm, Parser& chunk, ASTProgram* chunkPrgm) {
+    std::vector<TypeID> typeIDs = types.merge(chunk.types);
+    for (TypeID* field : chunk.typeFields) {
+        if (*field != NULL_TYPE) *field = typeIDs[*field];
+    }
+    arena.absorb(chunk.arena);
+
+    for (ASTDecl* decl : chunkPrgm->declarations) prgm->declarations.push_back(arena, decl);
+    for (auto& error : chunk.dx.take_errors()) dx.add_err(std::move(error));
+}
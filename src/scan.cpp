@@ -0,0 +1,138 @@
+#include "scan.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+inline bool is_whitespace(char ch) { return ch == ' ' || ch == '\t' || ch == '\n'; }
+
+size_t scalar_skip_whitespace(const char* src, size_t i, size_t len) {
+    while (i < len && is_whitespace(src[i])) i++;
+    return i;
+}
+
+size_t scalar_find_newline(const char* src, size_t i, size_t len) {
+    while (i < len && src[i] != '\n') i++;
+    return i;
+}
+
+size_t scalar_find_block_end(const char* src, size_t i, size_t len) {
+    for (; i + 1 < len; i++) {
+        if (src[i] == '*' && src[i + 1] == '/') return i;
+    }
+    return len;
+}
+
+#ifdef SCAN_X86
+
+__attribute__((target("sse2"))) size_t sse2_skip_whitespace(const char* src, size_t i, size_t len) {
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)),
+                                  _mm_cmpeq_epi8(chunk, newline));
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(ws)) & 0xffff;
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return scalar_skip_whitespace(src, i, len);
+}
+
+__attribute__((target("sse2"))) size_t sse2_find_newline(const char* src, size_t i, size_t len) {
+    const __m128i newline = _mm_set1_epi8('\n');
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return scalar_find_newline(src, i, len);
+}
+
+__attribute__((target("sse2"))) size_t sse2_find_block_end(const char* src, size_t i, size_t len) {
+    const __m128i star = _mm_set1_epi8('*');
+    const __m128i slash = _mm_set1_epi8('/');
+    // The second load reads one character ahead so that a "*/" straddling two chunks is still found
+    for (; i + 17 <= len; i += 16) {
+        __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 1));
+        __m128i match = _mm_and_si128(_mm_cmpeq_epi8(first, star), _mm_cmpeq_epi8(second, slash));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(match));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return scalar_find_block_end(src, i, len);
+}
+
+__attribute__((target("avx2"))) size_t avx2_skip_whitespace(const char* src, size_t i, size_t len) {
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+                                     _mm256_cmpeq_epi8(chunk, newline));
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(ws));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return sse2_skip_whitespace(src, i, len);
+}
+
+__attribute__((target("avx2"))) size_t avx2_find_newline(const char* src, size_t i, size_t len) {
+    const __m256i newline = _mm256_set1_epi8('\n');
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline)));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return sse2_find_newline(src, i, len);
+}
+
+__attribute__((target("avx2"))) size_t avx2_find_block_end(const char* src, size_t i, size_t len) {
+    const __m256i star = _mm256_set1_epi8('*');
+    const __m256i slash = _mm256_set1_epi8('/');
+    for (; i + 33 <= len; i += 32) {
+        __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 1));
+        __m256i match = _mm256_and_si256(_mm256_cmpeq_epi8(first, star), _mm256_cmpeq_epi8(second, slash));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(match));
+        if (mask != 0) return i + __builtin_ctz(mask);
+    }
+    return sse2_find_block_end(src, i, len);
+}
+
+#endif
+
+struct ScanImpl {
+    const char* name;
+    size_t (*skip_whitespace)(const char*, size_t, size_t);
+    size_t (*find_newline)(const char*, size_t, size_t);
+    size_t (*find_block_end)(const char*, size_t, size_t);
+};
+
+ScanImpl select_impl() {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {"avx2", avx2_skip_whitespace, avx2_find_newline, avx2_find_block_end};
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return {"sse2", sse2_skip_whitespace, sse2_find_newline, sse2_find_block_end};
+    }
+#endif
+    return {"scalar", scalar_skip_whitespace, scalar_find_newline, scalar_find_block_end};
+}
+
+const ScanImpl impl = select_impl();
+
+}  // namespace
+
+size_t Scan::skip_whitespace_run(const char* src, size_t i, size_t len) { return impl.skip_whitespace(src, i, len); }
+
+size_t Scan::find_newline(const char* src, size_t i, size_t len) { return impl.find_newline(src, i, len); }
+
+size_t Scan::find_block_end(const char* src, size_t i, size_t len) { return impl.find_block_end(src, i, len); }
+
+const char* Scan::isa_name() { return impl.name; }
@@ -0,0 +1,68 @@
+#include "scope_stack.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "diagnostics.hpp"
+
+ScopeID ScopeStack::enter(const ASTNode* node) {
+    ScopeID scope = static_cast<ScopeID>(scopes.size());
+    uint32_t depth = current == NULL_SCOPE ? 1 : scopes[current].depth + 1;
+    scopes.push_back({node, current, depth, NULL_SCOPE, static_cast<uint32_t>(live.size())});
+    current = scope;
+    return scope;
+}
+
+void ScopeStack::leave() {
+    ASSERT(current != NULL_SCOPE, "No scope to leave");
+    Scope& scope = scopes[current];
+
+    // Names declared in the scope go back to whatever they shadowed, innermost first
+    for (size_t i = live.size(); i-- > scope.firstLive;) {
+        const Binding& binding = bindings[live[i]];
+        names[binding.name].visible = binding.shadowed;
+    }
+    live.resize(scope.firstLive);
+
+    scope.lastDescendant = static_cast<ScopeID>(scopes.size() - 1);
+    current = scope.parent;
+}
+
+ASTDecl* ScopeStack::declare(AtomID name, ASTDecl* decl) {
+    ASSERT(current != NULL_SCOPE, "Declarations must be made in a scope");
+    if (name >= names.size()) names.resize(std::max<size_t>(name + 1, names.size() * 2), {NO_BINDING, NO_BINDING});
+
+    Name& entry = names[name];
+    if (entry.visible != NO_BINDING && bindings[entry.visible].scope == current) return bindings[entry.visible].decl;
+
+    uint32_t binding = static_cast<uint32_t>(bindings.size());
+    bindings.push_back({name, current, decl, entry.visible, entry.latest});
+    live.push_back(binding);
+    entry.visible = binding;
+    entry.latest = binding;
+    return nullptr;
+}
+
+ASTDecl* ScopeStack::lookup_at(const ScopeSnapshot& snapshot, AtomID name) const {
+    if (name >= names.size() || snapshot.scope == NULL_SCOPE) return nullptr;
+
+    // A scope can't declare anything while a scope inside of it is open, so the latest binding which was made before
+    // the snapshot in one of the snapshot's scopes is the innermost one
+    for (uint32_t b = names[name].latest; b != NO_BINDING; b = bindings[b].prevOfName) {
+        if (b < snapshot.numBindings && encloses(bindings[b].scope, snapshot.scope)) return bindings[b].decl;
+    }
+    return nullptr;
+}
+
+void ScopeStack::clear() {
+    bindings.clear();
+    scopes.clear();
+    live.clear();
+    names.clear();
+    current = NULL_SCOPE;
+}
+
+size_t ScopeStack::memory_usage() const {
+    return bindings.capacity() * sizeof(Binding) + scopes.capacity() * sizeof(Scope) +
+           live.capacity() * sizeof(uint32_t) + names.capacity() * sizeof(Name);
+}
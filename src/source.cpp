@@ -0,0 +1,105 @@
+#include "source.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Padding for the empty buffer so that lookahead is always valid, even before a file has been opened
+const char EMPTY_BUFFER[SourceBuffer::PADDING] = {};
+
+// Fallback for when the file can't be memory mapped (pipes, unsupported platforms, etc)
+bool read_into_heap(FILE* file, const char*& buffer, size_t& length) {
+    size_t capacity = 1 << 16;
+    size_t size = 0;
+    char* data = new char[capacity + SourceBuffer::PADDING];
+    for (;;) {
+        size += fread(data + size, 1, capacity - size, file);
+        if (size < capacity) break;
+        char* grown = new char[capacity * 2 + SourceBuffer::PADDING];
+        memcpy(grown, data, size);
+        delete[] data;
+        data = grown;
+        capacity *= 2;
+    }
+    if (ferror(file)) {
+        delete[] data;
+        return false;
+    }
+    memset(data + size, 0, SourceBuffer::PADDING);
+    buffer = data;
+    length = size;
+    return true;
+}
+
+}  // namespace
+
+SourceBuffer::SourceBuffer() : buffer(EMPTY_BUFFER) {}
+
+void SourceBuffer::release() {
+    if (shared) {
+        shared = false;
+    } else if (mappedLength > 0) {
+#ifndef _WIN32
+        munmap(const_cast<char*>(buffer), mappedLength);
+#endif
+    } else if (buffer != EMPTY_BUFFER) {
+        delete[] buffer;
+    }
+    buffer = EMPTY_BUFFER;
+    length = 0;
+    mappedLength = 0;
+}
+
+void SourceBuffer::share(const SourceBuffer& other) {
+    release();
+    buffer = other.buffer;
+    length = other.length;
+    shared = true;
+}
+
+bool SourceBuffer::open(const char* filePath) {
+    release();
+#ifndef _WIN32
+    int fd = ::open(filePath, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        size_t fileSize = static_cast<size_t>(info.st_size);
+        size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t totalSize = (fileSize + PADDING + pageSize - 1) / pageSize * pageSize;
+
+        // Reserve zeroed pages for the file and its padding, then map the file over the start of the reservation.
+        // The remainder of the file's last page is zero filled by the kernel and the padding comes from the
+        // anonymous pages which follow it
+        void* base = mmap(nullptr, totalSize, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base != MAP_FAILED) {
+            if (fileSize == 0 ||
+                mmap(base, fileSize, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) != MAP_FAILED) {
+                madvise(base, totalSize, MADV_SEQUENTIAL);
+                close(fd);
+                buffer = static_cast<const char*>(base);
+                length = fileSize;
+                mappedLength = totalSize;
+                return true;
+            }
+            munmap(base, totalSize);
+        }
+    }
+    close(fd);
+#endif
+
+    FILE* file = fopen(filePath, "rb");
+    if (file == nullptr) return false;
+    bool success = read_into_heap(file, buffer, length);
+    fclose(file);
+    return success;
+}
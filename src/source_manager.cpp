@@ -0,0 +1,45 @@
+#include "source_manager.hpp"
+
+#include <algorithm>
+#include <climits>
+
+#include "scan.hpp"
+
+FileID SourceManager::open(const char* filePath) {
+    auto buffer = std::make_unique<SourceBuffer>();
+    if (!buffer->open(filePath)) return NULL_FILE;
+
+    // One extra location after the last character so that the end of file token has a location in the file
+    size_t size = buffer->size();
+    if (size >= static_cast<size_t>(INT_MAX) - nextBase) return NULL_FILE;
+
+    File file{filePath, std::move(buffer), nextBase, {}};
+    nextBase += static_cast<SourceLoc>(size + 1);
+
+    const char* src = file.buffer->data();
+    file.lineStarts.push_back(0);
+    for (size_t i = Scan::find_newline(src, 0, size); i < size; i = Scan::find_newline(src, i + 1, size)) {
+        file.lineStarts.push_back(static_cast<uint32_t>(i + 1));
+    }
+
+    files.push_back(std::move(file));
+    return static_cast<FileID>(files.size() - 1);
+}
+
+FileID SourceManager::file_of(SourceLoc loc) const {
+    auto after = std::upper_bound(files.begin(), files.end(), loc,
+                                  [](SourceLoc loc, const File& file) { return loc < file.base; });
+    return after == files.begin() ? NULL_FILE : static_cast<FileID>(after - files.begin() - 1);
+}
+
+uint32_t SourceManager::line_of(FileID file, uint32_t offset) const {
+    const std::vector<uint32_t>& lineStarts = files[file].lineStarts;
+    return static_cast<uint32_t>(std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin() -
+                                 1);
+}
+
+size_t SourceManager::memory_usage() const {
+    size_t bytes = files.capacity() * sizeof(File);
+    for (const File& file : files) bytes += file.lineStarts.capacity() * sizeof(uint32_t);
+    return bytes;
+}
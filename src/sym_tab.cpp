@@ -1,52 +1,112 @@
 #include "sym_tab.hpp"
 
-#include "lexer.hpp"
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace {
 
-int hash(const Token& identifier) {
-    const char* offset = identifier.sourceStr->c_str() + identifier.beginI;
-    int hash = 0;
-    int cLen = identifier.endI - identifier.beginI;
-    for (int i = 0; i < cLen; i++) {
-        hash = hash * 31 + *(offset + i);
-    }
-    return (hash & 0x7fffffff) % SymTable::NUM_BUCKETS;
-}
+constexpr uint8_t EMPTY_TAG = 0;
+constexpr uint32_t SLOT_MASK = (1u << SymTable::GROUP_SLOTS) - 1;
 
-// Compare the identifier names as present in the source file string
-bool cmp_identifier(const Token& first, const Token& second) {
-    int firstCLen = first.endI - first.beginI;
-    int secondCLen = second.endI - second.beginI;
-    if (firstCLen != secondCLen) return false;
-    const char* firstStr = first.sourceStr->c_str() + first.beginI;
-    const char* secondStr = second.sourceStr->c_str() + second.beginI;
+// Maximum fraction of slots which can be in use before the table grows
+constexpr size_t MAX_LOAD_NUM = 7;
+constexpr size_t MAX_LOAD_DEN = 8;
 
-    for (int i = 0; i < firstCLen; i++) {
-        if (firstStr[i] != secondStr[i]) return false;
-    }
-    return true;
+// Atoms are numbered consecutively so they are spread over the table with a multiplicative hash. The group comes from
+// the top bits of the hash and the tag from the bottom bits so that the two are independent
+inline uint32_t hash_atom(AtomID identifier) { return identifier * 2654435769u; }
+inline uint8_t tag_of(uint32_t hash) { return static_cast<uint8_t>(hash | 0x80); }
+inline size_t group_of(uint32_t hash, size_t numGroups) {
+    return static_cast<size_t>((static_cast<uint64_t>(hash) * numGroups) >> 32);
+}
+
+// Bit i is set if the tag of slot i is tag
+inline uint32_t match_tag(const SymTable::Group& group, uint8_t tag) {
+#ifdef __SSE2__
+    __m128i tags = _mm_load_si128(reinterpret_cast<const __m128i*>(group.tags));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < SymTable::GROUP_SLOTS; i++) mask |= static_cast<uint32_t>(group.tags[i] == tag) << i;
+    return mask;
+#endif
 }
 
 }  // namespace
 
-void SymTable::insert(Token* identifier, ASTDecl* decl) {
-    int index = hash(*identifier);
+void SymTable::grow() {
+    groups.assign(groups.empty() ? 1 : groups.size() * 2, Group());
+    for (Group& group : groups) memset(group.tags, EMPTY_TAG, sizeof(group.tags));
+    for (uint32_t i = 0; i < entries.size(); i++) insert_index(hash_atom(entries[i].identifier), i);
+}
 
-    // TODO search through linked list for existing identifier and preemptive return if found
+void SymTable::insert_index(uint32_t hash, uint32_t entry) {
+    size_t mask = groups.size() - 1;
+    for (size_t g = group_of(hash, groups.size());; g = (g + 1) & mask) {
+        uint32_t empty = match_tag(groups[g], EMPTY_TAG) & SLOT_MASK;
+        if (empty != 0) {
+            uint32_t slot = __builtin_ctz(empty);
+            groups[g].tags[slot] = tag_of(hash);
+            groups[g].entries[slot] = entry;
+            return;
+        }
+    }
+}
 
-    TableEntry* entry = new TableEntry(table[index]);
-    table[index] = entry;
+TableEntry* SymTable::insert(AtomID identifier, ASTDecl* decl) {
+    if (groups.empty() && entries.size() < MAX_UNINDEXED) {
+        for (TableEntry& entry : entries) {
+            if (entry.identifier == identifier) return &entry;
+        }
+        if (entries.empty()) entries.reserve(MAX_UNINDEXED);
+        entries.push_back({identifier, decl});
+        return nullptr;
+    }
+    if ((entries.size() + 1) * MAX_LOAD_DEN > groups.size() * GROUP_SLOTS * MAX_LOAD_NUM) grow();
 
-    entry->identifier = identifier;
-    entry->decl = decl;
+    // Probe for the identifier and stop at the first group with room, which is where it would have been put
+    uint32_t hash = hash_atom(identifier);
+    uint8_t tag = tag_of(hash);
+    size_t mask = groups.size() - 1;
+    for (size_t g = group_of(hash, groups.size());; g = (g + 1) & mask) {
+        Group& group = groups[g];
+        for (uint32_t match = match_tag(group, tag); match != 0; match &= match - 1) {
+            // Identifiers with the same spelling always share an atom
+            TableEntry& entry = entries[group.entries[__builtin_ctz(match)]];
+            if (entry.identifier == identifier) return &entry;
+        }
+        uint32_t empty = match_tag(group, EMPTY_TAG) & SLOT_MASK;
+        if (empty != 0) {
+            uint32_t slot = __builtin_ctz(empty);
+            group.tags[slot] = tag;
+            group.entries[slot] = static_cast<uint32_t>(entries.size());
+            entries.push_back({identifier, decl});
+            return nullptr;
+        }
+    }
 }
 
-TableEntry* SymTable::find(Token* identifier) {
-    TableEntry* chain = table[hash(*identifier)];
-    while (chain != nullptr) {
-        if (cmp_identifier(*chain->identifier, *identifier)) return chain;
-        chain = chain->next;
+TableEntry* SymTable::find(AtomID identifier) {
+    if (groups.empty()) {
+        for (TableEntry& entry : entries) {
+            if (entry.identifier == identifier) return &entry;
+        }
+        return nullptr;
     }
-    return nullptr;
-}
\ No newline at end of file
+
+    uint32_t hash = hash_atom(identifier);
+    uint8_t tag = tag_of(hash);
+    size_t mask = groups.size() - 1;
+    for (size_t g = group_of(hash, groups.size());; g = (g + 1) & mask) {
+        const Group& group = groups[g];
+        for (uint32_t match = match_tag(group, tag); match != 0; match &= match - 1) {
+            TableEntry& entry = entries[group.entries[__builtin_ctz(match)]];
+            if (entry.identifier == identifier) return &entry;
+        }
+        // Slots are never freed so the identifier would have been put in this group if it were in the table
+        if ((match_tag(group, EMPTY_TAG) & SLOT_MASK) != 0) return nullptr;
+    }
+}
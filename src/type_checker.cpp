@@ -0,0 +1,995 @@
+#include "type_checker.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#include "flags.hpp"
+#include "lexer.hpp"
+#include "name_resolver.hpp"
+
+namespace {
+
+// Return type of a function without an annotation until its first return or its body is checked
+constexpr TypeID UNINFERRED = NULL_TYPE - 1;
+
+constexpr CheckedValue NO_VALUE = {NULL_TYPE, NULL_TYPE, nullptr};
+
+// Run work(worker, 0) to work(worker, count - 1) on numWorkers threads including the calling thread. Every worker
+// starts with an equal share of consecutive jobs which it takes from the front. A worker which runs out steals the back
+// half of the jobs another worker has left, so a few long jobs don't leave the other workers waiting
+template <class F>
+void steal_for(size_t count, size_t numWorkers, F work) {
+    // The jobs left to a worker as begin << 32 | end, so that the owner and a thief claim jobs with a single exchange
+    struct alignas(64) Jobs {
+        std::atomic<uint64_t> range;
+    };
+    auto pack = [](uint64_t begin, uint64_t end) { return begin << 32 | end; };
+    auto begin_of = [](uint64_t range) { return range >> 32; };
+    auto end_of = [](uint64_t range) { return range & UINT32_MAX; };
+
+    std::vector<Jobs> jobs(numWorkers);
+    for (size_t w = 0; w < numWorkers; w++) jobs[w].range = pack(count * w / numWorkers, count * (w + 1) / numWorkers);
+
+    auto worker = [&](size_t w) {
+        while (true) {
+            uint64_t range = jobs[w].range.load();
+            while (begin_of(range) < end_of(range)) {
+                if (jobs[w].range.compare_exchange_weak(range, pack(begin_of(range) + 1, end_of(range)))) {
+                    work(w, static_cast<size_t>(begin_of(range)));
+                    range = jobs[w].range.load();
+                }
+            }
+
+            bool stole = false;
+            for (size_t i = 1; i < numWorkers && !stole; i++) {
+                Jobs& victim = jobs[(w + i) % numWorkers];
+                uint64_t left = victim.range.load();
+                while (begin_of(left) < end_of(left)) {
+                    uint64_t mid = begin_of(left) + (end_of(left) - begin_of(left)) / 2;
+                    if (victim.range.compare_exchange_weak(left, pack(begin_of(left), mid))) {
+                        jobs[w].range = pack(mid, end_of(left));
+                        stole = true;
+                        break;
+                    }
+                }
+            }
+            if (!stole) return;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < numWorkers; w++) threads.emplace_back(worker, w);
+    worker(0);
+    for (auto& thread : threads) thread.join();
+}
+
+}  // namespace
+
+// Everything one thread needs to check function bodies without touching anything another thread writes to
+struct TypeChecker::Worker {
+    TypeTable types;
+    Diagnostics dx;
+    TypeChecker checker;
+
+    explicit Worker(TypeChecker& parent) : types(&parent.types), dx(parent.dx.sources), checker(parent, types, dx) {}
+};
+
+TypeChecker::TypeChecker(TypeTable& types, const TokenList& tokens, const AtomTable& atoms, Diagnostics& dx)
+    : types(types), tokens(tokens), atoms(atoms), dx(dx), layouts(types, tokens, *this) {
+    typeType = types.primitive(TokenType::TY_TYPE);
+    moduleType = types.primitive(TokenType::MOD_TYPE);
+    voidType = types.primitive(TokenType::VOID_TYPE);
+    boolType = types.primitive(TokenType::BOOL_TYPE);
+    intType = types.primitive(TokenType::INT_TYPE);
+    doubleType = types.primitive(TokenType::DOUBLE_TYPE);
+    stringType = types.primitive(TokenType::STRING_TYPE);
+}
+
+TypeChecker::TypeChecker(TypeChecker& parent, TypeTable& types, Diagnostics& dx)
+    : types(types), tokens(parent.tokens), atoms(parent.atoms), dx(dx), parent(&parent), resolver(parent.resolver),
+      layouts(types, tokens, *this) {
+    declBase = static_cast<uint32_t>(parent.decls.size());
+    definitionBase = static_cast<uint32_t>(parent.definitions.size());
+    typeType = parent.typeType;
+    moduleType = parent.moduleType;
+    voidType = parent.voidType;
+    boolType = parent.boolType;
+    intType = parent.intType;
+    doubleType = parent.doubleType;
+    stringType = parent.stringType;
+}
+
+uint32_t TypeChecker::info_of(ASTDecl* decl) {
+    if (decl->checkID == NO_DECL) {
+        decl->checkID = declBase + static_cast<uint32_t>(decls.size());
+        decls.push_back({decl, NO_VALUE, NO_TASK, NO_TASK, false});
+    }
+    return decl->checkID;
+}
+
+void TypeChecker::spawn(ASTDecl* decl) {
+    uint32_t id = info_of(decl);
+    info(id).task = static_cast<TaskID>(tasks.size());
+    tasks.push_back({id, 0, TaskState::NEW, NO_DECL, NO_TASK, nullptr, 0, {}, {}});
+}
+
+void TypeChecker::publish(uint32_t decl, const CheckedValue& value) {
+    DeclInfo& entry = info(decl);
+    entry.value = value;
+    entry.typed = true;
+    for (TaskID waiter = entry.firstWaiter; waiter != NO_TASK;) {
+        Task& task = tasks[waiter];
+        TaskID next = task.nextWaiter;
+        task.state = TaskState::READY;
+        task.waitingOn = NO_DECL;
+        task.nextWaiter = NO_TASK;
+        ready.push_back(waiter);
+        waiter = next;
+    }
+    entry.firstWaiter = NO_TASK;
+}
+
+bool TypeChecker::need(uint32_t decl, const ASTNode& use) {
+    DeclInfo& entry = info(decl);
+    if (entry.typed) return true;
+
+    // Only declarations with their own task are checked out of order, anything else is still being checked by the
+    // running task
+    if (entry.task == current || entry.task == NO_TASK) {
+        dx.err_node("Type of " + name_str(*entry.decl) + " depends on itself", use);
+        publish(decl, NO_VALUE);
+        return true;
+    }
+
+    Task& task = tasks[current];
+    task.waitingOn = decl;
+    task.waitNode = &use;
+    task.nextWaiter = entry.firstWaiter;
+    entry.firstWaiter = current;
+    if (tasks[entry.task].state == TaskState::NEW) ready.push_back(entry.task);
+    numSuspensions++;
+    return false;
+}
+
+void TypeChecker::run(TaskID task) {
+    current = task;
+    if (tasks[task].state != TaskState::NEW) {
+        frames.assign(tasks[task].frames.begin(), tasks[task].frames.end());
+        values.assign(tasks[task].values.begin(), tasks[task].values.end());
+    } else if (tasks[task].decl != NO_DECL) {
+        push(info(tasks[task].decl).decl, tasks[task].decl);
+    } else {
+        // The parameters and return type were checked along with the function, so only the body is left
+        const Body& body = parent->bodies[tasks[task].body];
+        frames.push_back({body.func, static_cast<uint32_t>(body.func->parameters.size()) + 2, 0, NO_DECL,
+                          body.returnType});
+        push(body.func->blockOrExpr);
+    }
+    tasks[task].state = TaskState::READY;
+
+    while (!frames.empty()) {
+        // Tasks may be spawned during a step so nothing can hold on to the running task across one
+        if (!step()) {
+            // Copied rather than swapped so that the stacks of the running task keep their capacity
+            tasks[task].state = TaskState::SUSPENDED;
+            tasks[task].frames.assign(frames.begin(), frames.end());
+            tasks[task].values.assign(values.begin(), values.end());
+            frames.clear();
+            values.clear();
+            suspended.push_back(task);
+            return;
+        }
+    }
+    tasks[task].state = TaskState::DONE;
+    tasks[task].frames = {};
+    tasks[task].values = {};
+    values.clear();
+    if (tasks[task].decl != NO_DECL && !info(tasks[task].decl).typed) publish(tasks[task].decl, NO_VALUE);
+}
+
+void TypeChecker::run_all() {
+    do {
+        while (!ready.empty()) {
+            TaskID task = ready.back();
+            ready.pop_back();
+            // A task can be in ready more than once when it is needed before its turn comes
+            if (tasks[task].state == TaskState::NEW || tasks[task].state == TaskState::READY) run(task);
+        }
+    } while (break_cycles());
+}
+
+bool TypeChecker::break_cycles() {
+    std::vector<TaskID> blocked;
+    for (TaskID task : suspended) {
+        if (tasks[task].state == TaskState::SUSPENDED) blocked.push_back(task);
+    }
+    suspended.clear();
+    if (blocked.empty()) return false;
+
+    // Nothing is ready, so every suspended task waits on a declaration of another suspended task and following what
+    // the tasks wait on always ends up in a cycle
+    std::vector<uint32_t> cycleDecls;
+    uint32_t walk = 0;
+    for (TaskID start : blocked) {
+        if (tasks[start].walk != 0) continue;
+        walk++;
+        TaskID task = start;
+        while (tasks[task].walk == 0) {
+            tasks[task].walk = walk;
+            task = info(tasks[task].waitingOn).task;
+        }
+        if (tasks[task].walk != walk) continue;  // Leads into a cycle which was already found
+
+        // Report the cycle from the declaration which appears first
+        TaskID first = task;
+        for (TaskID t = info(tasks[task].waitingOn).task; t != task; t = info(tasks[t].waitingOn).task) {
+            if (info(tasks[t].decl).decl->beginI < info(tasks[first].decl).decl->beginI) first = t;
+        }
+        const ASTDecl& firstDecl = *info(tasks[first].decl).decl;
+        dx.err_node("Type of " + name_str(firstDecl) + " depends on itself", *firstDecl.lvalue);
+        TaskID t = first;
+        do {
+            const Task& member = tasks[t];
+            dx.err_node(name_str(*info(member.decl).decl) + " uses " + name_str(*info(member.waitingOn).decl) +
+                            " here",
+                        *member.waitNode)
+                ->tag(ErrorMsg::EMPTY);
+            cycleDecls.push_back(member.waitingOn);
+            t = info(member.waitingOn).task;
+        } while (t != first);
+        numCycles++;
+    }
+    for (TaskID task : blocked) tasks[task].walk = 0;
+
+    // Every task in a cycle gives up on the declaration it waits on, which in turn wakes the tasks waiting on them
+    ASSERT(!cycleDecls.empty(), "Suspended tasks must wait on a cycle");
+    for (uint32_t decl : cycleDecls) {
+        if (!info(decl).typed) publish(decl, NO_VALUE);
+    }
+    return true;
+}
+
+void TypeChecker::check(ASTProgram& program) {
+    size_t firstError = dx.error_count();
+    int maxThreads = Flags::numThreads > 0 ? Flags::numThreads : static_cast<int>(std::thread::hardware_concurrency());
+    numThreads = static_cast<size_t>(std::max(maxThreads, 1));
+    tasks.reserve(program.declarations.size());
+    decls.reserve(program.declarations.size());
+    for (ASTDecl* decl : program.declarations) spawn(decl);
+    for (TaskID task = static_cast<TaskID>(tasks.size()); task-- > 0;) ready.push_back(task);
+    run_all();
+    numTasks = tasks.size();
+
+    check_bodies();
+    check_layouts(0);
+    dx.sort_errors(firstError);
+}
+
+void TypeChecker::check_bodies() {
+    numThreads = std::min(numThreads, bodies.size());
+    if (bodies.empty()) return;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (size_t w = 0; w < numThreads; w++) workers.push_back(std::make_unique<Worker>(*this));
+
+    // Errors are kept per body so that they are added in the same order whichever worker checked the body
+    std::vector<std::vector<std::unique_ptr<ErrorMsg>>> bodyErrors(bodies.size());
+    steal_for(bodies.size(), numThreads, [&](size_t w, size_t body) {
+        Worker& worker = *workers[w];
+        worker.checker.check_body(static_cast<uint32_t>(body));
+        bodyErrors[body] = worker.dx.take_errors();
+    });
+
+    for (auto& errors : bodyErrors) {
+        for (auto& error : errors) dx.add_err(std::move(error));
+    }
+    for (auto& worker : workers) {
+        numTasks += worker->checker.numTasks;
+        numSuspensions += worker->checker.numSuspensions;
+        numCycles += worker->checker.numCycles;
+    }
+}
+
+void TypeChecker::check_body(uint32_t body) {
+    // Nothing outside of a body can see its declarations, so the tasks and declarations of the previous body are
+    // dropped and their memory reused while it is still in the cache
+    tasks.clear();
+    decls.clear();
+    uint32_t firstDefinition = static_cast<uint32_t>(definitions.size());
+    tasks.push_back({NO_DECL, body, TaskState::NEW, NO_DECL, NO_TASK, nullptr, 0, {}, {}});
+    ready.push_back(0);
+    run_all();
+    numTasks += tasks.size();
+    check_layouts(firstDefinition);
+}
+
+void TypeChecker::check_layouts(uint32_t firstDefinition) {
+    for (uint32_t i = firstDefinition; i < definitions.size(); i++) layouts.layout_of(definitions[i].type);
+
+    // A checker of a function body also lays out the types of its parent, whose loops the parent reports
+    for (const LayoutCycle& cycle : layouts.take_cycles()) {
+        if (types.operand(cycle.type, 0) < definitionBase) continue;
+        dx.err_node(type_str(cycle.type) + " contains itself through " + name_str(*cycle.field),
+                    cycle.field->type ? *cycle.field->type : *cycle.field->lvalue)
+            ->note("Refer to it through a pointer like *" + type_str(cycle.type) + " instead");
+    }
+}
+
+void TypeChecker::push_declaration(ASTDecl* decl) {
+    uint32_t id = info_of(decl);
+    info(id).task = current;
+    push(decl, id);
+}
+
+void TypeChecker::push_statement(ASTNode* node) {
+    if (node->nodeType == NodeType::DECL) {
+        // A statement without a type annotation assigns to a name which is already declared
+        auto* decl = static_cast<ASTDecl*>(node);
+        if (decl->lvalue->nodeType == NodeType::NAME &&
+            (decl->type || static_cast<ASTName*>(decl->lvalue)->decl == decl)) {
+            push_declaration(decl);
+            return;
+        }
+    }
+    push(node);
+}
+
+void TypeChecker::finish(CheckedValue value) {
+    values.resize(frames.back().base);
+    values.push_back(value);
+    frames.pop_back();
+}
+
+void TypeChecker::finish_statement() {
+    values.resize(frames.back().base);
+    frames.pop_back();
+}
+
+bool TypeChecker::step() {
+    // Each step either pushes a frame and returns straight away, since that can move the frame, or works on the frame
+    Frame& frame = frames.back();
+    switch (frame.node->nodeType) {
+        case NodeType::BLOCK: {
+            auto& block = static_cast<ASTBlock&>(*frame.node);
+            values.resize(frame.base);
+            if (frame.step < block.statements.size()) {
+                push_statement(block.statements[frame.step++]);
+            } else {
+                frames.pop_back();
+            }
+            return true;
+        }
+        case NodeType::IF: {
+            auto& ifStmt = static_cast<ASTIf&>(*frame.node);
+            switch (frame.step) {
+                case 0:
+                    frame.step = 1;
+                    push(ifStmt.condition);
+                    return true;
+                case 1:
+                    expect(values.back().type, boolType, *ifStmt.condition);
+                    values.resize(frame.base);
+                    frame.step = 2;
+                    push_statement(ifStmt.conseq);
+                    return true;
+                case 2:
+                    frame.step = 3;
+                    if (ifStmt.alt) {
+                        push_statement(ifStmt.alt);
+                        return true;
+                    }
+                    [[fallthrough]];
+                default:
+                    finish_statement();
+                    return true;
+            }
+        }
+        case NodeType::FOR: {
+            auto& forLoop = static_cast<ASTFor&>(*frame.node);
+            switch (frame.step) {
+                case 0:
+                    // A loop with only a condition keeps it as its initial statement too
+                    frame.step = 1;
+                    if (forLoop.initial && forLoop.initial != forLoop.condition) {
+                        push_statement(forLoop.initial);
+                        return true;
+                    }
+                    [[fallthrough]];
+                case 1:
+                    values.resize(frame.base);
+                    frame.step = 2;
+                    if (forLoop.condition) {
+                        push(forLoop.condition);
+                        return true;
+                    }
+                    [[fallthrough]];
+                case 2:
+                    if (forLoop.condition) expect(values.back().type, boolType, *forLoop.condition);
+                    values.resize(frame.base);
+                    frame.step = 3;
+                    if (forLoop.post) {
+                        push_statement(forLoop.post);
+                        return true;
+                    }
+                    [[fallthrough]];
+                case 3:
+                    values.resize(frame.base);
+                    frame.step = 4;
+                    if (forLoop.blockStmt) {
+                        push(forLoop.blockStmt);
+                        return true;
+                    }
+                    [[fallthrough]];
+                default:
+                    finish_statement();
+                    return true;
+            }
+        }
+        case NodeType::BREAK:
+        case NodeType::CONT:
+            finish_statement();
+            return true;
+        case NodeType::RET:
+            step_ret(frame);
+            return true;
+        case NodeType::DECL:
+            step_decl(frame);
+            return true;
+        case NodeType::TYPE_LIT:
+            finish({typeType, types.primitive(static_cast<ASTTypeLit&>(*frame.node).type), nullptr});
+            return true;
+        case NodeType::FUNC_TYPE: {
+            auto& funcType = static_cast<ASTFuncType&>(*frame.node);
+            if (frame.step < funcType.inTypes.size()) {
+                push(funcType.inTypes[frame.step++]);
+                return true;
+            }
+            if (frame.step == funcType.inTypes.size()) {
+                frame.step++;
+                push(funcType.outType);
+                return true;
+            }
+            // Parts which aren't types have been reported, so the function type is left unknown
+            scratch.clear();
+            bool known = true;
+            for (uint32_t i = 0; i < funcType.inTypes.size(); i++) {
+                scratch.push_back(expect_type(values[frame.base + i], *funcType.inTypes[i]));
+                known &= scratch.back() != NULL_TYPE;
+            }
+            TypeID returnType = expect_type(values.back(), *funcType.outType);
+            known &= returnType != NULL_TYPE;
+            finish({typeType, known ? types.function(scratch, returnType) : NULL_TYPE, nullptr});
+            return true;
+        }
+        case NodeType::MOD: {
+            auto& mod = static_cast<ASTMod&>(*frame.node);
+            TaskID first = static_cast<TaskID>(tasks.size());
+            for (ASTDecl* decl : mod.declarations) spawn(decl);
+            for (TaskID task = static_cast<TaskID>(tasks.size()); task-- > first;) ready.push_back(task);
+            finish({moduleType, NULL_TYPE, &mod});
+            return true;
+        }
+        case NodeType::TYPE_DEF: {
+            auto& ty = static_cast<ASTTy&>(*frame.node);
+            AtomID name = NULL_ATOM;
+            if (frame.decl != NO_DECL && info(frame.decl).decl->lvalue->nodeType == NodeType::NAME) {
+                name = tokens.atom(static_cast<const ASTName*>(info(frame.decl).decl->lvalue)->ref);
+            }
+            TypeID defined = types.defined(definitionBase + static_cast<uint32_t>(definitions.size()), name);
+            definitions.push_back({&ty, defined});
+
+            TaskID first = static_cast<TaskID>(tasks.size());
+            for (ASTDecl* decl : ty.declarations) spawn(decl);
+            for (TaskID task = static_cast<TaskID>(tasks.size()); task-- > first;) ready.push_back(task);
+            finish({typeType, defined, nullptr});
+            return true;
+        }
+        case NodeType::FUNC:
+            step_func(frame);
+            return true;
+        case NodeType::NAME: {
+            auto& name = static_cast<ASTName&>(*frame.node);
+            if (!name.decl) {
+                auto error = dx.err_node(std::string(tokens.str(name.ref)) + " is not declared", name);
+                const ASTDecl* late = resolver != nullptr ? resolver->late_declaration(name) : nullptr;
+                if (late != nullptr) {
+                    error->note("It is only declared further down in the same scope");
+                    dx.err_node("Declaration found here", *late->lvalue)->tag(ErrorMsg::EMPTY);
+                }
+                finish(NO_VALUE);
+                return true;
+            }
+            uint32_t decl = info_of(name.decl);
+            if (!need(decl, name)) return false;
+            finish(info(decl).value);
+            return true;
+        }
+        case NodeType::DOT_OP:
+            return step_dot_op(frame);
+        case NodeType::CALL:
+            step_call(frame);
+            return true;
+        case NodeType::TYPE_INIT:
+            return step_type_init(frame);
+        case NodeType::LIT: {
+            TypeID type = NULL_TYPE;
+            switch (tokens.type(static_cast<ASTLit&>(*frame.node).value)) {
+                case TokenType::INT_LITERAL:
+                    type = intType;
+                    break;
+                case TokenType::DOUBLE_LITERAL:
+                    type = doubleType;
+                    break;
+                case TokenType::STRING_LITERAL:
+                    type = stringType;
+                    break;
+                case TokenType::TRUE:
+                case TokenType::FALSE:
+                    type = boolType;
+                    break;
+                default:
+                    break;
+            }
+            finish({type, NULL_TYPE, nullptr});
+            return true;
+        }
+        case NodeType::UN_OP:
+        case NodeType::DEREF:
+            step_un_op(frame);
+            return true;
+        case NodeType::BIN_OP:
+            step_bin_op(frame);
+            return true;
+        default:
+            // Only a program with parse errors has unknown nodes and those are never checked
+            finish(NO_VALUE);
+            return true;
+    }
+}
+
+void TypeChecker::step_decl(Frame& frame) {
+    auto& decl = static_cast<ASTDecl&>(*frame.node);
+    if (frame.decl == NO_DECL) {
+        // Assignment to something which is already declared
+        if (frame.step == 0) {
+            frame.step = 1;
+            push(decl.lvalue);
+            return;
+        }
+        if (frame.step == 1 && decl.rvalue) {
+            frame.step = 2;
+            push(decl.rvalue);
+            return;
+        }
+        NodeType target = decl.lvalue->nodeType;
+        if (target != NodeType::NAME && target != NodeType::DOT_OP && target != NodeType::DEREF) {
+            dx.err_node("Can't assign to " + print_expr(*decl.lvalue, tokens), *decl.lvalue);
+        } else if (decl.rvalue) {
+            expect(values.back().type, values[frame.base].type, *decl.rvalue);
+        }
+        finish_statement();
+        return;
+    }
+
+    switch (frame.step) {
+        case 0:
+            if (decl.lvalue->nodeType != NodeType::NAME) {
+                dx.err_node("Expected a name to declare", *decl.lvalue);
+            } else if (ASTDecl* first = static_cast<ASTName*>(decl.lvalue)->decl; first && first != &decl) {
+                dx.err_node(name_str(decl) + " is already declared", *decl.lvalue);
+                dx.err_node("Previous declaration of " + name_str(*first), *first->lvalue)->tag(ErrorMsg::EMPTY);
+            }
+            frame.step = 1;
+            if (decl.type) {
+                push(decl.type);
+                return;
+            }
+            [[fallthrough]];
+        case 1:
+            frame.type = decl.type ? expect_type(values.back(), *decl.type) : UNINFERRED;
+            values.resize(frame.base);
+
+            // The annotation is all anything else needs, unless the declaration names a type or a module
+            if (frame.type != UNINFERRED &&
+                (!decl.rvalue || (frame.type != typeType && frame.type != moduleType))) {
+                publish(frame.decl, {frame.type, NULL_TYPE, nullptr});
+            }
+            frame.step = 2;
+            if (decl.rvalue) {
+                push(decl.rvalue, frame.decl);
+                return;
+            }
+            [[fallthrough]];
+        default: {
+            CheckedValue value = NO_VALUE;
+            if (decl.rvalue) {
+                value = values.back();
+                if (frame.type != UNINFERRED) {
+                    expect(value.type, frame.type, *decl.rvalue);
+                    if (value.type != frame.type) value = {frame.type, NULL_TYPE, nullptr};
+                } else if (value.type == voidType) {
+                    dx.err_node("Void can't be assigned to " + name_str(decl), *decl.rvalue);
+                    value = NO_VALUE;
+                }
+            }
+            if (!info(frame.decl).typed) publish(frame.decl, value);
+            finish_statement();
+        }
+    }
+}
+
+TypeID TypeChecker::signature_of(const Frame& funcFrame) {
+    auto& func = static_cast<const ASTFunc&>(*funcFrame.node);
+    if (funcFrame.type == NULL_TYPE || funcFrame.type == UNINFERRED) return NULL_TYPE;
+    scratch.clear();
+    for (const ASTDecl* param : func.parameters) {
+        TypeID type = info(param->checkID).value.type;
+        if (type == NULL_TYPE) return NULL_TYPE;
+        scratch.push_back(type);
+    }
+    return types.function(scratch, funcFrame.type);
+}
+
+void TypeChecker::publish_signature(const Frame& funcFrame) {
+    if (funcFrame.decl != NO_DECL && !info(funcFrame.decl).typed) {
+        publish(funcFrame.decl, {signature_of(funcFrame), NULL_TYPE, nullptr});
+    }
+}
+
+void TypeChecker::step_func(Frame& frame) {
+    auto& func = static_cast<ASTFunc&>(*frame.node);
+    uint32_t numParams = static_cast<uint32_t>(func.parameters.size());
+    if (frame.step < numParams) {
+        push_declaration(func.parameters[frame.step++]);
+        return;
+    }
+    if (frame.step == numParams) {
+        frame.step++;
+        if (func.returnType) {
+            push(func.returnType);
+            return;
+        }
+    }
+    if (frame.step == numParams + 1) {
+        // Once the return type is known the signature is too, so recursive calls in the body can be checked
+        frame.type = func.returnType ? expect_type(values.back(), *func.returnType) : UNINFERRED;
+        values.resize(frame.base);
+        if (frame.type != UNINFERRED) publish_signature(frame);
+        frame.step = numParams + 3;
+        if (func.blockOrExpr) {
+            // Nothing outside of the body depends on it then, so it can wait to be checked in parallel. With a single
+            // thread that would only cost a second walk, so the body is checked right away
+            if (!parent && numThreads > 1 && frame.type != UNINFERRED) {
+                bodies.push_back({&func, frame.type});
+            } else {
+                frame.step = numParams + 2;
+                push(func.blockOrExpr);
+                return;
+            }
+        }
+    }
+
+    if (frame.step == numParams + 2 && func.blockOrExpr->nodeType != NodeType::BLOCK) {
+        TypeID type = values.back().type;
+        if (frame.type == UNINFERRED) {
+            frame.type = type;
+        } else {
+            expect(type, frame.type, *func.blockOrExpr);
+        }
+    } else if (frame.type == UNINFERRED) {
+        frame.type = voidType;
+    }
+    publish_signature(frame);
+    finish({signature_of(frame), NULL_TYPE, nullptr});
+}
+
+void TypeChecker::step_ret(Frame& frame) {
+    auto& ret = static_cast<ASTRet&>(*frame.node);
+    if (frame.step == 0 && ret.retValue) {
+        frame.step = 1;
+        push(ret.retValue);
+        return;
+    }
+
+    TypeID type = ret.retValue ? values.back().type : voidType;
+    for (size_t i = frames.size() - 1; i-- > 0;) {
+        Frame& funcFrame = frames[i];
+        if (funcFrame.node->nodeType != NodeType::FUNC) continue;
+
+        if (funcFrame.type == UNINFERRED) {
+            // The first return decides the return type of a function without an annotation
+            funcFrame.type = type;
+            publish_signature(funcFrame);
+        } else if (!ret.retValue && funcFrame.type != voidType && funcFrame.type != NULL_TYPE) {
+            dx.err_node("Expected a return value of type " + type_str(funcFrame.type), ret);
+        } else if (ret.retValue) {
+            expect(type, funcFrame.type, *ret.retValue);
+        }
+        break;
+    }
+    finish_statement();
+}
+
+bool TypeChecker::step_dot_op(Frame& frame) {
+    auto& dotOp = static_cast<ASTDotOp&>(*frame.node);
+    if (frame.step == 0) {
+        frame.step = 1;
+        push(dotOp.base);
+        return true;
+    }
+
+    // The base stays on the value stack in case the member's type isn't known yet
+    const CheckedValue base = values.back();
+    SymTable* members = nullptr;
+    if (base.type == moduleType) {
+        if (!base.module) {
+            finish(NO_VALUE);
+            return true;
+        }
+        members = base.module->symbolTable;
+    } else if (base.type == typeType) {
+        if (base.denoted == NULL_TYPE) {
+            finish(NO_VALUE);
+            return true;
+        }
+        if (const ASTTy* ty = definition_of(base.denoted)) members = ty->symbolTable;
+    } else if (base.type != NULL_TYPE) {
+        TypeID type = base.type;
+        if (types[type].kind == TypeKind::POINTER) type = types.operand(type, 0);
+        if (const ASTTy* ty = definition_of(type)) members = ty->symbolTable;
+    } else {
+        finish(NO_VALUE);
+        return true;
+    }
+
+    if (!members) {
+        dx.err_node(print_expr(*dotOp.base, tokens) + " of type " + type_str(base.type) + " has no members",
+                    *dotOp.base);
+        finish(NO_VALUE);
+        return true;
+    }
+    TableEntry* entry = members->find(tokens.atom(dotOp.member->ref));
+    if (!entry) {
+        dx.err_node(print_expr(*dotOp.base, tokens) + " has no member named " +
+                        std::string(tokens.str(dotOp.member->ref)),
+                    *dotOp.member);
+        finish(NO_VALUE);
+        return true;
+    }
+    uint32_t decl = info_of(entry->decl);
+    if (!need(decl, *dotOp.member)) return false;
+    finish(info(decl).value);
+    return true;
+}
+
+bool TypeChecker::step_type_init(Frame& frame) {
+    auto& typeInit = static_cast<ASTTypeInit&>(*frame.node);
+    if (frame.step == 0) {
+        frame.step = 1;
+        push(typeInit.typeRef);
+        return true;
+    }
+    if (frame.step == 1) {
+        const CheckedValue& typeRef = values.back();
+        frame.type = NULL_TYPE;
+        if (typeRef.type == typeType && definition_of(typeRef.denoted)) {
+            frame.type = typeRef.denoted;
+        } else if (typeRef.type != NULL_TYPE && !(typeRef.type == typeType && typeRef.denoted == NULL_TYPE)) {
+            dx.err_node("Expected a type defined by ty {} but found " + print_expr(*typeInit.typeRef, tokens),
+                        *typeInit.typeRef);
+        }
+        values.resize(frame.base);
+        frame.step = 2;
+    }
+
+    // Every assignment takes two steps: finding the field and checking the assigned value
+    size_t i = (frame.step - 2) / 2;
+    if (i == typeInit.assignments.size()) {
+        finish({frame.type, NULL_TYPE, nullptr});
+        return true;
+    }
+    ASTDecl& assignment = *typeInit.assignments[i];
+    const ASTTy* ty = definition_of(frame.type);
+    uint32_t field = NO_DECL;
+    bool findField = frame.step % 2 == 0;
+    if (ty && assignment.lvalue->nodeType == NodeType::NAME) {
+        auto& name = static_cast<ASTName&>(*assignment.lvalue);
+        if (TableEntry* entry = ty->symbolTable->find(tokens.atom(name.ref))) {
+            field = info_of(entry->decl);
+        } else if (findField) {
+            dx.err_node(type_str(frame.type) + " has no field named " + std::string(tokens.str(name.ref)), name);
+        }
+    }
+
+    if (findField) {
+        if (field != NO_DECL && !need(field, *assignment.lvalue)) return false;
+        frame.step += assignment.rvalue ? 1 : 2;
+        if (assignment.rvalue) push(assignment.rvalue);
+        return true;
+    }
+    if (field != NO_DECL) expect(values.back().type, info(field).value.type, *assignment.rvalue);
+    values.resize(frame.base);
+    frame.step++;
+    return true;
+}
+
+void TypeChecker::step_un_op(Frame& frame) {
+    auto* inner = frame.node->nodeType == NodeType::DEREF ? static_cast<ASTDeref&>(*frame.node).inner
+                                                          : static_cast<ASTUnOp&>(*frame.node).inner;
+    if (frame.step == 0) {
+        frame.step = 1;
+        push(inner);
+        return;
+    }
+
+    TypeID type = values.back().type;
+    if (type == NULL_TYPE) {
+        finish(NO_VALUE);
+        return;
+    }
+    if (frame.node->nodeType == NodeType::DEREF) {
+        if (types[type].kind == TypeKind::POINTER) {
+            finish({types.operand(type, 0), NULL_TYPE, nullptr});
+            return;
+        }
+        dx.err_node("Only pointers can be dereferenced but found " + type_str(type), *inner);
+        finish(NO_VALUE);
+        return;
+    }
+
+    TokenID op = static_cast<ASTUnOp&>(*frame.node).op;
+    TypeID result = NULL_TYPE;
+    switch (tokens.type(op)) {
+        case TokenType::OP_MULT:
+            // A pointer type rather than a dereference, which is written as .*
+            if (type == typeType) {
+                TypeID denoted = values.back().denoted;
+                finish({typeType, denoted == NULL_TYPE ? NULL_TYPE : types.pointer(denoted), nullptr});
+            } else {
+                dx.err_node("Expected a type to point to but found a value of type " + type_str(type), *inner);
+                finish(NO_VALUE);
+            }
+            return;
+        case TokenType::OP_SUBTR:
+            if (type == intType || type == doubleType) result = type;
+            break;
+        case TokenType::COND_NOT:
+            if (type == boolType) result = type;
+            break;
+        case TokenType::BIT_NOT:
+            if (type == intType) result = type;
+            break;
+        default:
+            break;
+    }
+    if (result == NULL_TYPE) {
+        dx.err_node("Operator " + std::string(tokens.str(op)) + " can't be applied to " + type_str(type), *frame.node);
+    }
+    finish({result, NULL_TYPE, nullptr});
+}
+
+void TypeChecker::step_bin_op(Frame& frame) {
+    auto& binOp = static_cast<ASTBinOp&>(*frame.node);
+    if (frame.step == 0) {
+        frame.step = 1;
+        push(binOp.left);
+        return;
+    }
+    if (frame.step == 1) {
+        frame.step = 2;
+        push(binOp.right);
+        return;
+    }
+
+    TypeID left = values[frame.base].type;
+    TypeID right = values[frame.base + 1].type;
+    if (left == NULL_TYPE || right == NULL_TYPE) {
+        finish(NO_VALUE);
+        return;
+    }
+    bool numbers = left == right && (left == intType || left == doubleType);
+    TypeID result = NULL_TYPE;
+    switch (tokens.type(binOp.op)) {
+        case TokenType::OP_ADD:
+            if (numbers || (left == stringType && right == stringType)) result = left;
+            break;
+        case TokenType::OP_SUBTR:
+        case TokenType::OP_MULT:
+        case TokenType::OP_DIV:
+        case TokenType::OP_MOD:
+        case TokenType::OP_CARROT:
+            if (numbers) result = left;
+            break;
+        case TokenType::COND_LESS:
+        case TokenType::COND_LESS_EQUAL:
+        case TokenType::COND_GREATER:
+        case TokenType::COND_GREATER_EQUAL:
+            if (numbers) result = boolType;
+            break;
+        case TokenType::COND_EQUALS:
+        case TokenType::COND_NOT_EQUALS:
+            if (left == right) result = boolType;
+            break;
+        case TokenType::COND_AND:
+        case TokenType::COND_OR:
+        case TokenType::COND_XOR:
+            if (left == boolType && right == boolType) result = boolType;
+            break;
+        case TokenType::BIT_OR:
+        case TokenType::BIT_AND:
+        case TokenType::BIT_XOR:
+        case TokenType::BIT_SHIFT_LEFT:
+        case TokenType::BIT_SHIFT_RIGHT:
+            if (left == intType && right == intType) result = intType;
+            break;
+        default:
+            break;
+    }
+    if (result == NULL_TYPE) {
+        dx.err_node("Operator " + std::string(tokens.str(binOp.op)) + " can't be applied to " + type_str(left) +
+                        " and " + type_str(right),
+                    binOp);
+    }
+    finish({result, NULL_TYPE, nullptr});
+}
+
+void TypeChecker::step_call(Frame& frame) {
+    auto& call = static_cast<ASTCall&>(*frame.node);
+    if (frame.step <= call.arguments.size()) {
+        ASTExpression* next = frame.step == 0 ? call.callRef : call.arguments[frame.step - 1];
+        frame.step++;
+        push(next);
+        return;
+    }
+
+    TypeID callee = values[frame.base].type;
+    if (callee == NULL_TYPE) {
+        finish(NO_VALUE);
+        return;
+    }
+    if (types[callee].kind != TypeKind::FUNCTION) {
+        dx.err_node("Expected a function but found " + type_str(callee), *call.callRef);
+        finish(NO_VALUE);
+        return;
+    }
+    uint32_t numParams = types[callee].numOperands - 1;
+    if (numParams != call.arguments.size()) {
+        dx.err_node("Expected " + std::to_string(numParams) + (numParams == 1 ? " argument" : " arguments") +
+                        " but found " + std::to_string(call.arguments.size()),
+                    call);
+    } else {
+        for (uint32_t i = 0; i < numParams; i++) {
+            expect(values[frame.base + 1 + i].type, types.operand(callee, i), *call.arguments[i]);
+        }
+    }
+    finish({types.operand(callee, numParams), NULL_TYPE, nullptr});
+}
+
+bool TypeChecker::expect(TypeID found, TypeID expected, const ASTNode& node) {
+    if (found == expected || found == NULL_TYPE || expected == NULL_TYPE) return true;
+    dx.err_node("Expected " + type_str(expected) + " but found " + type_str(found), node);
+    return false;
+}
+
+TypeID TypeChecker::expect_type(const CheckedValue& value, const ASTNode& node) {
+    if (value.type == typeType) return value.denoted;
+    if (value.type != NULL_TYPE) dx.err_node("Expected a type but found a value of type " + type_str(value.type), node);
+    return NULL_TYPE;
+}
+
+const ASTTy* TypeChecker::definition_of(TypeID type) const {
+    if (type == NULL_TYPE || types[type].kind != TypeKind::DEFINED) return nullptr;
+    uint32_t definition = types.operand(type, 0);
+    if (definition < definitionBase) return parent->definitions[definition].ty;
+    return definitions[definition - definitionBase].ty;
+}
+
+std::string TypeChecker::name_str(const ASTDecl& decl) const {
+    if (decl.lvalue->nodeType == NodeType::NAME) {
+        return std::string(tokens.str(static_cast<const ASTName&>(*decl.lvalue).ref));
+    }
+    return print_expr(*decl.lvalue, tokens);
+}
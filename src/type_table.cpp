@@ -0,0 +1,188 @@
+#include "type_table.hpp"
+
+#include <cstring>
+
+#include "ast.hpp"
+#include "lexer.hpp"
+
+namespace {
+
+constexpr size_t INITIAL_SLOTS = 64;
+
+inline uint32_t hash_combine(uint32_t hash, uint32_t value) {
+    // FNV-1a over whole words instead of bytes
+    return (hash ^ value) * 16777619u;
+}
+
+inline uint32_t hash_type(TypeKind kind, TokenType primitive, AtomID name, const TypeID* ops, uint32_t numOps) {
+    uint32_t hash = hash_combine(2166136261u, static_cast<uint32_t>(kind) << 8 | static_cast<uint32_t>(primitive));
+    hash = hash_combine(hash, name);
+    for (uint32_t i = 0; i < numOps; i++) hash = hash_combine(hash, ops[i]);
+    return hash_combine(hash, numOps);
+}
+
+}  // namespace
+
+void TypeTable::grow() {
+    std::vector<Slot> old = std::move(slots);
+    slots.assign(old.empty() ? INITIAL_SLOTS : old.size() * 2, {0, NULL_TYPE});
+    size_t mask = slots.size() - 1;
+    for (const Slot& slot : old) {
+        if (slot.type == NULL_TYPE) continue;
+        size_t i = slot.hash & mask;
+        while (slots[i].type != NULL_TYPE) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+}
+
+TypeID TypeTable::find(uint32_t hash, TypeKind kind, TokenType primitive, AtomID name, const TypeID* ops,
+                       uint32_t numOps) const {
+    if (slots.empty()) return NULL_TYPE;
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask; slots[i].type != NULL_TYPE; i = (i + 1) & mask) {
+        if (slots[i].hash != hash) continue;
+        // Only types added to this table have slots in it
+        const Type& type = local(slots[i].type);
+        if (type.kind == kind && type.primitive == primitive && type.name == name && type.numOperands == numOps &&
+            (numOps == 0 || memcmp(&operands[type.firstOperand], ops, numOps * sizeof(TypeID)) == 0)) {
+            return slots[i].type;
+        }
+    }
+    return NULL_TYPE;
+}
+
+TypeID TypeTable::intern(TypeKind kind, TokenType primitive, AtomID name, const TypeID* ops, uint32_t numOps) {
+    uint32_t hash = hash_type(kind, primitive, name, ops, numOps);
+    // A base doesn't change, so types it has are looked up there and never added again
+    if (base) {
+        TypeID type = base->find(hash, kind, primitive, name, ops, numOps);
+        if (type != NULL_TYPE) return type;
+    }
+    TypeID type = find(hash, kind, primitive, name, ops, numOps);
+    if (type != NULL_TYPE) return type;
+
+    // Keep the load factor under 1/2 so that probe sequences stay short
+    if ((types.size() + 1) * 2 > slots.size()) grow();
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].type != NULL_TYPE) i = (i + 1) & mask;
+
+    TypeID id = baseSize + static_cast<TypeID>(types.size());
+    slots[i] = {hash, id};
+    types.push_back({kind, primitive, name, static_cast<uint32_t>(operands.size()), numOps});
+    operands.insert(operands.end(), ops, ops + numOps);
+    return id;
+}
+
+TypeID TypeTable::primitive(TokenType type) { return intern(TypeKind::PRIMITIVE, type, NULL_ATOM, nullptr, 0); }
+
+TypeID TypeTable::named(AtomID name) { return intern(TypeKind::NAMED, TokenType::END, name, nullptr, 0); }
+
+TypeID TypeTable::member(TypeID base, AtomID name) { return intern(TypeKind::MEMBER, TokenType::END, name, &base, 1); }
+
+TypeID TypeTable::pointer(TypeID inner) { return intern(TypeKind::POINTER, TokenType::END, NULL_ATOM, &inner, 1); }
+
+TypeID TypeTable::function(const std::vector<TypeID>& params, TypeID returnType) {
+    size_t first = scratch.size();
+    scratch.insert(scratch.end(), params.begin(), params.end());
+    scratch.push_back(returnType);
+    return intern_scratch(TypeKind::FUNCTION, first);
+}
+
+TypeID TypeTable::defined(uint32_t definition, AtomID name) {
+    return intern(TypeKind::DEFINED, TokenType::END, name, &definition, 1);
+}
+
+TypeID TypeTable::intern_scratch(TypeKind kind, size_t first) {
+    TypeID type = intern(kind, TokenType::END, NULL_ATOM, scratch.data() + first,
+                         static_cast<uint32_t>(scratch.size() - first));
+    scratch.resize(first);
+    return type;
+}
+
+TypeID TypeTable::intern_expr(const ASTExpression& typeExpr, const TokenList& tokens) {
+    // Recursion is only as deep as the nesting of the type, which the parser itself already recursed through
+    switch (typeExpr.nodeType) {
+        case NodeType::TYPE_LIT:
+            return primitive(static_cast<const ASTTypeLit&>(typeExpr).type);
+        case NodeType::NAME:
+            return named(tokens.atom(static_cast<const ASTName&>(typeExpr).ref));
+        case NodeType::DOT_OP: {
+            auto& dotOp = static_cast<const ASTDotOp&>(typeExpr);
+            if (dotOp.member->nodeType != NodeType::NAME) return NULL_TYPE;
+            TypeID base = intern_expr(*dotOp.base, tokens);
+            if (base == NULL_TYPE) return NULL_TYPE;
+            return member(base, tokens.atom(dotOp.member->ref));
+        }
+        case NodeType::UN_OP: {
+            auto& unOp = static_cast<const ASTUnOp&>(typeExpr);
+            if (tokens.type(unOp.op) != TokenType::OP_MULT) return NULL_TYPE;
+            TypeID inner = intern_expr(*unOp.inner, tokens);
+            return inner == NULL_TYPE ? NULL_TYPE : pointer(inner);
+        }
+        case NodeType::FUNC_TYPE: {
+            auto& funcType = static_cast<const ASTFuncType&>(typeExpr);
+            size_t first = scratch.size();
+            for (auto&& inType : funcType.inTypes) {
+                TypeID param = intern_expr(*inType, tokens);
+                if (param == NULL_TYPE) {
+                    scratch.resize(first);
+                    return NULL_TYPE;
+                }
+                scratch.push_back(param);
+            }
+            TypeID returnType = intern_expr(*funcType.outType, tokens);
+            if (returnType == NULL_TYPE) {
+                scratch.resize(first);
+                return NULL_TYPE;
+            }
+            scratch.push_back(returnType);
+            return intern_scratch(TypeKind::FUNCTION, first);
+        }
+        default:
+            return NULL_TYPE;
+    }
+}
+
+std::vector<TypeID> TypeTable::merge(const TypeTable& other) {
+    ASSERT(other.base == nullptr, "Only a table which doesn't extend another can be merged");
+    std::vector<TypeID> ids(other.types.size());
+    std::vector<TypeID> ops;
+    for (size_t t = 0; t < other.types.size(); t++) {
+        const Type& type = other.types[t];
+        ops.assign(other.operands.begin() + type.firstOperand,
+                   other.operands.begin() + type.firstOperand + type.numOperands);
+        // Operands come before the types made of them, except for the definition of a DEFINED type
+        if (type.kind != TypeKind::DEFINED) {
+            for (TypeID& op : ops) op = ids[op];
+        }
+        ids[t] = intern(type.kind, type.primitive, type.name, ops.data(), type.numOperands);
+    }
+    return ids;
+}
+
+std::string TypeTable::to_str(TypeID type, const AtomTable& atoms) const {
+    if (type == NULL_TYPE) return "[NULL TYPE]";
+    const Type& t = (*this)[type];
+    switch (t.kind) {
+        case TypeKind::PRIMITIVE:
+            return token_type_to_str(t.primitive);
+        case TypeKind::NAMED:
+            return std::string(atoms.str(t.name));
+        case TypeKind::MEMBER:
+            return to_str(operand(type, 0), atoms) + "." + std::string(atoms.str(t.name));
+        case TypeKind::POINTER:
+            return "*" + to_str(operand(type, 0), atoms);
+        case TypeKind::FUNCTION: {
+            std::string str = "(";
+            for (uint32_t i = 0; i + 1 < t.numOperands; i++) {
+                if (i > 0) str += ", ";
+                str += to_str(operand(type, i), atoms);
+            }
+            return str + ") -> " + to_str(operand(type, t.numOperands - 1), atoms);
+        }
+        case TypeKind::DEFINED:
+            return t.name == NULL_ATOM ? "ty {}" : std::string(atoms.str(t.name));
+    }
+    return "";
+}